@@ -0,0 +1,453 @@
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+//------------------------------------------------------------------
+// B+ Tree:
+// -----------------------------------------------------------------
+// Height of 2^32 pairs at BTRE_MIN fanout is far less than it.
+#define MAX_HEIGHT 16
+
+#define btlf_f(x) ((struct btlf *)(x))
+#define btin_f(x) ((struct btin *)(x))
+
+static struct btnd *mknode(struct ymd_mach *vm, int leaf) {
+	struct btnd *x = mm_zalloc(vm, 1, leaf ? sizeof(struct btlf) :
+	                           sizeof(struct btin));
+	x->leaf = (unsigned short)leaf;
+	return x;
+}
+
+static YMD_INLINE void rmnode(struct ymd_mach *vm, struct btnd *x) {
+	mm_free(vm, x, 1, x->leaf ? sizeof(struct btlf) : sizeof(struct btin));
+}
+
+ymd_int_t btre_key_compare(struct ymd_mach *vm, const struct btre *o,
+		const struct variable *lhs, const struct variable *rhs) {
+	ymd_int_t rv;
+	struct ymd_context *l;
+	if (o->cmp == SKLS_ASC || o->cmp == SKLS_DASC) {
+		// Integer keys need no calling.
+		if (var_tt(lhs) == T_INT && var_tt(rhs) == T_INT)
+			rv = (var_int(lhs) > var_int(rhs)) - (var_int(lhs) < var_int(rhs));
+		else
+			rv = compare(lhs, rhs);
+		return o->cmp == SKLS_ASC ? rv : -rv;
+	}
+	l = ioslate(vm);
+	setv_func(ymd_push(l), o->cmp);
+	*ymd_push(l) = *lhs;
+	*ymd_push(l) = *rhs;
+	rv = ymd_call(l, o->cmp, 2, 0);
+	if (!rv)
+		ymd_panic(l, "btre_key_compare() Bad comparing function");
+	rv = int4of(l, ymd_top(l, 0));
+	ymd_pop(l, 1);
+	return rv;
+}
+
+// Binary search in node: number of keys less than `k', or if `upper',
+// number of keys less or equal than `k'.
+static int search(struct ymd_mach *vm, const struct btre *o,
+		const struct btnd *x, const struct variable *k, int upper) {
+	int lo = 0, hi = x->n;
+	while (lo < hi) {
+		int mid = (lo + hi) >> 1;
+		ymd_int_t rv = btre_key_compare(vm, o, x->k + mid, k);
+		if (rv < 0 || (upper && rv == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// Walk down to leaf of `k', path[d] and slot[d] are the internal node and
+// child index in level `d'.
+static struct btlf *descend(struct ymd_mach *vm, const struct btre *o,
+		const struct variable *k, struct btin *path[MAX_HEIGHT],
+		int slot[MAX_HEIGHT]) {
+	struct btnd *x = o->root;
+	int d;
+	for (d = 0; d < o->height - 1; ++d) {
+		int i = search(vm, o, x, k, 1);
+		if (path) {
+			path[d] = btin_f(x);
+			slot[d] = i;
+		}
+		x = btin_f(x)->child[i];
+	}
+	assert (x->leaf);
+	return btlf_f(x);
+}
+
+// Walk down the rightmost path to the last leaf, no comparing.
+static struct btlf *descend_last(const struct btre *o,
+		struct btin *path[MAX_HEIGHT], int slot[MAX_HEIGHT]) {
+	struct btnd *x = o->root;
+	int d;
+	for (d = 0; d < o->height - 1; ++d) {
+		path[d] = btin_f(x);
+		slot[d] = x->n;
+		x = btin_f(x)->child[x->n];
+	}
+	assert (x->leaf);
+	return btlf_f(x);
+}
+
+struct btre *btre_new(struct ymd_mach *vm, struct func *order) {
+	struct btre *x = gc_new(vm, sizeof(struct btre), T_BTRE);
+	x->cmp = order;
+	x->height = 0;
+	x->root = NULL;
+	x->first = NULL;
+	x->last = NULL;
+	return x;
+}
+
+static void free_node(struct ymd_mach *vm, struct btnd *x) {
+	int i;
+	if (!x->leaf)
+		for (i = 0; i <= x->n; ++i)
+			free_node(vm, btin_f(x)->child[i]);
+	rmnode(vm, x);
+}
+
+void btre_final(struct ymd_mach *vm, struct btre *o) {
+	if (o->root)
+		free_node(vm, o->root);
+}
+
+int btre_equals(const struct btre *o, const struct btre *rhs) {
+	const struct btlf *x, *y;
+	int i, j;
+	if (o == rhs)
+		return 1;
+	if (o->count != rhs->count)
+		return 0;
+	// Both in their own order, only same ordering trees can be equal.
+	if (o->cmp != rhs->cmp)
+		return 0;
+	x = o->first; i = 0;
+	y = rhs->first; j = 0;
+	while (x && y) {
+		if (!equals(x->nd.k + i, y->nd.k + j) || !equals(x->v + i, y->v + j))
+			return 0;
+		if (++i >= x->nd.n) { x = x->next; i = 0; }
+		if (++j >= y->nd.n) { y = y->next; j = 0; }
+	}
+	return 1;
+}
+
+int btre_compare(const struct btre *o, const struct btre *rhs) {
+	const struct btlf *x, *y;
+	int i, j, rv;
+	if (o == rhs)
+		return 0;
+	x = o->first; i = 0;
+	y = rhs->first; j = 0;
+	while (x && y) {
+		if ((rv = compare(x->nd.k + i, y->nd.k + j)) != 0 ||
+			(rv = compare(x->v + i, y->v + j)) != 0)
+			return rv;
+		if (++i >= x->nd.n) { x = x->next; i = 0; }
+		if (++j >= y->nd.n) { y = y->next; j = 0; }
+	}
+	return (x != NULL) - (y != NULL);
+}
+
+// Put `right' and its first key `k' after child[`slot[d]'] of `path[d]'.
+static void insert_parent(struct ymd_mach *vm, struct btre *o,
+		struct btin *path[], int slot[], int d, struct btnd *right,
+		const struct variable *k) {
+	struct variable key[BTRE_MAX + 1];
+	struct btnd *child[BTRE_MAX + 2];
+	struct btin *x, *y;
+	int i, n, mid;
+	if (d < 0) { // New root
+		x = btin_f(mknode(vm, 0));
+		x->nd.n = 1;
+		x->nd.k[0] = *k;
+		x->child[0] = o->root;
+		x->child[1] = right;
+		o->root = &x->nd;
+		++o->height;
+		return;
+	}
+	x = path[d];
+	i = slot[d];
+	n = x->nd.n;
+	if (n < BTRE_MAX) {
+		memmove(x->nd.k + i + 1, x->nd.k + i, (n - i) * sizeof(*key));
+		memmove(x->child + i + 2, x->child + i + 1,
+		        (n - i) * sizeof(*child));
+		x->nd.k[i] = *k;
+		x->child[i + 1] = right;
+		++x->nd.n;
+		return;
+	}
+	// Full: split `BTRE_MAX + 1' keys to 2 nodes, middle one goes up.
+	memcpy(key, x->nd.k, i * sizeof(*key));
+	key[i] = *k;
+	memcpy(key + i + 1, x->nd.k + i, (n - i) * sizeof(*key));
+	memcpy(child, x->child, (i + 1) * sizeof(*child));
+	child[i + 1] = right;
+	memcpy(child + i + 2, x->child + i + 1, (n - i) * sizeof(*child));
+	mid = (BTRE_MAX + 1) / 2;
+	y = btin_f(mknode(vm, 0));
+	x->nd.n = mid;
+	memcpy(x->nd.k, key, mid * sizeof(*key));
+	memcpy(x->child, child, (mid + 1) * sizeof(*child));
+	y->nd.n = BTRE_MAX - mid;
+	memcpy(y->nd.k, key + mid + 1, y->nd.n * sizeof(*key));
+	memcpy(y->child, child + mid + 1, (y->nd.n + 1) * sizeof(*child));
+	// Clear moved slots, GC never looks at them, but keep them clean.
+	memset(x->nd.k + mid, 0, (BTRE_MAX - mid) * sizeof(*key));
+	memset(x->child + mid + 1, 0, (BTRE_MAX - mid) * sizeof(*child));
+	insert_parent(vm, o, path, slot, d - 1, &y->nd, key + mid);
+}
+
+struct variable *btre_put(struct ymd_mach *vm, struct btre *o,
+		const struct variable *k) {
+	struct btin *path[MAX_HEIGHT];
+	int slot[MAX_HEIGHT], i, n;
+	struct variable key = *k;
+	struct btlf *x;
+	assert (!is_nil(k));
+	if (!o->root) {
+		x = btlf_f(mknode(vm, 1));
+		o->root = &x->nd;
+		o->first = o->last = x;
+		o->height = 1;
+	}
+	x = o->last;
+	// Keys in order (bulk loading) go to the last leaf, only one comparing.
+	if (x->nd.n > 0 &&
+		btre_key_compare(vm, o, x->nd.k + x->nd.n - 1, &key) < 0) {
+		x = descend_last(o, path, slot);
+		i = x->nd.n;
+	} else {
+		x = descend(vm, o, &key, path, slot);
+		i = search(vm, o, &x->nd, &key, 0);
+	}
+	if (i < x->nd.n && btre_key_compare(vm, o, x->nd.k + i, &key) == 0) {
+		x->nd.k[i] = key;
+		return x->v + i;
+	}
+	if (x->nd.n >= BTRE_MAX) { // Split leaf, upper half to a new one.
+		struct btlf *y = btlf_f(mknode(vm, 1));
+		n = BTRE_MAX / 2;
+		y->nd.n = BTRE_MAX - n;
+		memcpy(y->nd.k, x->nd.k + n, y->nd.n * sizeof(key));
+		memcpy(y->v, x->v + n, y->nd.n * sizeof(key));
+		memset(x->nd.k + n, 0, y->nd.n * sizeof(key));
+		memset(x->v + n, 0, y->nd.n * sizeof(key));
+		x->nd.n = n;
+		y->prev = x;
+		y->next = x->next;
+		if (x->next)
+			x->next->prev = y;
+		else
+			o->last = y;
+		x->next = y;
+		insert_parent(vm, o, path, slot, o->height - 2, &y->nd, y->nd.k);
+		if (i > n) {
+			x = y;
+			i -= n;
+		}
+	}
+	n = x->nd.n;
+	memmove(x->nd.k + i + 1, x->nd.k + i, (n - i) * sizeof(key));
+	memmove(x->v + i + 1, x->v + i, (n - i) * sizeof(key));
+	x->nd.k[i] = key;
+	setv_nil(x->v + i);
+	++x->nd.n;
+	++o->count;
+	++o->version;
+	return x->v + i;
+}
+
+struct variable *btre_get(struct ymd_mach *vm, struct btre *o,
+		const struct variable *k) {
+	struct variable key = *k;
+	struct btlf *x;
+	int i;
+	assert (!is_nil(k));
+	if (!o->root)
+		return knil;
+	x = descend(vm, o, &key, NULL, NULL);
+	i = search(vm, o, &x->nd, &key, 0);
+	if (i < x->nd.n && btre_key_compare(vm, o, x->nd.k + i, &key) == 0)
+		return x->v + i;
+	return knil;
+}
+
+// Remove k[i] and child[i + 1] from internal node.
+static void erase_child(struct btin *x, int i) {
+	int n = x->nd.n;
+	memmove(x->nd.k + i, x->nd.k + i + 1, (n - i - 1) * sizeof(*x->nd.k));
+	memmove(x->child + i + 1, x->child + i + 2,
+	        (n - i - 1) * sizeof(*x->child));
+	setv_nil(x->nd.k + n - 1);
+	x->child[n] = NULL;
+	--x->nd.n;
+}
+
+// Move all of `y' into `x', `y' is right after `x' and `sep' is the key
+// between them in parent.
+static void merge(struct ymd_mach *vm, struct btre *o, struct btnd *x,
+		struct btnd *y, const struct variable *sep) {
+	int n = x->n;
+	if (x->leaf) {
+		struct btlf *lx = btlf_f(x), *ly = btlf_f(y);
+		memcpy(x->k + n, y->k, y->n * sizeof(*x->k));
+		memcpy(lx->v + n, ly->v, y->n * sizeof(*lx->v));
+		x->n += y->n;
+		lx->next = ly->next;
+		if (ly->next)
+			ly->next->prev = lx;
+		else
+			o->last = lx;
+	} else {
+		x->k[n] = *sep;
+		memcpy(x->k + n + 1, y->k, y->n * sizeof(*x->k));
+		memcpy(btin_f(x)->child + n + 1, btin_f(y)->child,
+		       (y->n + 1) * sizeof(struct btnd *));
+		x->n += y->n + 1;
+	}
+	rmnode(vm, y);
+}
+
+// Move one key from `y' to `x', `y' is the left (if `left') or right
+// sibling of `x', `sep' is the key between them in parent.
+static void borrow(struct btnd *x, struct btnd *y, struct variable *sep,
+		int left) {
+	int n = x->n;
+	if (left) {
+		memmove(x->k + 1, x->k, n * sizeof(*x->k));
+		if (x->leaf) {
+			memmove(btlf_f(x)->v + 1, btlf_f(x)->v, n * sizeof(*x->k));
+			x->k[0] = y->k[y->n - 1];
+			btlf_f(x)->v[0] = btlf_f(y)->v[y->n - 1];
+			setv_nil(btlf_f(y)->v + y->n - 1);
+			*sep = x->k[0];
+		} else {
+			memmove(btin_f(x)->child + 1, btin_f(x)->child,
+			        (n + 1) * sizeof(struct btnd *));
+			x->k[0] = *sep;
+			btin_f(x)->child[0] = btin_f(y)->child[y->n];
+			btin_f(y)->child[y->n] = NULL;
+			*sep = y->k[y->n - 1];
+		}
+		setv_nil(y->k + y->n - 1);
+	} else {
+		if (x->leaf) {
+			x->k[n] = y->k[0];
+			btlf_f(x)->v[n] = btlf_f(y)->v[0];
+			memmove(btlf_f(y)->v, btlf_f(y)->v + 1,
+			        (y->n - 1) * sizeof(*y->k));
+			setv_nil(btlf_f(y)->v + y->n - 1);
+			memmove(y->k, y->k + 1, (y->n - 1) * sizeof(*y->k));
+			*sep = y->k[0];
+		} else {
+			x->k[n] = *sep;
+			btin_f(x)->child[n + 1] = btin_f(y)->child[0];
+			*sep = y->k[0];
+			memmove(y->k, y->k + 1, (y->n - 1) * sizeof(*y->k));
+			memmove(btin_f(y)->child, btin_f(y)->child + 1,
+			        y->n * sizeof(struct btnd *));
+			btin_f(y)->child[y->n] = NULL;
+		}
+		setv_nil(y->k + y->n - 1);
+	}
+	++x->n;
+	--y->n;
+}
+
+// Node `x' in level `d + 1' is less than half full.
+static void rebalance(struct ymd_mach *vm, struct btre *o,
+		struct btin *path[], int slot[], int d, struct btnd *x) {
+	struct btin *p;
+	int i;
+	if (d < 0) { // Root
+		if (!x->leaf && x->n == 0) {
+			o->root = btin_f(x)->child[0];
+			--o->height;
+			rmnode(vm, x);
+		}
+		return;
+	}
+	p = path[d];
+	i = slot[d];
+	if (i > 0 && p->child[i - 1]->n > BTRE_MIN) {
+		borrow(x, p->child[i - 1], p->nd.k + i - 1, 1);
+		return;
+	}
+	if (i < p->nd.n && p->child[i + 1]->n > BTRE_MIN) {
+		borrow(x, p->child[i + 1], p->nd.k + i, 0);
+		return;
+	}
+	if (i > 0) {
+		merge(vm, o, p->child[i - 1], x, p->nd.k + i - 1);
+		erase_child(p, i - 1);
+	} else {
+		merge(vm, o, x, p->child[i + 1], p->nd.k + i);
+		erase_child(p, i);
+	}
+	if (p->nd.n < BTRE_MIN)
+		rebalance(vm, o, path, slot, d - 1, &p->nd);
+}
+
+int btre_remove(struct ymd_mach *vm, struct btre *o,
+		const struct variable *k) {
+	struct btin *path[MAX_HEIGHT];
+	int slot[MAX_HEIGHT], i, n;
+	struct variable key = *k;
+	struct btlf *x;
+	if (!o->root)
+		return 0;
+	x = descend(vm, o, &key, path, slot);
+	i = search(vm, o, &x->nd, &key, 0);
+	if (i >= x->nd.n || btre_key_compare(vm, o, x->nd.k + i, &key) != 0)
+		return 0;
+	n = x->nd.n;
+	memmove(x->nd.k + i, x->nd.k + i + 1, (n - i - 1) * sizeof(*k));
+	memmove(x->v + i, x->v + i + 1, (n - i - 1) * sizeof(*k));
+	setv_nil(x->nd.k + n - 1);
+	setv_nil(x->v + n - 1);
+	--x->nd.n;
+	--o->count;
+	++o->version;
+	if (o->height == 1) {
+		if (x->nd.n == 0) {
+			rmnode(vm, &x->nd);
+			o->root = NULL;
+			o->first = o->last = NULL;
+			o->height = 0;
+		}
+		return 1;
+	}
+	if (x->nd.n < BTRE_MIN)
+		rebalance(vm, o, path, slot, o->height - 2, &x->nd);
+	return 1;
+}
+
+int btre_direct(struct ymd_mach *vm, const struct btre *o,
+		const struct variable *k, struct btlf **lf) {
+	struct variable key = *k;
+	struct btlf *x;
+	int i;
+	if (!o->root) {
+		*lf = NULL;
+		return 0;
+	}
+	x = descend(vm, o, &key, NULL, NULL);
+	i = search(vm, o, &x->nd, &key, 0);
+	if (i >= x->nd.n) {
+		x = x->next;
+		i = 0;
+	}
+	*lf = x;
+	return i;
+}
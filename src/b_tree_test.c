@@ -0,0 +1,155 @@
+#include "core.h"
+#include "yut_rand.h"
+#include "b_tree_test.def"
+
+static struct ymd_mach *setup() {
+	struct ymd_mach *vm = ymd_init();
+	gc_active(vm, +1);
+	return vm;
+}
+
+static void teardown(struct ymd_mach *vm) {
+	gc_active(vm, -1);
+	ymd_final(vm);
+}
+
+#define BENCHMARK_COUNT 100000
+
+// Check node size, key order and separators, returns number of pairs.
+static int check_node(struct ymd_mach *vm, const struct btre *o,
+		const struct btnd *x, const struct variable *lo,
+		const struct variable *hi, int depth, int *leaf_depth) {
+	int i, n = 0;
+	if (x != o->root && x->n < BTRE_MIN)
+		return -1;
+	for (i = 0; i < x->n; ++i) {
+		if (i > 0 && btre_key_compare(vm, o, x->k + i - 1, x->k + i) >= 0)
+			return -1;
+		if (lo && btre_key_compare(vm, o, x->k + i, lo) < 0)
+			return -1;
+		if (hi && btre_key_compare(vm, o, x->k + i, hi) >= 0)
+			return -1;
+	}
+	if (x->leaf) {
+		if (*leaf_depth < 0)
+			*leaf_depth = depth;
+		return *leaf_depth == depth ? x->n : -1;
+	}
+	for (i = 0; i <= x->n; ++i) {
+		int rv = check_node(vm, o, ((const struct btin *)x)->child[i],
+		                    i > 0 ? x->k + i - 1 : lo,
+		                    i < x->n ? x->k + i : hi, depth + 1, leaf_depth);
+		if (rv < 0)
+			return -1;
+		n += rv;
+	}
+	return n;
+}
+
+static int check_btre(struct ymd_mach *vm, const struct btre *o) {
+	int leaf_depth = -1;
+	if (!o->root)
+		return o->count == 0 && o->height == 0 ? 0 : -1;
+	if (check_node(vm, o, o->root, NULL, NULL, 1, &leaf_depth) != o->count)
+		return -1;
+	return leaf_depth == o->height ? 0 : -1;
+}
+
+static int test_btre_sequence(struct ymd_mach *vm) {
+	struct btre *bt = btre_new(vm, SKLS_ASC);
+	struct btlf *x;
+	int i = BENCHMARK_COUNT, j;
+	while (i--) {
+		struct variable k;
+		setv_int(&k, i);
+		setv_int(btre_put(vm, bt, &k), BENCHMARK_COUNT - 1 - i);
+	}
+	EXPECT_EQ(int, bt->count, BENCHMARK_COUNT);
+	ASSERT_EQ(int, check_btre(vm, bt), 0);
+	i = 0;
+	for (x = bt->first; x != NULL; x = x->next) {
+		for (j = 0; j < x->nd.n; ++j) {
+			ASSERT_EQ(large, var_int(x->nd.k + j), i);
+			ASSERT_EQ(large, var_int(x->v + j), BENCHMARK_COUNT - 1 - i);
+			++i;
+		}
+	}
+	EXPECT_EQ(int, i, BENCHMARK_COUNT);
+	// Backward
+	for (x = bt->last; x != NULL; x = x->prev) {
+		for (j = x->nd.n - 1; j >= 0; --j)
+			ASSERT_EQ(large, var_int(x->nd.k + j), --i);
+	}
+	EXPECT_EQ(int, i, 0);
+	return 0;
+}
+
+static int test_btre_random(struct ymd_mach *vm) {
+	struct btre *bt = btre_new(vm, SKLS_DASC);
+	static char had[BENCHMARK_COUNT];
+	struct variable k;
+	int i, count = 0;
+	unsigned seed = 1;
+	memset(had, 0, sizeof(had));
+	for (i = 0; i < BENCHMARK_COUNT * 2; ++i) {
+		int r;
+		seed = seed * 1103515245U + 12345U;
+		r = (int)((seed >> 8) % BENCHMARK_COUNT);
+		setv_int(&k, r);
+		if ((seed >> 4) & 1) {
+			ASSERT_EQ(int, btre_remove(vm, bt, &k), had[r]);
+			count -= had[r];
+			had[r] = 0;
+		} else {
+			setv_int(btre_put(vm, bt, &k), r);
+			count += !had[r];
+			had[r] = 1;
+		}
+	}
+	ASSERT_EQ(int, bt->count, count);
+	ASSERT_EQ(int, check_btre(vm, bt), 0);
+	for (i = 0; i < BENCHMARK_COUNT; ++i) {
+		struct variable *v;
+		setv_int(&k, i);
+		v = btre_get(vm, bt, &k);
+		if (had[i]) {
+			ASSERT_EQ(large, var_int(v), i);
+		} else {
+			ASSERT_TRUE(is_nil(v));
+		}
+	}
+	// Remove all, merges down to an empty tree.
+	for (i = 0; i < BENCHMARK_COUNT; ++i) {
+		setv_int(&k, i);
+		ASSERT_EQ(int, btre_remove(vm, bt, &k), had[i]);
+		if (i % 9973 == 0)
+			ASSERT_EQ(int, check_btre(vm, bt), 0);
+	}
+	ASSERT_EQ(int, bt->count, 0);
+	ASSERT_NULL(bt->root);
+	ASSERT_NULL(bt->first);
+	ASSERT_EQ(int, check_btre(vm, bt), 0);
+	return 0;
+}
+
+static int test_btre_direct(struct ymd_mach *vm) {
+	struct btre *bt = btre_new(vm, SKLS_ASC);
+	struct variable k;
+	struct btlf *x;
+	int i;
+	for (i = 0; i < 1000; i += 2) {
+		setv_int(&k, i);
+		setv_int(btre_put(vm, bt, &k), i);
+	}
+	setv_int(&k, 101);
+	i = btre_direct(vm, bt, &k, &x);
+	ASSERT_NOTNULL(x);
+	ASSERT_EQ(large, var_int(x->nd.k + i), 102);
+	setv_int(&k, 100);
+	i = btre_direct(vm, bt, &k, &x);
+	ASSERT_EQ(large, var_int(x->nd.k + i), 100);
+	setv_int(&k, 999);
+	btre_direct(vm, bt, &k, &x);
+	ASSERT_NULL(x);
+	return 0;
+}
@@ -12,6 +12,12 @@ struct kvi;
 struct hmap;
 struct sknd;
 struct skls;
+struct btre;
+struct pkay;
+struct dequ;
+struct heap;
+struct hset;
+struct lruc;
 
 typedef long long          ymd_int_t;
 typedef unsigned long long ymd_uint_t;
@@ -51,4 +57,18 @@ typedef unsigned short     ushort_t;
 #	define YMD_NORETURN
 #endif
 
+// Index of the lowest set bit, `bits' must not be 0.
+static YMD_INLINE int ymd_lowest_bit(ymd_uint_t bits) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(bits);
+#else
+	int i = 0;
+	while (!(bits & 1ULL)) {
+		bits >>= 1;
+		++i;
+	}
+	return i;
+#endif
+}
+
 #endif // YMD_BUILTIN_H
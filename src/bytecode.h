@@ -22,13 +22,14 @@
 #define I_FORSTEP 75 // forstep label
 #define I_INC     80 // inc local|up|off|index|field
 #define I_DEC     85 // dec local|up|off|index|field
-#define I_STRCAT  90 // strcat
+#define I_STRCAT  90 // strcat n
 // reserved 95~115
 #define I_SHIFT   120 // shift l|r, a|l
 #define I_CALL    125 // call a, n
 #define I_NEWMAP  130 // newmap n
 #define I_NEWSKL  135 // newskl order, n
 #define I_NEWDYA  140 // newdya
+#define I_NEWBTR  145 // newbtr order, n
 
 // jne/jmp
 #define F_FORWARD  0 // param: Number of instructions
@@ -79,10 +80,16 @@
 #define F_INVB  10 // ~x
 #define F_NOT   11 // not x
 
+// hash map
+#define F_HASH  0 // order by hash
+#define F_ORDER 1 // order by inserting
+
 // skip list
 #define F_ASC   0 // order by asc
 #define F_DASC  1 // order by dasc
 #define F_USER  2 // order by user defined function
+#define F_ASC_KEY  3 // order by asc of key function's result
+#define F_DASC_KEY 4 // order by dasc of key function's result
 
 static YMD_INLINE uint_t asm_build(
 	uchar_t op,
@@ -10,7 +10,6 @@
 	int __k = func_nlocal(l->info->run); \
 	memset((x), 0, sizeof(*(x))); \
 	(x)->loc = l->info->loc + __k; \
-	memset((x)->loc, 0, __k * sizeof(*(x)->loc)); \
 } (void)0
 
 #define call_root_init(l, x) { \
@@ -51,9 +50,14 @@ static void do_put(struct ymd_mach *vm, struct gc_node *raw,
 	case T_HMAP:
 		*hmap_put(vm, (struct hmap *)raw, k) = *v;
 		break;
-	case T_SKLS:
-		*skls_put(vm, (struct skls *)raw, k) = *v;
-		break;
+	case T_SKLS: {
+		struct variable x = *v; // Same as vm_iput()
+		*skls_put(vm, (struct skls *)raw, k) = x;
+		} break;
+	case T_BTRE: {
+		struct variable x = *v;
+		*btre_put(vm, (struct btre *)raw, k) = x;
+		} break;
 	case T_DYAY:
 		*dyay_add(vm, (struct dyay *)raw) = *v;
 		break;
@@ -65,12 +69,48 @@ static void do_put(struct ymd_mach *vm, struct gc_node *raw,
 
 static void vm_iput(struct ymd_mach *vm, struct variable *var,
 		const struct variable *k, const struct variable *v) {
+	struct variable x;
 	if (is_nil(k))
 		ymd_panic(ioslate(vm), "Key can not be `nil' in k-v pair");
-	if (is_nil(v))
+	if (ymd_type(var) == T_PKAY) {
+		vm_pkay_set(vm, var, k, v);
+		return;
+	}
+	// s[k] = true adds `k' to set `s', s[k] = false or nil removes it.
+	if (ymd_type(var) == T_HSET) {
+		if (vm_bool(v))
+			hset_put(vm, hset_x(var), k);
+		else
+			hset_remove(vm, hset_x(var), k);
+		return;
+	}
+	if (is_nil(v)) {
 		vm_remove(vm, var, k);
-	else
-		*vm_put(vm, var, k) = *v;
+		return;
+	}
+	// Putting may evict pairs and call the eviction function.
+	if (ymd_type(var) == T_LRUC) {
+		lruc_put(vm, lruc_x(var), k, v);
+		return;
+	}
+	x = *v; // A skip list may call script to put, which may move the stack.
+	*vm_put(vm, var, k) = x;
+}
+
+// `a[i] += x' changed a copy of packed array's element, put it back.
+static YMD_INLINE void vm_iback(struct ymd_context *l, uint_t inst,
+		const struct variable *lhs) {
+	if (asm_flag(inst) == F_INDEX && ymd_type(ymd_top(l, 2)) == T_PKAY)
+		vm_pkay_set(l->vm, ymd_top(l, 2), ymd_top(l, 1), lhs);
+}
+
+// `a[i]++' changes the element in place, a slice must not change elements
+// shared with others.
+static YMD_INLINE struct variable *vm_iaddr(struct ymd_mach *vm,
+		struct variable *var, const struct variable *k) {
+	if (ymd_type(var) == T_DYAY)
+		dyay_own(vm, dyay_x(var));
+	return vm_get(vm, var, k);
 }
 
 static YMD_INLINE const struct variable *do_keyz(struct func *fn, int i,
@@ -138,9 +178,9 @@ static int vm_close_upval(struct ymd_context *l, struct func *fn) {
 // Operand is zero?
 static YMD_INLINE int vm_zero(const struct variable *var) {
 	if (ymd_type(var) == T_INT)
-		return var->u.i == 0LL;
+		return var_int(var) == 0LL;
 	if (ymd_type(var) == T_FLOAT)
-		return var->u.f == 0.0f;
+		return var_float(var) == 0.0f;
 	return 0;
 }
 
@@ -148,20 +188,20 @@ static YMD_INLINE int vm_zero(const struct variable *var) {
 	if (floatize(lhs, rhs))                                   \
 		setv_float(lhs, float4of(l, lhs) + float4of(l, rhs)); \
 	else                                                      \
-		lhs->u.i = int4of(l, lhs) + int4of(l, rhs)
+		setv_int(lhs, int4of(l, lhs) + int4of(l, rhs))
 
 #define IMPL_SUB(lhs, rhs)                                    \
 	if (floatize(lhs, rhs))                                   \
 		setv_float(lhs, float4of(l, lhs) - float4of(l, rhs)); \
 	else                                                      \
-		lhs->u.i = int4of(l, lhs) - int4of(l, rhs)
+		setv_int(lhs, int4of(l, lhs) - int4of(l, rhs))
 
 static int vm_calc(struct ymd_context *l, unsigned op) {
 	switch (op) {
 	case F_INV: {
 		struct variable *opd = ymd_top(l, 0);
 		if (ymd_type(opd) == T_INT)
-			setv_int(opd, opd->u.i);
+			setv_int(opd, var_int(opd));
 		else
 			setv_float(opd, float4of(l, opd));
 		} break;
@@ -171,7 +211,7 @@ static int vm_calc(struct ymd_context *l, unsigned op) {
 		if (floatize(lhs, rhs))
 			setv_float(lhs, float4of(l, lhs) * float4of(l, rhs));
 		else
-			lhs->u.i = int4of(l, lhs) * int4of(l, rhs);
+			setv_int(lhs, int4of(l, lhs) * int4of(l, rhs));
 		ymd_pop(l, 1);
 		} break;
 	case F_DIV: {
@@ -182,7 +222,7 @@ static int vm_calc(struct ymd_context *l, unsigned op) {
 		if (floatize(lhs, rhs))
 			setv_float(lhs, float4of(l, lhs) / float4of(l, rhs));
 		else
-			lhs->u.i = int4of(l, lhs) / int4of(l, rhs);
+			setv_int(lhs, int4of(l, lhs) / int4of(l, rhs));
 		ymd_pop(l, 1);
 		} break;
 	case F_ADD: {
@@ -203,30 +243,30 @@ static int vm_calc(struct ymd_context *l, unsigned op) {
 		ymd_int_t opd1 = int_of(l, lhs);
 		if (opd1 == 0LL)
 			ymd_panic(l, "Mod to zero");
-		rhs->u.i = int_of(l, rhs) % int_of(l, lhs);
+		setv_int(rhs, int_of(l, rhs) % int_of(l, lhs));
 		ymd_pop(l, 1);
 		} break;
 	case F_ANDB: {
 		struct variable *rhs = ymd_top(l, 1),
 						*lhs = ymd_top(l, 0);
-		rhs->u.i = int_of(l, rhs) & int_of(l, lhs);
+		setv_int(rhs, int_of(l, rhs) & int_of(l, lhs));
 		ymd_pop(l, 1);
 		} break;
 	case F_ORB: {
 		struct variable *rhs = ymd_top(l, 1),
 						*lhs = ymd_top(l, 0);
-		rhs->u.i = int_of(l, rhs) | int_of(l, lhs);
+		setv_int(rhs, int_of(l, rhs) | int_of(l, lhs));
 		ymd_pop(l, 1);
 		} break;
 	case F_XORB: {
 		struct variable *rhs = ymd_top(l, 1),
 						*lhs = ymd_top(l, 0);
-		rhs->u.i = int_of(l, rhs) ^ int_of(l, lhs);
+		setv_int(rhs, int_of(l, rhs) ^ int_of(l, lhs));
 		ymd_pop(l, 1);
 		} break;
 	case F_INVB: {
 		struct variable *opd0 = ymd_top(l, 0);
-		opd0->u.i = ~opd0->u.i;
+		setv_int(opd0, ~int_of(l, opd0));
 		} break;
 	case F_NOT: {
 		struct variable *opd = ymd_top(l, 0);
@@ -261,7 +301,7 @@ static int vm_calc(struct ymd_context *l, unsigned op) {
 		lhs = hmap_put(vm, vm->global, core->kval + asm_param(inst));  \
 		break;                                                         \
 	case F_INDEX:                                                      \
-		lhs = vm_get(vm, ymd_top(l, 2), ymd_top(l, 1));                \
+		lhs = vm_iaddr(vm, ymd_top(l, 2), ymd_top(l, 1));              \
 		pop += 2;                                                      \
 		break;                                                         \
 	case F_FIELD:                                                      \
@@ -365,6 +405,7 @@ retry:
 			int pop = 1;
 			IMPL_ADDR(lhs, pop);
 			IMPL_ADD(lhs, rhs);
+			vm_iback(l, inst, lhs);
 			ymd_pop(l, pop);
 			} break;
 		case I_DEC: {
@@ -372,6 +413,7 @@ retry:
 			int pop = 1;
 			IMPL_ADDR(lhs, pop);
 			IMPL_SUB(lhs, rhs);
+			vm_iback(l, inst, lhs);
 			ymd_pop(l, pop);
 			} break;
 		case I_RET:
@@ -435,22 +477,22 @@ retry:
 							*rhs = ymd_top(l, 0);
 			switch (asm_flag(inst)) {
 			case F_EQ:
-				lhs->u.i = vm_equals(lhs, rhs);
+				setv_bool(lhs, vm_equals(lhs, rhs));
 				break;
 			case F_NE:
-				lhs->u.i = !vm_equals(lhs, rhs);
+				setv_bool(lhs, !vm_equals(lhs, rhs));
 				break;
 			case F_GT:
-				lhs->u.i = vm_compare(lhs, rhs) > 0;
+				setv_bool(lhs, vm_compare(lhs, rhs) > 0);
 				break;
 			case F_GE:
-				lhs->u.i = vm_compare(lhs, rhs) >= 0;
+				setv_bool(lhs, vm_compare(lhs, rhs) >= 0);
 				break;
 			case F_LT:
-				lhs->u.i = vm_compare(lhs, rhs) < 0;
+				setv_bool(lhs, vm_compare(lhs, rhs) < 0);
 				break;
 			case F_LE:
-				lhs->u.i = vm_compare(lhs, rhs) <= 0;
+				setv_bool(lhs, vm_compare(lhs, rhs) <= 0);
 				break;
 			//TODO: New regex implement 
 			// case F_MATCH:
@@ -459,7 +501,6 @@ retry:
 				assert(!"No reached.");
 				break;
 			}
-			lhs->tt = T_BOOL;
 			ymd_pop(l, 1);
 			} break;
 		case I_TYPEOF: {
@@ -471,22 +512,10 @@ retry:
 			vm_calc(l, asm_flag(inst));
 			break;
 		case I_STRCAT: {
-			struct variable *lhs = ymd_top(l, 1),
-							*rhs = ymd_top(l, 0);
-			if (ymd_type(lhs) != T_KSTR) {
-				struct zostream os = ZOS_INIT;
-				tostring(&os, lhs);
-				setv_kstr(lhs, kstr_fetch(vm, zos_buf(&os), os.last));
-				zos_final(&os);
-			}
-			if (ymd_type(rhs) != T_KSTR) {
-				struct zostream os = ZOS_INIT;
-				tostring(&os, rhs);
-				setv_kstr(rhs, kstr_fetch(vm, zos_buf(&os), os.last));
-				zos_final(&os);
-			}
-			setv_kstr(lhs, vm_strcat(vm, kstr_k(lhs), kstr_k(rhs)));
-			ymd_pop(l, 1);
+			int n = asm_param(inst);
+			struct variable *argv = ymd_top(l, n - 1);
+			setv_kstr(argv, vm_strcat(vm, argv, n));
+			ymd_pop(l, n - 1);
 			gc_step(vm);
 			} break;
 		case I_SHIFT: {
@@ -496,13 +525,13 @@ retry:
 				ymd_panic(l, "Shift must be great than 0");
 			switch (asm_flag(inst)) {
 			case F_LEFT:
-				rhs->u.i = int_of(l, rhs) << int_of(l, lhs);
+				setv_int(rhs, int_of(l, rhs) << int_of(l, lhs));
 				break;
 			case F_RIGHT_L:
-				rhs->u.i = ((ymd_uint_t)int_of(l, rhs)) >> int_of(l, lhs);
+				setv_int(rhs, ((ymd_uint_t)int_of(l, rhs)) >> int_of(l, lhs));
 				break;
 			case F_RIGHT_A:
-				rhs->u.i = int_of(l, rhs) >> int_of(l, lhs);
+				setv_int(rhs, int_of(l, rhs) >> int_of(l, lhs));
 				break;
 			default:
 				assert(!"No reached.");
@@ -531,16 +560,25 @@ retry:
 				gc_step(vm);
 			} break;
 		case I_NEWMAP: {
-			struct hmap *map = hmap_new(vm, asm_param(inst));
+			struct hmap *map;
 			int i, n = asm_param(inst) * 2;
-			for (i = 0; i < n; i += 2)
-				do_put(vm, gcx(map), ymd_top(l, i + 1), ymd_top(l, i));
+			if (asm_flag(inst) == F_ORDER) {
+				map = hmap_new_ordered(vm, asm_param(inst));
+				// Put pairs by order in literal.
+				for (i = n - 2; i >= 0; i -= 2)
+					do_put(vm, gcx(map), ymd_top(l, i + 1), ymd_top(l, i));
+			} else {
+				map = hmap_new(vm, asm_param(inst));
+				for (i = 0; i < n; i += 2)
+					do_put(vm, gcx(map), ymd_top(l, i + 1), ymd_top(l, i));
+			}
 			ymd_pop(l, n);
 			setv_hmap(ymd_push(l), map);
 			gc_step(vm);
 			} break;
 		case I_NEWSKL: {
 			struct skls *map;
+			struct skls_loader ld;
 			int i, n = asm_param(inst) * 2;
 			switch (asm_flag(inst)) {
 			case F_ASC:
@@ -552,18 +590,32 @@ retry:
 			case F_USER:
 				map = skls_new(vm, func_of(l, ymd_top(l, n)));
 				break;
+			case F_ASC_KEY:
+				map = skls_new_key(vm, SKLS_ASC, func_of(l, ymd_top(l, n)));
+				break;
+			case F_DASC_KEY:
+				map = skls_new_key(vm, SKLS_DASC, func_of(l, ymd_top(l, n)));
+				break;
 			default:
 				assert (!"No reached.");
 				break;
 			}
-			map->marked = GC_FIXED;
-			for (i = 0; i < n; i += 2)
-				do_put(vm, gcx(map), ymd_top(l, i + 1), ymd_top(l, i));
-			ymd_pop(l, n);
-			if (map->cmp != SKLS_ASC && map->cmp != SKLS_DASC)
-				ymd_pop(l, 1); // pop the comparor.
+			// Keep it in stack while putting: a fixed object is not
+			// marked, but cached key function results are only in it.
+			setv_skls(ymd_push(l), map);
+			// Put pairs by order in literal: a sorted literal is linked
+			// without searching.
+			skls_load_begin(&ld, map);
+			for (i = n - 2; i >= 0; i -= 2) {
+				struct variable x = *ymd_top(l, i + 1);
+				if (is_nil(ymd_top(l, i + 2)) || is_nil(&x))
+					ymd_panic(l, "Value can not be `nil` in k-v pair");
+				*skls_load(vm, &ld, ymd_top(l, i + 2)) = x;
+			}
+			ymd_pop(l, n + 1);
+			if (map->key || (map->cmp != SKLS_ASC && map->cmp != SKLS_DASC))
+				ymd_pop(l, 1); // pop the comparor or key function.
 			setv_skls(ymd_push(l), map);
-			map->marked = l->vm->gc.white;
 			gc_step(vm);
 			} break;
 		case I_NEWDYA: {
@@ -575,6 +627,32 @@ retry:
 			setv_dyay(ymd_push(l), map);
 			gc_step(vm);
 			} break;
+		case I_NEWBTR: {
+			struct btre *map;
+			int i, n = asm_param(inst) * 2;
+			switch (asm_flag(inst)) {
+			case F_ASC:
+				map = btre_new(vm, SKLS_ASC);
+				break;
+			case F_DASC:
+				map = btre_new(vm, SKLS_DASC);
+				break;
+			case F_USER:
+				map = btre_new(vm, func_of(l, ymd_top(l, n)));
+				break;
+			default:
+				assert (!"No reached.");
+				break;
+			}
+			setv_btre(ymd_push(l), map); // Same as I_NEWSKL
+			for (i = 0; i < n; i += 2)
+				do_put(vm, gcx(map), ymd_top(l, i + 2), ymd_top(l, i + 1));
+			ymd_pop(l, n + 1);
+			if (map->cmp != SKLS_ASC && map->cmp != SKLS_DASC)
+				ymd_pop(l, 1); // pop the comparor.
+			setv_btre(ymd_push(l), map);
+			gc_step(vm);
+			} break;
 		default:
 			assert(!"No reached.");
 			break;
@@ -617,14 +695,13 @@ static void vm_copy_args(struct ymd_context *l, struct func *fn, int argc,
 	l->info->adjust = adjust;
 }
 
+// Drop `n' arguments under `rv' return variables.
 static void vm_balance(struct ymd_context *l, int n, int rv) {
 	if (rv) {
-		struct variable ret = *ymd_top(l, 0);
-		ymd_pop(l, n + 1);
-		*ymd_push(l) = ret;
-	} else {
-		ymd_pop(l, n);
+		struct variable *ret = ymd_top(l, rv - 1);
+		memmove(ret - n, ret, rv * sizeof(*ret));
 	}
+	ymd_pop(l, n);
 	l->info->u.frame = 0;
 }
 
@@ -638,6 +715,10 @@ static int vm_call(struct ymd_context *l, struct call_info *ci,
 	ci->run = fn;
 	ci->chain = l->info;
 	l->info = ci;
+	// Clear locals: returned calls left dead ones in them, but they are
+	// marked by collector.
+	if (!fn->is_c)
+		memset(ci->loc, 0, func_nlocal(fn) * sizeof(*ci->loc));
 	vm_copy_args(l, fn, argc, method);
 	// Run this function
 	if (fn->is_c) {
@@ -51,7 +51,7 @@ int blk_kval(struct ymd_mach *vm, struct chunk *core, struct hmap *map,
 		return core->kkval++;
 	}
 	assert (ymd_type(val) == T_INT);
-	return (int)val->u.i;
+	return (int)var_int(val);
 }
 
 void blk_final(struct ymd_mach *vm, struct chunk *core) {
@@ -518,21 +518,35 @@ out:
 	ymk_emitOP(p, I_NEWDYA, count);
 }
 
-static void parse_map(struct ymd_parser *p, int ord) {
+// `lead': '{' hash map, '%' ordered hash map, '@' skip list,
+// '@@' B+ tree
+static void parse_map(struct ymd_parser *p, int lead) {
 	ushort_t count = 0;
-	uchar_t order = F_ASC;
-	if (ord) { // is skip list
+	uchar_t order = lead == '%' ? F_ORDER : F_ASC;
+	int btree = 0;
+	if (lead == '%')
+		ymc_match(p, '%');
+	if (lead == '@') { // is skip list
 		ymc_match(p, '@');
+		btree = ymc_test(p, '@');
 		if (ymc_peek(p) == '[') {
 			ymc_next(p);
 			switch (ymc_peek(p)) {
 			case '<':
 				ymc_next(p);
 				order = F_ASC;
+				if (ymc_peek(p) != ']') { // Order by key function
+					parse_expr(p, 0);
+					order = F_ASC_KEY;
+				}
 				break;
 			case '>':
 				ymc_next(p);
 				order = F_DASC;
+				if (ymc_peek(p) != ']') {
+					parse_expr(p, 0);
+					order = F_DASC_KEY;
+				}
 				break;
 			default:
 				// Order by user defined function
@@ -541,6 +555,8 @@ static void parse_map(struct ymd_parser *p, int ord) {
 				break;
 			}
 			ymc_match(p, ']');
+			if (btree && (order == F_ASC_KEY || order == F_DASC_KEY))
+				ymc_fail(p, "B+ tree can not order by key function.");
 		}
 	}
 	ymc_match(p, '{');
@@ -579,10 +595,12 @@ static void parse_map(struct ymd_parser *p, int ord) {
 		}
 	} while(ymc_test(p, ','));
 out:
-	if (ord)
+	if (btree)
+		ymk_emitOfP(p, I_NEWBTR, order, count);
+	else if (lead == '@')
 		ymk_emitOfP(p, I_NEWSKL, order, count);
 	else
-		ymk_emitOP(p, I_NEWMAP, count);
+		ymk_emitOfP(p, I_NEWMAP, order, count);
 }
 
 static int parse_args(struct ymd_parser *p) {
@@ -712,10 +730,9 @@ static void parse_simple(struct ymd_parser *p) {
 		ymk_emit_rz(p);
 		break;
 	case '{':
-		parse_map(p, 0);
-		break;
+	case '%':
 	case '@':
-		parse_map(p, 1);
+		parse_map(p, ymc_peek(p));
 		break;
 	case '[':
 		parse_array(p);
@@ -894,15 +911,30 @@ static void ymk_binary(struct ymd_parser *p, int op, ushort_t ipos) {
 	case OP_OR:
 		ymk_hack_jmp(p, ipos, I_JNN, 0);
 		break;
-	case OP_STRCAT:
-		ymk_emitO(p, I_STRCAT);
-		break;
 	default:
 		assert(!"No reached.");
 		break;
 	}
 }
 
+// `a .. b .. c' is one `strcat 3', not two `strcat'.
+#define MAX_STRCAT_ARGS 64
+
+static int parse_strcat(struct ymd_parser *p) {
+	int op, n = 1;
+	do {
+		ymc_next(p);
+		op = parse_expr(p, prio[OP_STRCAT].right);
+		if (++n == MAX_STRCAT_ARGS) {
+			ymk_emitOP(p, I_STRCAT, n);
+			n = 1;
+		}
+	} while (op == OP_STRCAT);
+	if (n > 1)
+		ymk_emitOP(p, I_STRCAT, n);
+	return op;
+}
+
 static int parse_expr(struct ymd_parser *p, int limit) {
 	int op = ymc_unary_op(p);
 	if (op != OP_NOT_UNARY) {
@@ -915,6 +947,10 @@ static int parse_expr(struct ymd_parser *p, int limit) {
 	while (op != OP_NOT_BINARY && prio[op].left > limit) {
 		int next_op;
 		ushort_t i;
+		if (op == OP_STRCAT) {
+			op = parse_strcat(p);
+			continue;
+		}
 		ymc_next(p);
 		i = ymk_hold_logc(p, op);
 		next_op = parse_expr(p, prio[op].right);
@@ -1255,8 +1291,11 @@ static void parse_forstep_partial(struct ymd_parser *p, const char *tmp) {
 	p->loop->op = I_FORSTEP;
 }
 
-static void parse_foreach_partial(struct ymd_parser *p, const char *tmp) {
-	char iter[64];
+// `val' is NULL if only one variable, otherwise iterator is called with
+// an argument 2, and it returns 2 variables: `tmp' and `val'.
+static void parse_foreach_partial(struct ymd_parser *p, const char *tmp,
+                                  const char *val) {
+	char iter[64], hold[64];
 	// `in' token:
 	ymc_match(p, IN);
 	parse_expr(p, 0);
@@ -1267,26 +1306,41 @@ static void parse_foreach_partial(struct ymd_parser *p, const char *tmp) {
 	p->loop->i_retry = ymk_ipos(p);
 	// Push then call iterator:
 	ymk_emit_push(p, iter);
-	ymk_emit_call(p, I_CALL, 1, 0, 0);
+	if (val) {
+		// Ask for key and value: the value is parked in a hidden local
+		// so both variables keep their last values after the loop.
+		snprintf(hold, sizeof(hold), "__loop_val_%d__", p->for_id - 1);
+		ymk_new_locvar(p, hold);
+		ymk_emit_int(p, 2);
+		ymk_emit_call(p, I_CALL, 2, 1, 0);
+		ymk_emit_store(p, hold);
+	} else {
+		ymk_emit_call(p, I_CALL, 1, 0, 0);
+	}
 	// Set jcond for foreach instruction:
 	p->loop->i_jcond = ymk_hold(p);
 	// Store i variable
 	ymk_emit_store(p, tmp);
+	if (val) {
+		ymk_emit_push(p, hold);
+		ymk_emit_store(p, val);
+	}
 	// `{' block `}'
 	parse_block(p);
 	// Operator
 	p->loop->op = I_FOREACH;
 }
 
-static YMD_INLINE void parse_for_partial(struct ymd_parser *p, const char *tmp) {
-	if (ymc_peek(p) == '=')
+static YMD_INLINE void parse_for_partial(struct ymd_parser *p,
+                                         const char *tmp, const char *val) {
+	if (!val && ymc_peek(p) == '=')
 		parse_forstep_partial(p, tmp);
 	else
-		parse_foreach_partial(p, tmp);
+		parse_foreach_partial(p, tmp, val);
 }
 
 static void parse_for(struct ymd_parser *p) {
-	const char *tmp;
+	const char *tmp, *val = NULL;
 	struct loop_info scope;
 	ymc_next(p); // `for' `symbol' : `call'
 	ymk_loop_enter(p, &scope);
@@ -1300,11 +1354,17 @@ static void parse_for(struct ymd_parser *p) {
 		ymc_next(p);
 		tmp = ymk_symbol(p);
 		ymk_new_locvar(p, tmp);
-		parse_for_partial(p, tmp);
+		if (ymc_test(p, ',')) {
+			val = ymk_symbol(p);
+			ymk_new_locvar(p, val);
+		}
+		parse_for_partial(p, tmp, val);
 		break;
 	case SYMBOL:
 		tmp = ymk_symbol(p);
-		parse_for_partial(p, tmp);
+		if (ymc_test(p, ','))
+			val = ymk_symbol(p);
+		parse_for_partial(p, tmp, val);
 		break;
 	default:
 		ymc_fail(p, "Syntax error.");
@@ -20,7 +20,7 @@ static const char *kz_calc_op[] = {
 };
 
 static const char *kz_order[] = {
-	"asc", "dasc", "user",
+	"asc", "dasc", "user", "asc key", "dasc key",
 };
 
 static const char *fn_kz(const struct func *fn, int i) {
@@ -150,7 +150,7 @@ int dasm_inst(FILE *fp, const struct func *fn, uint_t inst) {
 		rv = fprintf(fp, "%s", kz_calc_op[asm_flag(inst)]);
 		break;
 	case I_STRCAT:
-		rv = fprintf(fp, "strcat");
+		rv = fprintf(fp, "strcat %d", asm_param(inst));
 		break;
 	case I_SHIFT:
 		rv = fprintf(fp, "shift [%s]", kz_shift_op[asm_flag(inst)]);
@@ -159,7 +159,8 @@ int dasm_inst(FILE *fp, const struct func *fn, uint_t inst) {
 		rv = fprintf(fp, "call %d, ret:%d", asm_argc(inst), asm_aret(inst));
 		break;
 	case I_NEWMAP:
-		rv = fprintf(fp, "newmap %d", asm_param(inst));
+		rv = fprintf(fp, "newmap %d%s", asm_param(inst),
+				asm_flag(inst) == F_ORDER ? ", [order]" : "");
 		break;
 	case I_NEWSKL:
 		rv = fprintf(fp, "newskl %d, [%s]", asm_param(inst),
@@ -168,6 +169,10 @@ int dasm_inst(FILE *fp, const struct func *fn, uint_t inst) {
 	case I_NEWDYA:
 		rv = fprintf(fp, "newdya %d", asm_param(inst));
 		break;
+	case I_NEWBTR:
+		rv = fprintf(fp, "newbtr %d, [%s]", asm_param(inst),
+				kz_order[asm_flag(inst)]);
+		break;
 	default:
 		assert(0 && "No reached.");
 		break;
@@ -0,0 +1,116 @@
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define MIN_MAX 8
+
+//------------------------------------------------------------------
+// Deque:
+// -----------------------------------------------------------------
+// Elements are in [head, head + count) of the ring, indexes wrap around by
+// `& (max - 1)'.
+static int ceil_pow2(int n) {
+	int k = MIN_MAX;
+	while (k < n)
+		k <<= 1;
+	return k;
+}
+
+struct dequ *dequ_new(struct ymd_mach *vm, int count) {
+	struct dequ *x = gc_new(vm, sizeof(*x), T_DEQU);
+	if (count > 0) {
+		x->max = ceil_pow2(count);
+		x->elem = mm_zalloc(vm, x->max, sizeof(*x->elem));
+	}
+	return x;
+}
+
+void dequ_final(struct ymd_mach *vm, struct dequ *o) {
+	if (o->elem) {
+		assert (o->max > 0);
+		mm_free(vm, o->elem, o->max, sizeof(*o->elem));
+		o->elem  = NULL;
+		o->count = 0;
+		o->max   = 0;
+	}
+}
+
+int dequ_equals(const struct dequ *o, const struct dequ *rhs) {
+	int i;
+	if (o == rhs)
+		return 1;
+	if (o->count != rhs->count)
+		return 0;
+	for (i = 0; i < o->count; ++i) {
+		if (!equals(dequ_get(o, i), dequ_get(rhs, i)))
+			return 0;
+	}
+	return 1;
+}
+
+int dequ_compare(const struct dequ *o, const struct dequ *rhs) {
+	int i, k;
+	if (o == rhs)
+		return 0;
+	k = YMD_MIN(o->count, rhs->count);
+	for (i = 0; i < k; ++i) {
+		int rv = compare(dequ_get(o, i), dequ_get(rhs, i));
+		if (rv != 0)
+			return rv < 0 ? -1 : 1;
+	}
+	if (o->count < rhs->count)
+		return -1;
+	else if (o->count > rhs->count)
+		return 1;
+	return 0;
+}
+
+// Double the ring, elements are moved to [0, count) of the new one.
+static void grow(struct ymd_mach *vm, struct dequ *o) {
+	int max = o->max ? o->max << 1 : MIN_MAX;
+	struct variable *elem = mm_zalloc(vm, max, sizeof(*elem));
+	if (o->count > 0) {
+		int k = YMD_MIN(o->count, o->max - o->head);
+		memcpy(elem, o->elem + o->head, k * sizeof(*elem));
+		memcpy(elem + k, o->elem, (o->count - k) * sizeof(*elem));
+	}
+	if (o->elem)
+		mm_free(vm, o->elem, o->max, sizeof(*o->elem));
+	o->elem = elem;
+	o->max  = max;
+	o->head = 0;
+}
+
+struct variable *dequ_push(struct ymd_mach *vm, struct dequ *o, int front) {
+	struct variable *x;
+	if (o->count >= o->max)
+		grow(vm, o);
+	if (front) {
+		o->head = (o->head - 1) & (o->max - 1);
+		x = o->elem + o->head;
+	} else {
+		x = o->elem + ((o->head + o->count) & (o->max - 1));
+	}
+	++o->count;
+	++o->version;
+	setv_nil(x);
+	return x;
+}
+
+int dequ_pop(struct dequ *o, int front, struct variable *rv) {
+	struct variable *x;
+	if (o->count == 0)
+		return 0;
+	if (front) {
+		x = o->elem + o->head;
+		o->head = (o->head + 1) & (o->max - 1);
+	} else {
+		x = dequ_get(o, o->count - 1);
+	}
+	*rv = *x;
+	setv_nil(x); // Not be referenced by the ring
+	--o->count;
+	++o->version;
+	return 1;
+}
@@ -0,0 +1,101 @@
+#include "core.h"
+#include "compiler.h"
+#include "libc.h"
+#include "deque_test.def"
+
+static struct ymd_mach *setup() {
+	struct ymd_mach *vm = ymd_init();
+	gc_active(vm, +1);
+	return vm;
+}
+
+static void teardown(struct ymd_mach *vm) {
+	gc_active(vm, -1);
+	ymd_final(vm);
+}
+
+static int test_dequ_push_pop(struct ymd_mach *vm) {
+	struct dequ *o = dequ_new(vm, 0);
+	struct variable v;
+	int i;
+	ASSERT_FALSE(dequ_pop(o, 0, &v));
+	ASSERT_FALSE(dequ_pop(o, 1, &v));
+	for (i = 0; i < 100; ++i) {
+		setv_int(dequ_push(vm, o, i % 2), i);
+	}
+	ASSERT_EQ(int, o->count, 100);
+	ASSERT_EQ(int, o->max, 128);
+	// 99, 97, ... 1, 0, 2, ... 98
+	ASSERT_EQ(large, var_int(dequ_get(o, 0)), 99);
+	ASSERT_EQ(large, var_int(dequ_get(o, 49)), 1);
+	ASSERT_EQ(large, var_int(dequ_get(o, 50)), 0);
+	ASSERT_EQ(large, var_int(dequ_get(o, 99)), 98);
+	for (i = 0; i < 50; ++i) {
+		ASSERT_TRUE(dequ_pop(o, 1, &v));
+		ASSERT_EQ(large, var_int(&v), 99 - i * 2);
+		ASSERT_TRUE(dequ_pop(o, 0, &v));
+		ASSERT_EQ(large, var_int(&v), 98 - i * 2);
+	}
+	ASSERT_EQ(int, o->count, 0);
+	ASSERT_FALSE(dequ_pop(o, 0, &v));
+	return 0;
+}
+
+// Head goes around the ring many times, growing must keep the order.
+static int test_dequ_wraparound(struct ymd_mach *vm) {
+	struct dequ *o = dequ_new(vm, 5);
+	struct variable v;
+	int i, front = 0, back = 0;
+	ASSERT_EQ(int, o->max, 8);
+	for (i = 0; i < 1000; ++i) {
+		setv_int(dequ_push(vm, o, 0), back++);
+		if (i % 3 != 2) {
+			ASSERT_TRUE(dequ_pop(o, 1, &v));
+			ASSERT_EQ(large, var_int(&v), front++);
+		}
+	}
+	ASSERT_EQ(int, o->count, back - front);
+	ASSERT_EQ(int, o->max, 512);
+	for (i = 0; i < o->count; ++i)
+		ASSERT_EQ(large, var_int(dequ_get(o, i)), front + i);
+	ASSERT_TRUE(dequ_pop(o, 0, &v));
+	ASSERT_EQ(large, var_int(&v), back - 1);
+	return 0;
+}
+
+static int test_dequ_compare(struct ymd_mach *vm) {
+	struct dequ *a = dequ_new(vm, 0), *b = dequ_new(vm, 0);
+	struct variable x, y;
+	int i;
+	for (i = 0; i < 10; ++i) {
+		setv_int(dequ_push(vm, a, 0), i);
+		setv_int(dequ_push(vm, b, 1), 9 - i);
+	}
+	ASSERT_NE(int, a->head, b->head);
+	setv_dequ(&x, a);
+	setv_dequ(&y, b);
+	ASSERT_TRUE(equals(&x, &y));
+	ASSERT_EQ(int, compare(&x, &y), 0);
+	setv_int(dequ_push(vm, b, 0), 0);
+	ASSERT_FALSE(equals(&x, &y));
+	ASSERT_LT(int, compare(&x, &y), 0);
+	return 0;
+}
+
+// Popped nil means an empty deque, so no one can append nil.
+static int test_dequ_append_nil(struct ymd_mach *vm) {
+	struct ymd_context *l = ioslate(vm);
+	ymd_load_lib(vm, lbxBuiltin);
+	ASSERT_EQ(int, ymd_compile(l, "__main__", "[chunk]",
+	                           "var q = deque(1)\n"
+	                           "append(q, 2, 3)\n"
+	                           "return len(q)\n"), 0);
+	ASSERT_EQ(int, ymd_xcall(l, 0), 1);
+	ASSERT_EQ(large, var_int(ymd_top(l, 0)), 3);
+	ymd_pop(l, 1);
+	ASSERT_EQ(int, ymd_compile(l, "__main__", "[chunk]",
+	                           "var q = deque(1)\n"
+	                           "append(q, 2, nil)\n"), 0);
+	ASSERT_TRUE(ymd_xcall(l, 0) < 0);
+	return 0;
+}
@@ -17,6 +17,12 @@ struct dyay *dyay_new(struct ymd_mach *vm, int max) {
 }
 
 void dyay_final(struct ymd_mach *vm, struct dyay *o) {
+	if (o->parent) { // Borrowed elements.
+		o->elem   = NULL;
+		o->count  = 0;
+		o->parent = NULL;
+		return;
+	}
 	if (o->elem) {
 		assert(o->max > 0);
 		mm_free(vm, o->elem, o->max, sizeof(*o->elem));
@@ -46,10 +52,9 @@ int dyay_compare(const struct dyay *o, const struct dyay *rhs) {
 		return 0;
 	k = o->count < rhs->count ? o->count : rhs->count;
 	for (i = 0; i < k; ++i) {
-		if (compare(o->elem + i, rhs->elem + i) < 0)
-			return -1;
-		else if (compare(o->elem + i, rhs->elem + i) > 0)
-			return 1;
+		int rv = compare(o->elem + i, rhs->elem + i);
+		if (rv != 0)
+			return rv < 0 ? -1 : 1;
 	}
 	if (o->count < rhs->count)
 		return -1;
@@ -71,34 +76,89 @@ static YMD_INLINE void resize(struct ymd_mach *vm, struct dyay *o) {
 	                       sizeof(*o->elem));
 }
 
+struct dyay *dyay_slice(struct ymd_mach *vm, struct dyay *o, int start,
+                        int count) {
+	struct dyay *x;
+	assert (start >= 0 && count >= 0);
+	assert (start + count <= o->count);
+	if (count == 0)
+		return dyay_new(vm, 0);
+	if (!o->parent) {
+		// First slice: move elements to a hidden array, then `o' is a
+		// view of it too.
+		struct dyay *base = dyay_new(vm, 0);
+		base->elem  = o->elem;
+		base->count = o->count;
+		base->max   = o->max;
+		o->max    = 0;
+		o->parent = base;
+	}
+	x = dyay_new(vm, 0);
+	x->elem   = o->elem + start;
+	x->count  = count;
+	x->parent = o->parent;
+	return x;
+}
+
+struct dyay *dyay_own(struct ymd_mach *vm, struct dyay *o) {
+	struct variable *elem = NULL;
+	int max = 0;
+	if (!o->parent)
+		return o;
+	if (o->count > 0) {
+		max  = o->count * 3 / 2 + MAX_ADD;
+		elem = mm_zalloc(vm, max, sizeof(*elem));
+		memcpy(elem, o->elem, o->count * sizeof(*elem));
+	}
+	o->elem   = elem;
+	o->max    = max;
+	o->parent = NULL;
+	return o;
+}
+
+// A view at the end of its parent can grow in parent's free space, other
+// views never see these elements.
+static YMD_INLINE int grow_inplace(struct dyay *o) {
+	struct dyay *base = o->parent;
+	if (o->elem + o->count != base->elem + base->count ||
+		base->count >= base->max)
+		return 0;
+	++base->count;
+	return 1;
+}
+
 struct variable *dyay_add(struct ymd_mach *vm, struct dyay *o) {
-	if (o->count >= o->max) // Resize
-		resize(vm, o);
+	if (!o->parent || !grow_inplace(o)) {
+		dyay_own(vm, o);
+		if (o->count >= o->max) // Resize
+			resize(vm, o);
+	}
 	memset(o->elem + o->count, 0, sizeof(*o->elem));
+	++o->version;
 	return o->elem + o->count++;
 }
 
 struct variable *dyay_insert(struct ymd_mach *vm, struct dyay *o, ymd_int_t i) {
-	int j;
+	dyay_own(vm, o);
 	if (o->count >= o->max) // Resize
 		resize(vm, o);
 	assert(i >= 0);
 	assert(i < o->count);
-	j = o->count;
-	while (j-- > i)
-		o->elem[j + 1] = o->elem[j];
+	memmove(o->elem + i + 1, o->elem + i, (o->count - i) * sizeof(*o->elem));
 	++o->count;
+	++o->version;
 	return o->elem + i;
 }
 
 int dyay_remove(struct ymd_mach *vm, struct dyay *o, ymd_int_t i) {
-	(void)vm;
 	assert(i >= 0);
 	if (i >= o->count)
 		return 0;
+	dyay_own(vm, o);
 	if (i < o->count - 1)
 		memmove(o->elem + i, o->elem + i + 1,
 		        (o->count - i - 1) * sizeof(*o->elem));
 	--o->count;
+	++o->version;
 	return 1;
 }
@@ -26,7 +26,7 @@ static int test_dyay_creation_1 (struct ymd_mach *vm) {
 	ASSERT_NOTNULL(rv);
 	ASSERT_FALSE(rv == knil);
 	ASSERT_EQ(int, ymd_type(rv), T_NIL);
-	ASSERT_EQ(large, rv->u.i, 0LL);
+	ASSERT_EQ(large, var_int(rv), 0LL);
 	ASSERT_EQ(uint, arr->count, 1);
 	ASSERT_EQ(uint, arr->max, 16);
 
@@ -51,18 +51,17 @@ static int test_dyay_addition_1 (struct ymd_mach *vm) {
 		ASSERT_NOTNULL(rv);
 		ASSERT_FALSE(rv == knil);
 		ASSERT_EQ(int, ymd_type(rv), T_NIL);
-		ASSERT_EQ(large, rv->u.i, 0LL);
+		ASSERT_EQ(large, var_int(rv), 0LL);
 		ASSERT_EQ(uint, arr->count, k - i);
 
-		rv->tt = T_INT;
-		rv->u.i = k - i - 1;
+		setv_int(rv, k - i - 1);
 	}
 	ASSERT_EQ(uint, arr->max, (arr->count - 1) * 3 / 2 + 16);
 	i = k;
 	while (i--) {
 		rv = dyay_get(arr, i);
 		ASSERT_EQ(int, ymd_type(rv), T_INT);
-		ASSERT_EQ(large, rv->u.i, i);
+		ASSERT_EQ(large, var_int(rv), i);
 	}
 	return 0;
 }
@@ -76,8 +75,7 @@ static int test_dyay_addition_2 (struct ymd_mach *vm) {
 	TIME_RECORD_BEGIN(addition)
 	while (i--) {
 		rv = dyay_add(vm, arr);
-		rv->tt = T_INT;
-		rv->u.i = BENCHMARK_COUNT - i - 1;
+		setv_int(rv, BENCHMARK_COUNT - i - 1);
 	}
 	TIME_RECORD_END
 	i = BENCHMARK_COUNT;
@@ -86,7 +84,7 @@ static int test_dyay_addition_2 (struct ymd_mach *vm) {
 			size_t index = RAND_RANGE(ularge, 0, BENCHMARK_COUNT);
 			rv = dyay_get(arr, index);
 			ASSERT_EQ(int, ymd_type(rv), T_INT);
-			ASSERT_EQ(large, rv->u.i, index);
+			ASSERT_EQ(large, var_int(rv), index);
 		}
 	RAND_END
 	return 0;
@@ -110,8 +108,7 @@ static int test_dyay_addition_3 (struct ymd_mach *vm) {
 static void add_int (struct dyay *dya, ymd_int_t i,
 		struct ymd_mach *vm) {
 	struct variable *rv = dyay_add(vm, dya);
-	rv->tt = T_INT;
-	rv->u.i = i;
+	setv_int(rv, i);
 }
 
 static int test_dyay_comparation (struct ymd_mach *vm) {
@@ -139,3 +136,117 @@ static int test_dyay_comparation (struct ymd_mach *vm) {
 	return 0;
 }
 
+static int test_dyay_slice(struct ymd_mach *vm) {
+	struct dyay *arr = dyay_new(vm, 0), *x, *y;
+	int i;
+	for (i = 0; i < 10; ++i)
+		setv_int(dyay_add(vm, arr), i);
+	x = dyay_slice(vm, arr, 2, 5);
+	ASSERT_EQ(int, x->count, 5);
+	ASSERT_TRUE(x->elem == arr->elem + 2);
+	ASSERT_TRUE(x->parent == arr->parent);
+	ASSERT_EQ(large, var_int(dyay_get(x, 0)), 2LL);
+	// Slice of slice borrows from the same array.
+	y = dyay_slice(vm, x, 1, 2);
+	ASSERT_TRUE(y->parent == arr->parent);
+	ASSERT_EQ(large, var_int(dyay_get(y, 1)), 4LL);
+	// Copy on write.
+	setv_int(dyay_get(dyay_own(vm, x), 0), 100);
+	ASSERT_TRUE(x->parent == NULL);
+	ASSERT_EQ(large, var_int(dyay_get(x, 0)), 100LL);
+	ASSERT_EQ(large, var_int(dyay_get(arr, 2)), 2LL);
+	dyay_remove(vm, y, 0);
+	ASSERT_EQ(int, y->count, 1);
+	ASSERT_EQ(large, var_int(dyay_get(arr, 3)), 3LL);
+	// Origin array grows at the end without copying.
+	setv_int(dyay_add(vm, arr), 10);
+	ASSERT_TRUE(arr->parent != NULL);
+	ASSERT_EQ(int, arr->count, 11);
+	ASSERT_EQ(large, var_int(dyay_get(arr, 10)), 10LL);
+	setv_int(dyay_get(dyay_own(vm, arr), 0), -1);
+	ASSERT_TRUE(arr->parent == NULL);
+	ASSERT_EQ(large, var_int(dyay_get(arr, 0)), -1LL);
+	return 0;
+}
+
+static int check_sorted(const struct dyay *arr, ymd_int_t sum) {
+	int i;
+	for (i = 0; i < arr->count; ++i) {
+		if (i > 0 && compare(arr->elem + i - 1, arr->elem + i) > 0)
+			return -1;
+		sum -= var_int(arr->elem + i);
+	}
+	return sum == 0 ? 0 : -1;
+}
+
+static int test_dyay_sort(struct ymd_mach *vm) {
+	static const int kN[] = { 0, 1, 2, 23, 24, 129, 1000, 20000 };
+	int i, j, p, stable;
+	unsigned seed = 7;
+	for (stable = 0; stable < 2; ++stable)
+	for (p = 0; p < 5; ++p)
+	for (i = 0; i < (int)ARRAY_SIZEOF(kN); ++i) {
+		struct dyay *arr = dyay_new(vm, kN[i]);
+		ymd_int_t sum = 0;
+		for (j = 0; j < kN[i]; ++j) {
+			ymd_int_t x;
+			seed = seed * 1103515245U + 12345U;
+			switch (p) {
+			case 0: x = seed >> 8; break; // Random
+			case 1: x = j; break; // Sorted
+			case 2: x = kN[i] - j; break; // Reversed
+			case 3: x = (seed >> 8) % 3; break; // Many equal ones
+			default: x = j < kN[i] / 2 ? j : kN[i] - j; break; // Organ pipe
+			}
+			setv_int(dyay_add(vm, arr), x);
+			sum += x;
+		}
+		dyay_sort(vm, arr, NULL, stable);
+		ASSERT_EQ(int, check_sorted(arr, sum), 0);
+	}
+	return 0;
+}
+
+static int test_dyay_sort_mixed(struct ymd_mach *vm) {
+	struct dyay *arr = dyay_new(vm, 0);
+	int i;
+	for (i = 0; i < 100; ++i) {
+		if (i % 2)
+			setv_int(dyay_add(vm, arr), 100 - i);
+		else
+			setv_float(dyay_add(vm, arr), 100.5 - i);
+	}
+	dyay_sort(vm, arr, NULL, 0);
+	// Numbers are ordered by value as `<' does.
+	ASSERT_EQ(large, var_int(arr->elem), 1);
+	for (i = 1; i < 100; ++i)
+		ASSERT_LT(int, vm_compare(arr->elem + i - 1, arr->elem + i), 0);
+	return 0;
+}
+
+static int test_dyay_select(struct ymd_mach *vm) {
+	struct dyay *arr = dyay_new(vm, 0);
+	struct variable top[10], k;
+	int i, j;
+	for (i = 0; i < 1000; ++i)
+		setv_int(dyay_add(vm, arr), (i * 7919) % 1000 / 2);
+	ASSERT_EQ(int, dyay_topk(vm, arr, NULL, top, 10), 10);
+	for (i = 0; i < 10; ++i)
+		ASSERT_EQ(large, var_int(top + i), 499 - i / 2);
+	for (i = 0; i < 1000; i += 37) {
+		ASSERT_EQ(large, var_int(dyay_select(vm, arr, NULL, i)), i / 2);
+		for (j = 0; j < i; ++j)
+			ASSERT_LE(large, var_int(arr->elem + j), i / 2);
+		for (j = i + 1; j < 1000; ++j)
+			ASSERT_GE(large, var_int(arr->elem + j), i / 2);
+	}
+	dyay_sort(vm, arr, NULL, 0);
+	setv_int(&k, 100);
+	EXPECT_EQ(int, dyay_bound(vm, arr, NULL, &k, 0), 200);
+	EXPECT_EQ(int, dyay_bound(vm, arr, NULL, &k, 1), 202);
+	setv_float(&k, 99.5);
+	EXPECT_EQ(int, dyay_bound(vm, arr, NULL, &k, 0), 200);
+	setv_int(&k, 500);
+	EXPECT_EQ(int, dyay_bound(vm, arr, NULL, &k, 0), 1000);
+	return 0;
+}
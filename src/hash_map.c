@@ -3,33 +3,81 @@
 #include <string.h>
 #include <stdint.h>
 #include <assert.h>
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define HMAP_SSE2 1
+#endif
 
 //------------------------------------------------------------------
 // Hash Map:
 // -----------------------------------------------------------------
-#define KVI_FREE 0
-#define KVI_SLOT 1
-#define KVI_NODE 2
+// Slots are probed in groups of 16 control bytes, every group is
+// checked in one time. Max load factor is 7/8.
+// Small map has no control bytes (ctrl is NULL), its pairs are in
+// item[0, count) and searched one by one.
+// Like Lua's table, integer keys [0, asize) are in array part, size of
+// array part is decided only when hash part is full (or array part is
+// too sparse): the largest 2^n that more than half of [0, 2^n) is used.
+// Ordered map's table has an int index for every slot, its pairs are
+// appended to item[]; holes of removed pairs are dropped in rehash.
+#define GROUP_WIDTH 16
+#define MIN_SHIFT   4
+#define SMALL_MAX   8
+#define MAX_ABITS   26
 
 static size_t hash(const struct variable *v);
-static struct kvi *hindex(struct ymd_mach *vm, struct hmap *o,
-                          const struct variable *k);
-static void resize(struct ymd_mach *vm, struct hmap *o, int shift);
 
-static int log2x(int n) {
-	int i;
-	for (i = 0; i < (int)sizeof(n)*8; ++i)
-		if ((1 << i) > n)
-			return i;
-	assert(!"No reached.");
-	return -1;
+// Bit i is set if i-th byte in group is `b'.
+#if defined(HMAP_SSE2)
+static YMD_INLINE unsigned group_match(const unsigned char *g,
+                                       unsigned char b) {
+	__m128i x = _mm_loadu_si128((const __m128i *)g);
+	return (unsigned)_mm_movemask_epi8(
+		_mm_cmpeq_epi8(x, _mm_set1_epi8((char)b)));
+}
+
+// Bit i is set if i-th slot is empty or deleted.
+static YMD_INLINE unsigned group_free(const unsigned char *g) {
+	__m128i x = _mm_loadu_si128((const __m128i *)g);
+	return ~(unsigned)_mm_movemask_epi8(x) & 0xffffU;
+}
+#else
+static YMD_INLINE unsigned group_match(const unsigned char *g,
+                                       unsigned char b) {
+	unsigned i, bits = 0;
+	for (i = 0; i < GROUP_WIDTH; ++i)
+		bits |= (unsigned)(g[i] == b) << i;
+	return bits;
+}
+
+static YMD_INLINE unsigned group_free(const unsigned char *g) {
+	unsigned i, bits = 0;
+	for (i = 0; i < GROUP_WIDTH; ++i)
+		bits |= (unsigned)!(g[i] & KVI_FULL) << i;
+	return bits;
+}
+#endif
+
+// Mix bits of hash value: high bits select the first group, low bits are
+// saved in control byte.
+static YMD_INLINE ymd_uint_t hmix(size_t h) {
+	ymd_uint_t x = (ymd_uint_t)h * 0x9E3779B97F4A7C15ULL;
+	return x ^ (x >> 32);
 }
 
-static YMD_INLINE struct kvi *position(const struct hmap *o,
-                                   size_t h) {
-	return o->item + (((h - 1) | 1) % (1 << o->shift));
+static YMD_INLINE unsigned char kvi_ctrl(ymd_uint_t x) {
+	return (unsigned char)(KVI_FULL | (x & 0x7f));
 }
 
+static YMD_INLINE int probe_first(const struct hmap *o, ymd_uint_t x) {
+	const int gshift = o->shift - MIN_SHIFT;
+	return gshift > 0 ? (int)(x >> (64 - gshift)) : 0;
+}
+
+// Triangular probing, visit every group once.
+#define probe_next(o, g, step) \
+	(((g) + (step)) & ((hmap_nslot(o) / GROUP_WIDTH) - 1))
 
 static YMD_INLINE size_t hash_int(ymd_int_t i) {
 	return i;
@@ -37,6 +85,8 @@ static YMD_INLINE size_t hash_int(ymd_int_t i) {
 
 static YMD_INLINE size_t hash_float(ymd_float_t f) {
 	size_t i;
+	if (f == 0.0) // -0.0 equals 0.0
+		return 0;
 	memcpy(&i, &f, sizeof(i));
 	return i;
 }
@@ -66,13 +116,12 @@ static size_t hash_dyay(const struct dyay *o) {
 }
 
 static size_t hash_hmap(const struct hmap *o) {
-	int i = (1 << o->shift);
+	struct variable k;
+	int i;
 	size_t h = 0;
-	while (i--) {
-		if (o->item[i].flag != KVI_FREE) {
-			h += hash(&o->item[i].k);
-			h ^= hash(&o->item[i].v);
-		}
+	for (i = hmap_next(o, 0); i < hmap_end(o); i = hmap_next(o, i + 1)) {
+		h += hash(hmap_key(o, i, &k));
+		h ^= hash(hmap_val(o, i));
 	}
 	return h;
 }
@@ -88,15 +137,50 @@ static size_t hash_skls(const struct skls *o) {
 	return h;
 }
 
+static size_t hash_btre(const struct btre *o) {
+	size_t h = 0;
+	const struct btlf *x;
+	int i;
+	for (x = o->first; x != NULL; x = x->next) {
+		for (i = 0; i < x->nd.n; ++i) {
+			h += hash(x->nd.k + i);
+			h ^= hash(x->v + i);
+		}
+	}
+	return h;
+}
+
+// Order of slots is not same in equal sets, sum stored hashes.
+static size_t hash_hset(const struct hset *o) {
+	size_t h = 0;
+	int i;
+	for (i = 0; i < hset_nslot(o); ++i) {
+		if (hset_full(o, i))
+			h += o->hash[i];
+	}
+	return h;
+}
+
+static size_t hash_dequ(const struct dequ *o) {
+	size_t h = 0;
+	int i;
+	for (i = 0; i < o->count; ++i)
+		h = (h << 1) ^ hash(dequ_get(o, i));
+	return h;
+}
+
+static YMD_INLINE size_t hash_pkay(const struct pkay *o) {
+	return kz_hash((const char *)o->u.raw,
+	               o->count * pkay_elem_size(pkay_kind(o)), pkay_kind(o));
+}
+
 static YMD_INLINE size_t hash_mand(const struct mand *o) {
 	size_t h = hash_ext((void *)o->final);
-	return h ^ kz_hash((const char *)o->land, o->len);
+	return h ^ kz_hash((const char *)o->land, o->len, 0);
 }
 
-// Lazy hash:
 static YMD_INLINE size_t hash_kstr(const struct kstr *kz) {
-	struct kstr *mz = (struct kstr *)kz; // FIXME: Maybe unsafe
-	return kz->hash ? kz->hash : (mz->hash = kz_hash(kz->land, kz->len));
+	return kstr_hash(kz);
 }
 
 static YMD_INLINE size_t hash_func(const struct func *fn) {
@@ -113,23 +197,35 @@ static size_t hash(const struct variable *v) {
 	case T_NIL:
 		return 0;
 	case T_INT:
-		return hash_int(v->u.i);
+		return hash_int(var_int(v));
 	case T_FLOAT:
-		return hash_float(v->u.f);
+		return hash_float(var_float(v));
 	case T_BOOL:
-		return hash_bool(v->u.i);
+		return hash_bool(var_int(v));
 	case T_KSTR:
 		return hash_kstr(kstr_k(v));
 	case T_FUNC:
 		return hash_func(func_k(v));
 	case T_EXT:
-		return hash_ext(v->u.ext);
+		return hash_ext(var_ext(v));
 	case T_DYAY:
 		return hash_dyay(dyay_k(v));
 	case T_HMAP:
 		return hash_hmap(hmap_k(v));
 	case T_SKLS:
 		return hash_skls(skls_k(v));
+	case T_BTRE:
+		return hash_btre(btre_k(v));
+	case T_PKAY:
+		return hash_pkay(pkay_k(v));
+	case T_DEQU:
+		return hash_dequ(dequ_k(v));
+	case T_HEAP: // Same as equals(): by address
+		return hash_ext((void *)heap_k(v));
+	case T_HSET:
+		return hash_hset(hset_k(v));
+	case T_LRUC:
+		return hash_ext((void *)lruc_k(v));
 	case T_MAND:
 		return hash_mand(mand_k(v));
 	default:
@@ -139,23 +235,299 @@ static size_t hash(const struct variable *v) {
 	return 0;
 }
 
-static struct variable *hfind(const struct hmap *o,
-                              const struct variable *k) {
-	size_t h = hash(k);
-	struct kvi *i, *slot = position(o, h);
-	switch (slot->flag) {
-	case KVI_SLOT:
-		for (i = slot; i != NULL; i = i->next) {
-			if (i->hash == h && equals(&i->k, k))
-				return &i->v;
-		}
-		break;
-	case KVI_FREE:
-	case KVI_NODE:
+// Short strings are in pool, compare them by pointer only.
+static YMD_INLINE int key_equals(const struct variable *lhs,
+                                 const struct variable *rhs) {
+	if (ymd_type(lhs) != ymd_type(rhs))
+		return 0;
+	if (is_ref(lhs) && var_ref(lhs) == var_ref(rhs))
+		return 1;
+	switch (ymd_type(lhs)) {
+	case T_KSTR:
+		return kstr_k(lhs)->len >= MAX_KPOOL_LEN &&
+		       kstr_equals(kstr_k(lhs), kstr_k(rhs));
+	case T_MAND:
+		return mand_equals(mand_k(lhs), mand_k(rhs));
 	default:
 		break;
 	}
-	return knil;
+	return equals(lhs, rhs);
+}
+
+static int small_find(const struct hmap *o, const struct variable *k) {
+	int i;
+	for (i = 0; i < o->count; ++i) {
+		if (key_equals(&o->item[i].k, k))
+			return i;
+	}
+	return -1;
+}
+
+// Item index of slot `i'.
+#define kvi_at(o, i) (hmap_ordered(o) ? hmap_index(o)[i] : (i))
+
+// Find slot index of key `k', or -1 if not found.
+static int hfind(const struct hmap *o, const struct variable *k,
+                 ymd_uint_t x) {
+	const unsigned char c = kvi_ctrl(x);
+	int g = probe_first(o, x), step = 0;
+	for (;;) {
+		const unsigned char *grp = o->ctrl + g * GROUP_WIDTH;
+		unsigned bits = group_match(grp, c);
+		while (bits) {
+			int i = g * GROUP_WIDTH + ymd_lowest_bit(bits);
+			if (key_equals(&o->item[kvi_at(o, i)].k, k))
+				return i;
+			bits &= bits - 1;
+		}
+		if (group_match(grp, KVI_EMPTY))
+			return -1;
+		g = probe_next(o, g, ++step);
+	}
+}
+
+// First empty or deleted slot in probing sequence.
+static int find_free(const struct hmap *o, ymd_uint_t x) {
+	int g = probe_first(o, x), step = 0;
+	for (;;) {
+		unsigned bits = group_free(o->ctrl + g * GROUP_WIDTH);
+		if (bits)
+			return g * GROUP_WIDTH + ymd_lowest_bit(bits);
+		g = probe_next(o, g, ++step);
+	}
+}
+
+// Slot of array part, or NULL if `k' is not in it.
+static YMD_INLINE struct variable *aslot(const struct hmap *o,
+                                         const struct variable *k) {
+	if (ymd_type(k) == T_INT &&
+	    (ymd_uint_t)var_int(k) < (ymd_uint_t)o->asize)
+		return o->arr + var_int(k);
+	return NULL;
+}
+
+static YMD_INLINE struct variable *hget(const struct hmap *o,
+                                        const struct variable *k) {
+	struct variable *v = aslot(o, k);
+	int i;
+	if (v)
+		return is_nil(v) ? knil : v;
+	if (!o->ctrl)
+		i = small_find(o, k);
+	else if ((i = hfind(o, k, hmix(hash(k)))) >= 0)
+		i = kvi_at(o, i);
+	return i < 0 ? knil : &o->item[i].v;
+}
+
+// Index of first used slot of hash part from `i', or hmap_nslot(o).
+static YMD_INLINE int slot_next(const struct hmap *o, int i) {
+	const int k = hmap_nslot(o);
+	if (!o->ctrl)
+		return i < o->count ? i : k;
+	if (hmap_ordered(o)) {
+		while (i < k && is_nil(&o->item[i].k))
+			++i;
+		return i;
+	}
+	while (i < k && !kvi_full(o, i))
+		++i;
+	return i;
+}
+
+// Number of slots can be used in a table.
+#define usable(shift) ((1 << (shift)) - (1 << (shift)) / 8)
+
+// Smallest table which is less than half full after rehash.
+static int fit_shift(int count) {
+	int shift = MIN_SHIFT;
+	while (usable(shift) / 2 <= count)
+		++shift;
+	return shift;
+}
+
+// Bytes of a slot: item, (index of ordered table) and control byte.
+#define slot_size(o) \
+	(sizeof(struct kvi) + (hmap_ordered(o) ? sizeof(int) : 0) + 1)
+
+static void table_alloc(struct ymd_mach *vm, struct hmap *o, int shift) {
+	const int k = 1 << shift;
+	assert (shift >= MIN_SHIFT);
+	o->shift  = shift;
+	o->growth = usable(shift);
+	// All of control bytes are KVI_EMPTY.
+	o->item   = mm_zalloc(vm, 1, k * slot_size(o));
+	o->ctrl   = (unsigned char *)(o->item + k);
+	if (hmap_ordered(o))
+		o->ctrl += k * sizeof(int);
+}
+
+static void table_free(struct ymd_mach *vm, struct hmap *o) {
+	mm_free(vm, o->item, 1, hmap_nslot(o) * slot_size(o));
+}
+
+// Use slot `i' for a new pair, return its item index. Ordered table's
+// `growth' is number of items can be appended, so removed items are not
+// reused before rehash.
+static YMD_INLINE int claim(struct hmap *o, int i, ymd_uint_t x) {
+	int n = i;
+	if (hmap_ordered(o)) {
+		n = usable(o->shift) - o->growth--;
+		hmap_index(o)[i] = n;
+	} else if (o->ctrl[i] == KVI_EMPTY) {
+		--o->growth;
+	}
+	o->ctrl[i] = kvi_ctrl(x);
+	return n;
+}
+
+// Small map's item array has 1 << shift pairs, NULL if nothing.
+static void small_resize(struct ymd_mach *vm, struct hmap *o, int shift) {
+	if (!o->item)
+		o->item = mm_zalloc(vm, 1 << shift, sizeof(*o->item));
+	else
+		o->item = mm_realloc(vm, o->item, hmap_nslot(o), 1 << shift,
+		                     sizeof(*o->item));
+	o->shift = shift;
+}
+
+static void small_free(struct ymd_mach *vm, struct hmap *o) {
+	if (o->item)
+		mm_free(vm, o->item, hmap_nslot(o), sizeof(*o->item));
+	o->item  = NULL;
+	o->shift = 0;
+}
+
+// Append a new pair, return -1 if the small map is full.
+static int small_add(struct ymd_mach *vm, struct hmap *o) {
+	if (o->count >= SMALL_MAX)
+		return -1;
+	if (!o->item)
+		small_resize(vm, o, 0);
+	else if (o->count >= hmap_nslot(o))
+		small_resize(vm, o, o->shift + 1);
+	setv_nil(&o->item[o->count].v);
+	return o->count++;
+}
+
+// Put a pair to a new table which has no any deleted slot.
+static YMD_INLINE void table_add(struct hmap *o, const struct kvi *x) {
+	ymd_uint_t h = hmix(hash(&x->k));
+	o->item[claim(o, find_free(o, h), h)] = *x;
+}
+
+
+static void table2small(struct ymd_mach *vm, struct hmap *o) {
+	struct hmap bak = *o;
+	int i, n = 0, shift = 0;
+	assert (o->count <= SMALL_MAX);
+	o->ctrl   = NULL;
+	o->item   = NULL;
+	o->growth = 0;
+	while ((1 << shift) < o->count)
+		++shift;
+	if (o->count > 0)
+		small_resize(vm, o, shift);
+	for (i = slot_next(&bak, 0); i < hmap_nslot(&bak);
+	     i = slot_next(&bak, i + 1))
+		o->item[n++] = bak.item[i];
+	table_free(vm, &bak);
+}
+
+static void hash_free(struct ymd_mach *vm, struct hmap *o) {
+	if (!o->ctrl)
+		small_free(vm, o);
+	else
+		table_free(vm, o);
+}
+
+// Bucket of integer key `i': 0 for 0, b for [2^(b-1), 2^b), or -1 if
+// it can not be in array part.
+static YMD_INLINE int abits(ymd_int_t i) {
+	int b = 0;
+	if (i < 0 || i >= (1 << MAX_ABITS))
+		return -1;
+	while (i) {
+		i >>= 1;
+		++b;
+	}
+	return b;
+}
+
+static YMD_INLINE void count_key(int *nums, const struct variable *k) {
+	int b;
+	if (ymd_type(k) == T_INT && (b = abits(var_int(k))) >= 0)
+		++nums[b];
+}
+
+// Best size of array part with new key `k' (can be NULL), `used' is
+// number of keys will be in it.
+static int compute_asize(const struct hmap *o, const struct variable *k,
+                         int *used) {
+	int nums[MAX_ABITS + 1], i, b, a = 0, na = 0;
+	int total = hmap_count(o) + (k != NULL);
+	memset(nums, 0, sizeof(nums));
+	for (i = 0; i < o->asize; ++i)
+		nums[abits(i)] += !is_nil(o->arr + i);
+	for (i = slot_next(o, 0); i < hmap_nslot(o); i = slot_next(o, i + 1))
+		count_key(nums, &o->item[i].k);
+	if (k)
+		count_key(nums, k);
+	*used = 0;
+	for (b = 0; b <= MAX_ABITS && total > (1 << b) / 2; ++b) {
+		a += nums[b];
+		if (a > (1 << b) / 2) {
+			na = 1 << b;
+			*used = a;
+		}
+	}
+	return na;
+}
+
+// Rebuild map with `na' slots array part, and hash part for `nh' pairs.
+static void reshape(struct ymd_mach *vm, struct hmap *o, int na, int nh) {
+	struct hmap bak = *o;
+	struct variable k, *v;
+	int i, j;
+	o->asize  = na;
+	o->acount = 0;
+	o->arr    = na > 0 ? mm_zalloc(vm, na, sizeof(*o->arr)) : NULL;
+	o->count  = 0;
+	o->growth = 0;
+	o->ctrl   = NULL;
+	o->item   = NULL;
+	if (nh > SMALL_MAX)
+		table_alloc(vm, o, fit_shift(nh));
+	else
+		o->shift = 0;
+	for (i = hmap_next(&bak, 0); i < hmap_end(&bak);
+	     i = hmap_next(&bak, i + 1)) {
+		struct kvi x;
+		x.k = *hmap_key(&bak, i, &k);
+		x.v = *hmap_val(&bak, i);
+		if ((v = aslot(o, &x.k)) != NULL) {
+			*v = x.v;
+			++o->acount;
+		} else if (!o->ctrl) {
+			j = small_add(vm, o);
+			assert (j >= 0);
+			o->item[j] = x;
+		} else {
+			table_add(o, &x);
+			++o->count;
+		}
+	}
+	if (bak.arr)
+		mm_free(vm, bak.arr, bak.asize, sizeof(*bak.arr));
+	hash_free(vm, &bak);
+}
+
+// Hash part is full: resize both of parts for new key `k'.
+static void grow(struct ymd_mach *vm, struct hmap *o,
+                 const struct variable *k) {
+	int used = 0, na = 0;
+	if (!hmap_ordered(o))
+		na = compute_asize(o, k, &used);
+	reshape(vm, o, na, hmap_count(o) + 1 - used);
 }
 
 struct hmap *hmap_new(struct ymd_mach *vm, int count) {
@@ -163,218 +535,407 @@ struct hmap *hmap_new(struct ymd_mach *vm, int count) {
 	return hmap_init(vm, x, count);
 }
 
-struct hmap *hmap_init(struct ymd_mach *vm, struct hmap *o, int count) {
-	int shift = 0;
-	if (count <= 0)
-		shift = 5;
-	else if (count > 0)
-		shift = log2x(count);
-	assert(shift > 0);
-	o->shift = shift;
-	o->item = mm_zalloc(vm, 1 << o->shift, sizeof(struct kvi));
-	o->free = o->item + (1 << o->shift) - 1;
-	return o;
+struct hmap *hmap_new_ordered(struct ymd_mach *vm, int count) {
+	struct hmap *x = gc_new(vm, sizeof(*x), T_HMAP);
+	x->reserved = HMAP_ORDERED;
+	return hmap_init(vm, x, count);
 }
 
-static int hmap_count(const struct hmap *o) {
-	int rv = 0, i = (1 << o->shift);
-	while (i--) {
-		if (o->item[i].flag != KVI_FREE)
-			++rv;
+struct hmap *hmap_init(struct ymd_mach *vm, struct hmap *o, int count) {
+	int shift = 0;
+	o->shift  = 0;
+	o->count  = 0;
+	o->growth = 0;
+	o->asize  = 0;
+	o->acount = 0;
+	o->version = 0;
+	o->ctrl   = NULL;
+	o->item   = NULL;
+	o->arr    = NULL;
+	if (count <= SMALL_MAX) {
+		while ((1 << shift) < count)
+			++shift;
+		if (count > 0)
+			small_resize(vm, o, shift);
+		return o;
 	}
-	return rv;
+	shift = MIN_SHIFT;
+	while (usable(shift) < count)
+		++shift;
+	table_alloc(vm, o, shift);
+	return o;
 }
 
 int hmap_equals(const struct hmap *o, const struct hmap *rhs) {
-	int i, rhs_count, count = 0;
+	struct variable k;
+	int i;
 	if (o == rhs)
 		return 1;
-	i = (1 << o->shift);
-	if (i != (1 << rhs->shift))
+	if (hmap_count(o) != hmap_count(rhs))
 		return 0;
-	rhs_count = hmap_count(rhs);
-	while (i--) {
-		if (o->item[i].flag != KVI_FREE) {
-			const struct kvi *it = o->item + i;
-			if (!equals(&it->v, hfind(rhs, &it->k)))
-				return 0;
-			++count;
-		}
+	for (i = hmap_next(o, 0); i < hmap_end(o); i = hmap_next(o, i + 1)) {
+		if (!equals(hmap_val(o, i), hget(rhs, hmap_key(o, i, &k))))
+			return 0;
 	}
-	return count == rhs_count;
+	return 1;
 }
 
 int hmap_compare(const struct hmap *o, const struct hmap *rhs) {
+	struct variable k;
 	int i, rv = 0;
 	if (o == rhs)
 		return 0;
-	i = (1 << o->shift);
-	while (i--) {
-		if (o->item[i].flag != KVI_FREE) {
-			const struct kvi *it = o->item + i;
-			rv += compare(&it->v, hfind(rhs, &it->k));
-		}
-	}
+	for (i = hmap_next(o, 0); i < hmap_end(o); i = hmap_next(o, i + 1))
+		rv += compare(hmap_val(o, i), hget(rhs, hmap_key(o, i, &k)));
 	return rv;
 }
 
 void hmap_final(struct ymd_mach *vm, struct hmap *o) {
-	mm_free(vm, o->item, 1 << o->shift, sizeof(*o->item));
+	if (o->arr)
+		mm_free(vm, o->arr, o->asize, sizeof(*o->arr));
+	hash_free(vm, o);
 }
 
-static struct kvi *alloc_free(struct hmap *o) {
-	const struct kvi *first = o->item;
-	struct kvi *i;
-	for (i = o->free; i > first; --i) {
-		if (i->flag == KVI_FREE) {
-			o->free = i - 1;
-			return i;
-		}
-	}
-	return NULL;
+// Rehash all keys to a new table, drop all of deleted slots.
+static void rehash(struct ymd_mach *vm, struct hmap *o, int shift) {
+	struct hmap bak = *o;
+	int i;
+	table_alloc(vm, o, shift);
+	for (i = slot_next(&bak, 0); i < hmap_nslot(&bak);
+	     i = slot_next(&bak, i + 1))
+		table_add(o, bak.item + i);
+	table_free(vm, &bak);
 }
 
-struct kvi *index_if_head(struct ymd_mach *vm, struct hmap *o,
-                          const struct variable *k,
-                          struct kvi *slot, size_t h) {
-	struct kvi *pos = slot;
-	struct kvi *i, *fnd;
-	for (i = slot; i != NULL; i = i->next) {
-		pos = i;
-		if (i->hash == h && equals(&i->k, k))
-			return i;
+struct variable *hmap_put(struct ymd_mach *vm, struct hmap *o,
+                          const struct variable *k) {
+	struct variable *v;
+	ymd_uint_t x;
+	int i;
+	assert(!is_nil(k));
+	if ((v = aslot(o, k)) != NULL) {
+		o->acount  += is_nil(v);
+		o->version += is_nil(v);
+		return v;
 	}
-	fnd = alloc_free(o);
-	if (!fnd) {
-		resize(vm, o, o->shift + 1);
-		return hindex(vm, o, k);
-	}
-	assert(!pos->next);
-	fnd->hash = h;
-	fnd->flag = KVI_NODE;
-	fnd->next = pos->next;
-	pos->next = fnd;
-	return fnd;
-}
-
-static void resize(struct ymd_mach *vm, struct hmap *o, int shift) {
-	struct kvi *bak;
-	const struct kvi *last, *i;
-	int total_count, old_count = 1 << o->shift;
-	assert(shift > o->shift);
-	// Backup old data
-	bak = o->item;
-	total_count = o->shift == 0 ? 0 : (1 << o->shift);
-	last = bak + total_count;
-	// Allocate new slots
-	total_count = (1 << shift);
-	o->item = mm_zalloc(vm, total_count, sizeof(*o->item));
-	o->free = o->item + total_count - 1; // To last node!!
-	o->shift = shift;
-	// Rehash
-	for (i = bak; i < last; ++i) {
-		if (i->flag != KVI_FREE) {
-			struct variable *pv = hmap_put(vm, o, &i->k);
-			assert(pv != NULL);
-			//assert(is_nil(pv));
-			*pv = i->v;
+	if (!o->ctrl) {
+		if ((i = small_find(o, k)) < 0 && (i = small_add(vm, o)) >= 0)
+			++o->version;
+		if (i >= 0) {
+			o->item[i].k = *k;
+			return &o->item[i].v;
 		}
+		grow(vm, o, k);
+		return hmap_put(vm, o, k);
 	}
-	mm_free(vm, bak, old_count, sizeof(*o->item));
-}
-
-struct kvi *index_if_node(struct ymd_mach *vm, struct hmap *o,
-                          const struct variable *k,
-                          struct kvi *slot, size_t h) {
-	struct kvi *fnd = alloc_free(o), *prev;
-	size_t slot_h;
-	if (!fnd) {
-		resize(vm, o, o->shift + 1);
-		return hindex(vm, o, k);
-	}
-	// Find real head node `prev`.
-	slot_h = hash(&slot->k);
-	prev = position(o, slot_h);
-	while (prev->next != slot) {
-		prev = prev->next;
-		assert(prev);
-	}
-	// `prev` is `slot`'s prev node now.
-	// Link new node: `fnd`.
-	fnd->hash  = slot_h;
-	fnd->flag  = KVI_NODE;
-	fnd->k     = slot->k;
-	fnd->next  = slot->next;
-	fnd->v     = slot->v;
-	prev->next = fnd;
-	// Change `slot` to new head node.
-	slot->hash = h;
-	slot->flag = KVI_SLOT;
-	slot->next = NULL;
-	// Set new node's value to nil.
-	setv_nil(&slot->v);
-	return slot;
-}
-
-static struct kvi *hindex(struct ymd_mach *vm, struct hmap *o,
-                          const struct variable *k) {
-	size_t h = hash(k);
-	struct kvi *slot = position(o, h);
-	switch (slot->flag) {
-	case KVI_FREE:
-		slot->flag = KVI_SLOT;
-		slot->hash = h;
-		return slot;
-	case KVI_SLOT:
-		return index_if_head(vm, o, k, slot, h);
-	case KVI_NODE:
-		return index_if_node(vm, o, k, slot, h);
-	default:
-		assert(!"No reached.");
-		break;
+	x = hmix(hash(k));
+	if ((i = hfind(o, k, x)) < 0) {
+		i = find_free(o, x);
+		if (o->growth == 0 &&
+		    (o->ctrl[i] == KVI_EMPTY || hmap_ordered(o))) {
+			// Grow if it is more than half full, otherwise too many
+			// deleted slots, just clean them.
+			grow(vm, o, k);
+			return hmap_put(vm, o, k);
+		}
+		i = claim(o, i, x);
+		++o->count;
+		++o->version;
+		setv_nil(&o->item[i].v);
+	} else {
+		i = kvi_at(o, i);
 	}
-	return NULL;
+	o->item[i].k = *k;
+	return &o->item[i].v;
 }
 
-struct variable *hmap_put(struct ymd_mach *vm, struct hmap *o,
-                          const struct variable *k) {
-	struct kvi *x = NULL;
+struct variable *hmap_get(struct hmap *o, const struct variable *k) {
 	assert(!is_nil(k));
-	x = hindex(vm, o, k);
-	x->k = *k;
-	return &x->v;
+	return hget(o, k);
 }
 
-struct variable *hmap_get(struct hmap *o, const struct variable *k) {
-	assert(!is_nil(k));
-	return hfind(o, k);
+static int small_remove(struct hmap *o, const struct variable *k) {
+	int i = small_find(o, k);
+	if (i < 0)
+		return 0;
+	// Keep order of pairs.
+	memmove(o->item + i, o->item + i + 1,
+	        (o->count - i - 1) * sizeof(*o->item));
+	--o->count;
+	setv_nil(&o->item[o->count].k);
+	setv_nil(&o->item[o->count].v);
+	return 1;
 }
 
 int hmap_remove(struct ymd_mach *vm, struct hmap *o,
                 const struct variable *k) {
-	size_t h = hash(k);
-	struct kvi dummy, *p, *i, *slot = position(o, h);
-	(void)vm;
-	if (slot->flag != KVI_SLOT)
+	struct variable *v;
+	int i;
+	if ((v = aslot(o, k)) != NULL) {
+		if (is_nil(v))
+			return 0;
+		setv_nil(v);
+		++o->version;
+		// Too sparse, move rest of keys to hash part.
+		if (--o->acount < o->asize / 4) {
+			int used, na = compute_asize(o, NULL, &used);
+			reshape(vm, o, na, hmap_count(o) - used);
+		}
+		return 1;
+	}
+	if (!o->ctrl) {
+		if (!small_remove(o, k))
+			return 0;
+		++o->version;
+		return 1;
+	}
+	if ((i = hfind(o, k, hmix(hash(k)))) < 0)
 		return 0;
-	memset(&dummy, 0, sizeof(dummy));
-	dummy.next = slot;
-	p = &dummy;
-	for (i = slot; i != NULL; i = i->next) {
-		if (i->hash == h && equals(&i->k, k)) {
-			p->next = i->next;
-			memset(i, 0, sizeof(*i));
-			if (i > o->free) // Move free pointer to last node.
-				o->free = i;
-			if (dummy.next && dummy.next != slot) {
-				memcpy(slot, dummy.next, sizeof(*slot));
-				memset(dummy.next, 0, sizeof(*dummy.next));
-				slot->flag = KVI_SLOT;
-			}
-			return 1;
+	++o->version;
+	// No probing pass through a group with empty slot, so the slot can
+	// be empty again.
+	if (group_match(o->ctrl + (i & ~(GROUP_WIDTH - 1)), KVI_EMPTY)) {
+		o->ctrl[i] = KVI_EMPTY;
+		o->growth += !hmap_ordered(o);
+	} else {
+		o->ctrl[i] = KVI_DELETED;
+	}
+	i = kvi_at(o, i);
+	setv_nil(&o->item[i].k);
+	setv_nil(&o->item[i].v);
+	--o->count;
+	// Shrink if less than 1/8 is used.
+	if (o->count <= SMALL_MAX / 2)
+		table2small(vm, o);
+	else if (o->count < usable(o->shift) / 8)
+		rehash(vm, o, fit_shift(o->count));
+	return 1;
+}
+
+//------------------------------------------------------------------
+// Hash Set:
+// -----------------------------------------------------------------
+// Slots are probed in the same way as hash map's table, by the stored
+// 32 bits hash: high bits select the first group, low bits are saved in
+// control byte. A slot has no value, but the hash instead, so keys are
+// never hashed again after putting.
+#define hset_hash(k) ((ymd_u32_t)hmix(hash(k)))
+
+// Bytes of a slot: key, hash and control byte.
+#define HSET_SLOT_SIZE (sizeof(struct variable) + sizeof(ymd_u32_t) + 1)
+
+static YMD_INLINE int hset_first(const struct hset *o, ymd_u32_t h) {
+	const int gshift = o->shift - MIN_SHIFT;
+	return gshift > 0 ? (int)(h >> (32 - gshift)) : 0;
+}
+
+static void hset_alloc(struct ymd_mach *vm, struct hset *o, int shift) {
+	const int k = 1 << shift;
+	assert (shift >= MIN_SHIFT);
+	o->shift  = shift;
+	o->growth = usable(shift);
+	// All of control bytes are KVI_EMPTY.
+	o->key    = mm_zalloc(vm, 1, k * HSET_SLOT_SIZE);
+	o->hash   = (ymd_u32_t *)(o->key + k);
+	o->ctrl   = (unsigned char *)(o->hash + k);
+}
+
+static void hset_free(struct ymd_mach *vm, struct hset *o) {
+	if (o->key)
+		mm_free(vm, o->key, 1, hset_nslot(o) * HSET_SLOT_SIZE);
+	o->key    = NULL;
+	o->hash   = NULL;
+	o->ctrl   = NULL;
+	o->shift  = 0;
+	o->growth = 0;
+}
+
+// Find slot index of key `k', or -1 if not found. Most of unequal keys are
+// rejected by hash without key_equals().
+static int hset_find(const struct hset *o, const struct variable *k,
+                     ymd_u32_t h) {
+	const unsigned char c = kvi_ctrl(h);
+	int g, step = 0;
+	if (!o->key)
+		return -1;
+	g = hset_first(o, h);
+	for (;;) {
+		const unsigned char *grp = o->ctrl + g * GROUP_WIDTH;
+		unsigned bits = group_match(grp, c);
+		while (bits) {
+			int i = g * GROUP_WIDTH + ymd_lowest_bit(bits);
+			if (o->hash[i] == h && key_equals(o->key + i, k))
+				return i;
+			bits &= bits - 1;
 		}
-		p = i;
+		if (group_match(grp, KVI_EMPTY))
+			return -1;
+		g = probe_next(o, g, ++step);
 	}
-	return 0;
 }
 
+// First empty or deleted slot in probing sequence.
+static int hset_find_free(const struct hset *o, ymd_u32_t h) {
+	int g = hset_first(o, h), step = 0;
+	for (;;) {
+		unsigned bits = group_free(o->ctrl + g * GROUP_WIDTH);
+		if (bits)
+			return g * GROUP_WIDTH + ymd_lowest_bit(bits);
+		g = probe_next(o, g, ++step);
+	}
+}
+
+// Put a key which is not in the table, the table must have a free slot.
+static YMD_INLINE void hset_insert(struct hset *o, const struct variable *k,
+                                   ymd_u32_t h) {
+	int i = hset_find_free(o, h);
+	o->growth -= (o->ctrl[i] == KVI_EMPTY);
+	o->ctrl[i] = kvi_ctrl(h);
+	o->hash[i] = h;
+	o->key[i]  = *k;
+	++o->count;
+}
+
+// Move all keys to a new table (or no table if shift is 0), drop all of
+// deleted slots.
+static void hset_rehash(struct ymd_mach *vm, struct hset *o, int shift) {
+	struct hset bak = *o;
+	int i;
+	o->key   = NULL;
+	o->count = 0;
+	if (shift > 0)
+		hset_alloc(vm, o, shift);
+	for (i = 0; i < hset_nslot(&bak); ++i) {
+		if (hset_full(&bak, i))
+			hset_insert(o, bak.key + i, bak.hash[i]);
+	}
+	hset_free(vm, &bak);
+}
+
+static int hset_add(struct ymd_mach *vm, struct hset *o,
+                    const struct variable *k, ymd_u32_t h) {
+	if (hset_find(o, k, h) >= 0)
+		return 0;
+	if (!o->key) {
+		hset_alloc(vm, o, MIN_SHIFT);
+	} else if (o->growth == 0 &&
+	           o->ctrl[hset_find_free(o, h)] == KVI_EMPTY) {
+		// Grow if it is more than half full, otherwise too many deleted
+		// slots, just clean them.
+		hset_rehash(vm, o, fit_shift(o->count + 1));
+	}
+	hset_insert(o, k, h);
+	++o->version;
+	return 1;
+}
+
+struct hset *hset_new(struct ymd_mach *vm, int count) {
+	struct hset *x = gc_new(vm, sizeof(*x), T_HSET);
+	if (count > 0)
+		hset_alloc(vm, x, fit_shift(count));
+	return x;
+}
+
+void hset_final(struct ymd_mach *vm, struct hset *o) {
+	hset_free(vm, o);
+	o->count = 0;
+}
+
+int hset_put(struct ymd_mach *vm, struct hset *o, const struct variable *k) {
+	assert (!is_nil(k));
+	return hset_add(vm, o, k, hset_hash(k));
+}
+
+int hset_get(const struct hset *o, const struct variable *k) {
+	if (o->count == 0)
+		return 0;
+	return hset_find(o, k, hset_hash(k)) >= 0;
+}
+
+int hset_remove(struct ymd_mach *vm, struct hset *o,
+                const struct variable *k) {
+	int i;
+	if (o->count == 0 || (i = hset_find(o, k, hset_hash(k))) < 0)
+		return 0;
+	++o->version;
+	// Same as hash map's: no probing pass through a group with empty slot.
+	if (group_match(o->ctrl + (i & ~(GROUP_WIDTH - 1)), KVI_EMPTY)) {
+		o->ctrl[i] = KVI_EMPTY;
+		++o->growth;
+	} else {
+		o->ctrl[i] = KVI_DELETED;
+	}
+	setv_nil(o->key + i);
+	// Shrink if less than 1/8 is used.
+	if (--o->count == 0)
+		hset_free(vm, o);
+	else if (o->shift > MIN_SHIFT && o->count < usable(o->shift) / 8)
+		hset_rehash(vm, o, fit_shift(o->count));
+	return 1;
+}
+
+int hset_equals(const struct hset *o, const struct hset *rhs) {
+	int i;
+	if (o == rhs)
+		return 1;
+	if (o->count != rhs->count)
+		return 0;
+	for (i = 0; i < hset_nslot(o); ++i) {
+		if (hset_full(o, i) && hset_find(rhs, o->key + i, o->hash[i]) < 0)
+			return 0;
+	}
+	return 1;
+}
+
+// Sets are ordered by number of elements only.
+int hset_compare(const struct hset *o, const struct hset *rhs) {
+	if (o->count < rhs->count)
+		return -1;
+	return o->count > rhs->count;
+}
+
+void hset_merge(struct ymd_mach *vm, struct hset *o, const struct hset *rhs) {
+	int i;
+	if (o == rhs || rhs->count == 0)
+		return;
+	if (o->count == 0) { // Copy whole table, nothing to probe.
+		hset_free(vm, o);
+		hset_alloc(vm, o, rhs->shift);
+		memcpy(o->key, rhs->key, hset_nslot(o) * HSET_SLOT_SIZE);
+		o->growth = rhs->growth;
+		o->count  = rhs->count;
+		++o->version;
+		return;
+	}
+	for (i = 0; i < hset_nslot(rhs); ++i) {
+		if (hset_full(rhs, i))
+			hset_add(vm, o, rhs->key + i, rhs->hash[i]);
+	}
+}
+
+// Add keys of `a' which are (in == 1) or are not (in == 0) in `b'.
+static void hset_select(struct ymd_mach *vm, struct hset *o,
+                        const struct hset *a, const struct hset *b, int in) {
+	int i;
+	assert (o != a && o != b);
+	for (i = 0; i < hset_nslot(a); ++i) {
+		if (hset_full(a, i) &&
+		    (hset_find(b, a->key + i, a->hash[i]) >= 0) == in)
+			hset_add(vm, o, a->key + i, a->hash[i]);
+	}
+}
+
+void hset_intersect(struct ymd_mach *vm, struct hset *o,
+                    const struct hset *a, const struct hset *b) {
+	if (a->count > b->count) { // Probe the bigger one.
+		const struct hset *t = a;
+		a = b;
+		b = t;
+	}
+	hset_select(vm, o, a, b, 1);
+}
+
+void hset_diff(struct ymd_mach *vm, struct hset *o, const struct hset *a,
+               const struct hset *b) {
+	hset_select(vm, o, a, b, 0);
+}
@@ -29,7 +29,7 @@ static int test_hmap_creation_1 (struct ymd_mach *vm) {
 
 	rv = hmap_get(map, &k);
 	ASSERT_EQ(int, ymd_type(rv), T_INT);
-	ASSERT_EQ(large, rv->u.i, 1024);
+	ASSERT_EQ(large, var_int(rv), 1024);
 
 	setv_int(&k, 1024);
 	ASSERT_TRUE(hmap_remove(vm, map, &k));
@@ -102,7 +102,7 @@ static int test_hmap_search_1 (struct ymd_mach *vm) {
 			setv_kstr(&k, kstr_fetch(vm, buf, -1));
 			rv = hmap_get(map, &k);
 			ASSERT_EQ(int, ymd_type(rv), T_INT);
-			ASSERT_EQ(large, rv->u.i, index);
+			ASSERT_EQ(large, var_int(rv), index);
 		}
 		TIME_RECORD_END
 	RAND_END
@@ -123,7 +123,7 @@ static int test_hmap_search_2 (struct ymd_mach *vm) {
 		int j = 16;
 		while (j--) {
 			setv_int(&k, j);
-			ASSERT_EQ(large, hmap_get(map, &k)->u.i, j);
+			ASSERT_EQ(large, var_int(hmap_get(map, &k)), j);
 		}
 	}
 	TIME_RECORD_END
@@ -190,8 +190,8 @@ static int test_hmap_removing (struct ymd_mach *vm) {
 
 	setv_int(&k, 1024);
 	setv_int(hmap_put(vm, map, &k), 1000); // put 1024: 1000
-	ASSERT_EQ(uint,  hmap_get(map, &k)->tt, T_INT);
-	ASSERT_EQ(large, hmap_get(map, &k)->u.i,  1000LL);
+	ASSERT_EQ(uint,  var_tt(hmap_get(map, &k)), T_INT);
+	ASSERT_EQ(large, var_int(hmap_get(map, &k)),  1000LL);
 
 	setv_int(&k, 14);
 	ASSERT_FALSE(hmap_remove(vm, map, &k)); // rm 14
@@ -217,3 +217,303 @@ static int test_hmap_removing2 (struct ymd_mach *vm) {
 	return 0;
 }
 
+static int test_hmap_churn (struct ymd_mach *vm) {
+	struct hmap *map = hmap_new(vm, 0);
+	struct variable k;
+	ymd_int_t i, n = 1000;
+	int shift;
+	// Negative keys are always in hash part.
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, ~i);
+		setv_int(hmap_put(vm, map, &k), i);
+	}
+	for (i = 0; i < n; i += 2) {
+		setv_int(&k, ~i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+	}
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, ~i);
+		if (i % 2) {
+			ASSERT_EQ(large, var_int(hmap_get(map, &k)), i);
+		} else {
+			ASSERT_TRUE(knil == hmap_get(map, &k));
+		}
+	}
+	// Deleted slots are reused, table does not grow.
+	shift = map->shift;
+	for (i = 0; i < n * 100; ++i) {
+		setv_int(&k, ~(n + i));
+		setv_int(hmap_put(vm, map, &k), i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+	}
+	ASSERT_EQ(int, map->shift, shift);
+	setv_int(&k, ~999);
+	ASSERT_EQ(large, var_int(hmap_get(map, &k)), 999LL);
+	return 0;
+}
+
+static int test_hmap_count (struct ymd_mach *vm) {
+	struct hmap *map = hmap_new(vm, 0), *rhs = hmap_new(vm, 0);
+	struct variable k;
+	ymd_int_t i, n = 10000;
+	int shift;
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, ~i);
+		setv_int(hmap_put(vm, map, &k), i);
+		setv_int(hmap_put(vm, map, &k), i); // Put again.
+	}
+	ASSERT_EQ(int, map->count, n);
+	shift = map->shift;
+	// Shrink after most of keys removed.
+	for (i = 0; i < n - 10; ++i) {
+		setv_int(&k, ~i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+		ASSERT_EQ(int, 0, hmap_remove(vm, map, &k));
+	}
+	ASSERT_EQ(int, map->count, 10);
+	ASSERT_LT(int, map->shift, shift);
+	for (i = n - 10; i < n; ++i) {
+		setv_int(&k, ~i);
+		ASSERT_EQ(large, var_int(hmap_get(map, &k)), i);
+		setv_int(hmap_put(vm, rhs, &k), i);
+	}
+	// Same pairs, capacity is not matter.
+	ASSERT_TRUE(hmap_equals(map, rhs));
+	ASSERT_TRUE(hmap_equals(rhs, map));
+	return 0;
+}
+
+static int test_hmap_small (struct ymd_mach *vm) {
+	struct hmap *map = hmap_new(vm, 0);
+	struct variable k;
+	char buf[32];
+	int i;
+	ASSERT_NULL(map->item);
+	ASSERT_NULL(map->ctrl);
+	for (i = 0; i < 8; ++i) {
+		snprintf(buf, sizeof(buf), "k.%d", i);
+		setv_kstr(&k, kstr_fetch(vm, buf, -1));
+		setv_int(hmap_put(vm, map, &k), i);
+	}
+	ASSERT_NULL(map->ctrl);
+	ASSERT_EQ(int, hmap_nslot(map), 8);
+	// Pairs keep their order in small map.
+	for (i = 0; i < 8; ++i)
+		ASSERT_EQ(large, var_int(&map->item[i].v), i);
+	setv_int(&k, 8);
+	setv_int(hmap_put(vm, map, &k), 8);
+	ASSERT_NOTNULL(map->ctrl);
+	ASSERT_EQ(int, map->count, 9);
+	for (i = 0; i < 8; ++i) {
+		snprintf(buf, sizeof(buf), "k.%d", i);
+		setv_kstr(&k, kstr_fetch(vm, buf, -1));
+		ASSERT_EQ(large, var_int(hmap_get(map, &k)), i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+	}
+	// Back to small map.
+	ASSERT_NULL(map->ctrl);
+	ASSERT_EQ(int, map->count, 1);
+	setv_int(&k, 8);
+	ASSERT_EQ(large, var_int(hmap_get(map, &k)), 8LL);
+	ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+	ASSERT_EQ(int, 0, hmap_remove(vm, map, &k));
+	ASSERT_EQ(int, map->count, 0);
+	ASSERT_TRUE(knil == hmap_get(map, &k));
+	return 0;
+}
+
+static int test_hmap_array (struct ymd_mach *vm) {
+	struct hmap *map = hmap_new(vm, 0), *rhs = hmap_new(vm, 0);
+	struct variable k, buf;
+	ymd_int_t i, n = 1000;
+	int pos, sum = 0;
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, i);
+		setv_int(hmap_put(vm, map, &k), i);
+		setv_int(&k, n - i - 1);
+		setv_int(hmap_put(vm, rhs, &k), n - i - 1);
+	}
+	setv_kstr(&k, kstr_fetch(vm, "name", -1));
+	setv_int(hmap_put(vm, map, &k), -1);
+	setv_int(hmap_put(vm, rhs, &k), -1);
+	// Dense keys are in array part, but `rhs' is never full again when
+	// its keys become dense, they are still in hash part.
+	ASSERT_LE(int, n, map->asize);
+	ASSERT_EQ(int, map->acount, n);
+	ASSERT_EQ(int, hmap_count(map), n + 1);
+	ASSERT_EQ(int, hmap_count(rhs), n + 1);
+	ASSERT_TRUE(hmap_equals(map, rhs));
+	ASSERT_TRUE(hmap_equals(rhs, map));
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, i);
+		ASSERT_EQ(large, var_int(hmap_get(map, &k)), i);
+	}
+	setv_int(&k, n);
+	ASSERT_TRUE(knil == hmap_get(map, &k));
+	setv_int(&k, -1);
+	ASSERT_TRUE(knil == hmap_get(map, &k));
+	// Every pair is iterated once.
+	for (pos = hmap_next(map, 0); pos < hmap_end(map);
+	     pos = hmap_next(map, pos + 1)) {
+		const struct variable *key = hmap_key(map, pos, &buf);
+		if (ymd_type(key) == T_INT) {
+			ASSERT_EQ(large, var_int(key), var_int(hmap_val(map, pos)));
+		}
+		sum += (int)var_int(hmap_val(map, pos));
+	}
+	ASSERT_EQ(int, sum, (int)(n * (n - 1) / 2 - 1));
+	// Sparse array part moves back to hash part.
+	for (i = 0; i < n; i += 8) {
+		setv_int(&k, i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+		ASSERT_EQ(int, 0, hmap_remove(vm, map, &k));
+	}
+	for (i = 0; i < n; ++i) {
+		if (i % 8 == 0)
+			continue;
+		setv_int(&k, i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+		if (hmap_count(map) < 10)
+			break;
+	}
+	ASSERT_EQ(int, map->asize, 0);
+	ASSERT_EQ(int, map->count, 9);
+	for (++i; i < n; ++i) {
+		if (i % 8 == 0)
+			continue;
+		setv_int(&k, i);
+		ASSERT_EQ(large, var_int(hmap_get(map, &k)), i);
+	}
+	return 0;
+}
+
+static int test_hmap_ordered (struct ymd_mach *vm) {
+	struct hmap *map = hmap_new_ordered(vm, 0);
+	struct variable k, buf;
+	ymd_int_t i, n = 1000, last;
+	int pos;
+	// Descending keys, never be in array part.
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, n - i);
+		setv_int(hmap_put(vm, map, &k), i);
+	}
+	ASSERT_EQ(int, map->asize, 0);
+	ASSERT_EQ(int, hmap_count(map), n);
+	for (i = 0; i < n; i += 2) {
+		setv_int(&k, n - i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+	}
+	// Put again, it is the last one.
+	setv_int(&k, n);
+	setv_int(hmap_put(vm, map, &k), n);
+	// Removed items are not reused, table must be rehashed.
+	for (i = 0; i < n * 10; ++i) {
+		setv_int(&k, -i - 1);
+		setv_int(hmap_put(vm, map, &k), n);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+	}
+	last = -1;
+	for (pos = hmap_next(map, 0); pos < hmap_end(map);
+	     pos = hmap_next(map, pos + 1)) {
+		const struct variable *key = hmap_key(map, pos, &buf);
+		i = var_int(hmap_val(map, pos));
+		ASSERT_LT(large, last, i);
+		ASSERT_EQ(large, var_int(key), i == n ? n : n - i);
+		last = i;
+	}
+	ASSERT_EQ(large, last, n);
+	for (i = 1; i < n; i += 2) {
+		setv_int(&k, n - i);
+		ASSERT_EQ(large, var_int(hmap_get(map, &k)), i);
+	}
+	ASSERT_EQ(int, hmap_count(map), n / 2 + 1);
+	// Order is kept in small map.
+	for (i = 1; i < n - 4; i += 2) {
+		setv_int(&k, n - i);
+		ASSERT_EQ(int, 1, hmap_remove(vm, map, &k));
+	}
+	ASSERT_NULL(map->ctrl);
+	ASSERT_EQ(large, var_int(&map->item[0].v), n - 3);
+	ASSERT_EQ(large, var_int(&map->item[1].v), n - 1);
+	ASSERT_EQ(large, var_int(&map->item[2].v), n);
+	return 0;
+}
+
+static int test_hset_churn (struct ymd_mach *vm) {
+	struct hset *set = hset_new(vm, 0);
+	struct variable k;
+	ymd_int_t i, n = 1000;
+	int shift;
+	ASSERT_NULL(set->key);
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, i);
+		ASSERT_EQ(int, 1, hset_put(vm, set, &k));
+	}
+	ASSERT_EQ(int, 0, hset_put(vm, set, &k));
+	for (i = 0; i < n; i += 2) {
+		setv_int(&k, i);
+		ASSERT_EQ(int, 1, hset_remove(vm, set, &k));
+	}
+	ASSERT_EQ(int, set->count, n / 2);
+	for (i = 0; i < n; ++i) {
+		setv_int(&k, i);
+		ASSERT_EQ(int, (int)(i % 2), hset_get(set, &k));
+	}
+	// Deleted slots are cleaned in rehash, table does not grow.
+	shift = set->shift;
+	for (i = 0; i < n * 100; ++i) {
+		setv_int(&k, n + i);
+		ASSERT_EQ(int, 1, hset_put(vm, set, &k));
+		ASSERT_EQ(int, 1, hset_remove(vm, set, &k));
+	}
+	ASSERT_EQ(int, set->shift, shift);
+	for (i = 1; i < n; i += 2) {
+		setv_int(&k, i);
+		ASSERT_EQ(int, 1, hset_remove(vm, set, &k));
+	}
+	ASSERT_EQ(int, set->count, 0);
+	ASSERT_NULL(set->key);
+	return 0;
+}
+
+static int test_hset_algebra (struct ymd_mach *vm) {
+	struct hset *a = hset_new(vm, 0), *b = hset_new(vm, 0), *o;
+	struct variable k, x, y;
+	int i;
+	for (i = 0; i < 300; ++i) {
+		setv_int(&k, i);
+		hset_put(vm, a, &k);
+		setv_int(&k, i + 200);
+		hset_put(vm, b, &k);
+	}
+	o = hset_new(vm, 0);
+	hset_merge(vm, o, a);
+	hset_merge(vm, o, b);
+	ASSERT_EQ(int, o->count, 500);
+	o = hset_new(vm, 0);
+	hset_intersect(vm, o, a, b);
+	ASSERT_EQ(int, o->count, 100);
+	setv_int(&k, 250);
+	ASSERT_TRUE(hset_get(o, &k));
+	setv_int(&k, 150);
+	ASSERT_FALSE(hset_get(o, &k));
+	o = hset_new(vm, 0);
+	hset_diff(vm, o, a, b);
+	ASSERT_EQ(int, o->count, 200);
+	ASSERT_TRUE(hset_get(o, &k));
+	// Same elements in different order of slots.
+	hset_merge(vm, b, o);
+	setv_hset(&x, b);
+	o = hset_new(vm, 0);
+	for (i = 499; i >= 0; --i) {
+		setv_int(&k, i);
+		hset_put(vm, o, &k);
+	}
+	setv_hset(&y, o);
+	ASSERT_TRUE(equals(&x, &y));
+	ASSERT_EQ(int, compare(&x, &y), 0);
+	setv_int(&k, 0);
+	hset_remove(vm, o, &k);
+	ASSERT_FALSE(equals(&x, &y));
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define MIN_MAX 16
+
+//------------------------------------------------------------------
+// Binary heap:
+// -----------------------------------------------------------------
+struct heap *heap_new(struct ymd_mach *vm, struct func *cmp,
+                      struct func *key) {
+	struct heap *x = gc_new(vm, sizeof(*x), T_HEAP);
+	assert (!key || cmp == SKLS_ASC || cmp == SKLS_DASC);
+	x->cmp = cmp;
+	x->key = key;
+	return x;
+}
+
+void heap_final(struct ymd_mach *vm, struct heap *o) {
+	if (o->elem) {
+		assert (o->max > 0);
+		mm_free(vm, o->elem, o->max, sizeof(*o->elem));
+		if (o->okey)
+			mm_free(vm, o->okey, o->max, sizeof(*o->okey));
+		o->elem  = NULL;
+		o->okey  = NULL;
+		o->count = 0;
+		o->max   = 0;
+	}
+}
+
+// The key to order by of elem[i]
+#define ordk(o, i) ((o)->key ? (o)->okey + (i) : (o)->elem + (i))
+
+// Same as skip list's, the comparing function can not change the heap.
+static ymd_int_t order_compare(struct ymd_mach *vm, const struct heap *o,
+		const struct variable *lhs, const struct variable *rhs) {
+	struct ymd_context *l = ioslate(vm);
+	struct variable a, b;
+	unsigned version = o->version;
+	ymd_int_t rv;
+	if (o->cmp == SKLS_ASC)
+		return compare(lhs, rhs);
+	if (o->cmp == SKLS_DASC)
+		return compare(rhs, lhs);
+	a = *lhs; // Elements may be moved by the calling.
+	b = *rhs;
+	setv_func(ymd_push(l), o->cmp);
+	*ymd_push(l) = a;
+	*ymd_push(l) = b;
+	if (!ymd_call(l, o->cmp, 2, 0))
+		ymd_panic(l, "heap_push() Bad comparing function");
+	rv = int4of(l, ymd_top(l, 0));
+	ymd_pop(l, 1);
+	if (version != o->version)
+		ymd_panic(l, "Heap has been modified in comparing");
+	return rv;
+}
+
+#define less(vm, o, i, j) (order_compare(vm, o, ordk(o, i), ordk(o, j)) < 0)
+
+// Elements are swapped but never held out of the heap: comparing may call
+// a function and run the GC.
+static YMD_INLINE void swap(struct heap *o, int i, int j) {
+	struct variable x = o->elem[i];
+	o->elem[i] = o->elem[j];
+	o->elem[j] = x;
+	if (o->key) {
+		x = o->okey[i];
+		o->okey[i] = o->okey[j];
+		o->okey[j] = x;
+	}
+}
+
+static void sift_up(struct ymd_mach *vm, struct heap *o, int i) {
+	while (i > 0) {
+		int p = (i - 1) / 2;
+		if (!less(vm, o, i, p))
+			break;
+		swap(o, i, p);
+		i = p;
+	}
+}
+
+static void sift_down(struct ymd_mach *vm, struct heap *o, int i) {
+	for (;;) {
+		int c = 2 * i + 1;
+		if (c >= o->count)
+			break;
+		if (c + 1 < o->count && less(vm, o, c + 1, c))
+			++c;
+		if (!less(vm, o, c, i))
+			break;
+		swap(o, i, c);
+		i = c;
+	}
+}
+
+static void resize(struct ymd_mach *vm, struct heap *o) {
+	int old = o->max;
+	o->max = old ? old << 1 : MIN_MAX;
+	o->elem = mm_realloc(vm, o->elem, old, o->max, sizeof(*o->elem));
+	if (o->key)
+		o->okey = mm_realloc(vm, o->okey, old, o->max, sizeof(*o->okey));
+}
+
+void heap_push(struct ymd_mach *vm, struct heap *o, const struct variable *x) {
+	struct ymd_context *l = ioslate(vm);
+	struct variable v = *x, k;
+	setv_nil(&k);
+	if (o->key) {
+		setv_func(ymd_push(l), o->key);
+		*ymd_push(l) = v;
+		if (!ymd_call(l, o->key, 1, 0))
+			ymd_panic(l, "heap_push() Bad key function");
+		k = *ymd_top(l, 0);
+	}
+	if (o->count >= o->max)
+		resize(vm, o);
+	o->elem[o->count] = v;
+	if (o->key) {
+		o->okey[o->count] = k;
+		ymd_pop(l, 1); // Now it is in the heap.
+	}
+	++o->count;
+	++o->version;
+	sift_up(vm, o, o->count - 1);
+}
+
+void heap_pop(struct ymd_mach *vm, struct heap *o) {
+	assert (o->count > 0);
+	--o->count;
+	++o->version;
+	o->elem[0] = o->elem[o->count];
+	setv_nil(o->elem + o->count);
+	if (o->key) {
+		o->okey[0] = o->okey[o->count];
+		setv_nil(o->okey + o->count);
+	}
+	sift_down(vm, o, 0);
+}
@@ -0,0 +1,67 @@
+#include "core.h"
+#include "heap_test.def"
+
+static struct ymd_mach *setup() {
+	struct ymd_mach *vm = ymd_init();
+	gc_active(vm, +1);
+	return vm;
+}
+
+static void teardown(struct ymd_mach *vm) {
+	gc_active(vm, -1);
+	ymd_final(vm);
+}
+
+static int pop_int(struct ymd_mach *vm, struct heap *o) {
+	int rv = (int)var_int(heap_peek(o));
+	heap_pop(vm, o);
+	return rv;
+}
+
+static int test_heap_order(struct ymd_mach *vm) {
+	struct heap *asc = heap_new(vm, SKLS_ASC, NULL),
+	            *dasc = heap_new(vm, SKLS_DASC, NULL);
+	struct variable x;
+	int i, prev;
+	ASSERT_NULL(heap_peek(asc));
+	for (i = 0; i < 1000; ++i) {
+		setv_int(&x, (i * 7919) % 101);
+		heap_push(vm, asc, &x);
+		heap_push(vm, dasc, &x);
+	}
+	ASSERT_EQ(int, asc->count, 1000);
+	prev = pop_int(vm, asc);
+	while (asc->count > 0) {
+		int k = pop_int(vm, asc);
+		ASSERT_LE(int, prev, k);
+		prev = k;
+	}
+	prev = pop_int(vm, dasc);
+	while (dasc->count > 0) {
+		int k = pop_int(vm, dasc);
+		ASSERT_GE(int, prev, k);
+		prev = k;
+	}
+	ASSERT_NULL(heap_peek(dasc));
+	return 0;
+}
+
+// Popped slots are cleared, nothing is referenced out of count.
+static int test_heap_interleaved(struct ymd_mach *vm) {
+	struct heap *o = heap_new(vm, SKLS_ASC, NULL);
+	struct variable x;
+	int i;
+	for (i = 0; i < 100; ++i) {
+		setv_int(&x, 100 - i);
+		heap_push(vm, o, &x);
+		setv_int(&x, 1000 + i);
+		heap_push(vm, o, &x);
+	}
+	for (i = 0; i < 100; ++i)
+		ASSERT_EQ(int, pop_int(vm, o), i + 1);
+	ASSERT_EQ(int, o->count, 100);
+	ASSERT_EQ(large, var_int(heap_peek(o)), 1000);
+	for (i = o->count; i < 200; ++i)
+		ASSERT_TRUE(is_nil(o->elem + i));
+	return 0;
+}
@@ -76,6 +76,9 @@ static void checked_put(L, struct variable *arg0,
 	case T_SKLS:
 		*skls_put(l->vm, skls_x(arg0), k) = *v;
 		break;
+	case T_BTRE:
+		*btre_put(l->vm, btre_x(arg0), k) = *v;
+		break;
 	default:
 		ymd_panic(l, "insert() don't support `%s'",
 				typeof_kz(ymd_type(arg0)));
@@ -122,6 +125,30 @@ static int libx_append(L) {
 			*skls_put(l->vm, skls_x(arg0), pair->elem) = pair->elem[1];
 		}
 		break;
+	case T_BTRE:
+		for (i = 1; i < ymd_argc(l); ++i) {
+			struct dyay *pair = dyay_of(l, ymd_argv(l, i));
+			*btre_put(l->vm, btre_x(arg0), pair->elem) = pair->elem[1];
+		}
+		break;
+	case T_PKAY:
+		for (i = 1; i < ymd_argc(l); ++i)
+			pkay_add(l->vm, pkay_x(arg0), ymd_argv(l, i));
+		break;
+	case T_DEQU:
+		for (i = 1; i < ymd_argc(l); ++i) {
+			if (is_nil(ymd_argv(l, i)))
+				ymd_panic(l, "Element of deque can not be `nil`");
+			*dequ_push(l->vm, dequ_x(arg0), 0) = *ymd_argv(l, i);
+		}
+		break;
+	case T_HSET:
+		for (i = 1; i < ymd_argc(l); ++i) {
+			if (is_nil(ymd_argv(l, i)))
+				ymd_panic(l, "Element of set can not be `nil`");
+			hset_put(l->vm, hset_x(arg0), ymd_argv(l, i));
+		}
+		break;
 	default:
 		ymd_panic(l, "append() don't support `%s'",
 				typeof_kz(ymd_type(arg0)));
@@ -139,6 +166,283 @@ static int libx_remove(L) {
 	return 1;
 }
 
+// deque(...)
+//     New deque of arguments, from front to back.
+static int libx_deque(L) {
+	struct dequ *o = ymd_dequ(l, ymd_argc(l));
+	int i;
+	for (i = 0; i < ymd_argc(l); ++i) {
+		if (is_nil(ymd_argv(l, i)))
+			ymd_panic(l, "Element of deque can not be `nil`");
+		*dequ_push(l->vm, o, 0) = *ymd_argv(l, i);
+	}
+	return 1;
+}
+
+static void do_push(L, int front) {
+	struct variable *arg0 = ymd_argv(l, 0);
+	int i;
+	for (i = 1; i < ymd_argc(l); ++i) {
+		if (is_nil(ymd_argv(l, i)))
+			ymd_panic(l, "Element of deque can not be `nil`");
+	}
+	switch (ymd_type(arg0)) {
+	case T_DEQU:
+		for (i = 1; i < ymd_argc(l); ++i)
+			*dequ_push(l->vm, dequ_x(arg0), front) = *ymd_argv(l, i);
+		break;
+	case T_DYAY:
+		for (i = 1; i < ymd_argc(l); ++i) {
+			struct dyay *o = dyay_x(arg0);
+			if (front && o->count > 0)
+				*dyay_insert(l->vm, o, 0) = *ymd_argv(l, i);
+			else
+				*dyay_add(l->vm, o) = *ymd_argv(l, i);
+		}
+		break;
+	default:
+		ymd_panic(l, "push_%s() don't support `%s'", front ? "front" : "back",
+		          typeof_kz(ymd_type(arg0)));
+		break;
+	}
+}
+
+// push_front(deque, ...)
+// push_back(deque, ...)
+//     Push arguments one by one, O(1) for a deque. push_front(d, 1, 2) makes
+//     2 be the front. Arrays are also accepted, but push_front() moves all
+//     elements of an array.
+static int libx_push_front(L) {
+	do_push(l, 1);
+	return 0;
+}
+
+static int libx_push_back(L) {
+	do_push(l, 0);
+	return 0;
+}
+
+// pop_front(deque)
+// pop_back(deque)
+//     Remove and return the front or back element, nil if it is empty.
+static int do_pop(L, int front) {
+	struct variable *arg0 = ymd_argv(l, 0), rv;
+	switch (ymd_type(arg0)) {
+	case T_DEQU:
+		if (!dequ_pop(dequ_x(arg0), front, &rv))
+			return 0;
+		break;
+	case T_DYAY: {
+		struct dyay *o = dyay_x(arg0);
+		int i = front ? 0 : o->count - 1;
+		if (o->count == 0)
+			return 0;
+		rv = o->elem[i];
+		dyay_remove(l->vm, o, i);
+		} break;
+	default:
+		ymd_panic(l, "pop_%s() don't support `%s'", front ? "front" : "back",
+		          typeof_kz(ymd_type(arg0)));
+		return 0;
+	}
+	*ymd_push(l) = rv;
+	return 1;
+}
+
+static int libx_pop_front(L) {
+	return do_pop(l, 1);
+}
+
+static int libx_pop_back(L) {
+	return do_pop(l, 0);
+}
+
+// heap()
+// heap("<")
+//     New min heap, the least one is popped first.
+// heap(">")
+//     New max heap.
+// heap("<", key), heap(">", key)
+//     Order by key(x), key(x) is called once for each pushing.
+// heap(cmp)
+//     Order by cmp(a, b), `a' is popped first if cmp(a, b) < 0.
+static int libx_heap(L) {
+	struct variable *arg0 = ymd_argc(l) > 0 ? ymd_argv(l, 0) : NULL;
+	struct func *cmp = SKLS_ASC, *key = NULL;
+	if (arg0 && ymd_type(arg0) == T_FUNC) {
+		cmp = func_x(arg0);
+	} else if (arg0 && !is_nil(arg0)) {
+		const char *order = kstr_of(l, arg0)->land;
+		if (strcmp(order, ">") == 0)
+			cmp = SKLS_DASC;
+		else if (strcmp(order, "<") != 0)
+			ymd_panic(l, "heap() bad order: %s, need \"<\" or \">\"", order);
+		if (ymd_argc(l) > 1 && !is_nil(ymd_argv(l, 1)))
+			key = func_of(l, ymd_argv(l, 1));
+	}
+	ymd_heap(l, cmp, key);
+	return 1;
+}
+
+// push(heap, ...)
+//     Push arguments one by one, O(log n) for each one.
+static int libx_push(L) {
+	struct heap *o = heap_of(l, ymd_argv(l, 0));
+	int i;
+	for (i = 1; i < ymd_argc(l); ++i) {
+		if (is_nil(ymd_argv(l, i)))
+			ymd_panic(l, "Element of heap can not be `nil`");
+		heap_push(l->vm, o, ymd_argv(l, i));
+	}
+	return 0;
+}
+
+// pop(heap)
+//     Remove and return the first one in order, nil if it is empty.
+static int libx_pop(L) {
+	struct heap *o = heap_of(l, ymd_argv(l, 0));
+	if (!heap_peek(o))
+		return 0;
+	*ymd_push(l) = *heap_peek(o); // Keep it alive while popping.
+	heap_pop(l->vm, o);
+	return 1;
+}
+
+// peek(heap)
+//     The first one in order without removing, nil if it is empty. O(1)
+// peek(lru, k)
+//     Value of `k' without changing recency and counters, nil if missing.
+static int libx_peek(L) {
+	const struct heap *o;
+	if (ymd_type(ymd_argv(l, 0)) == T_LRUC) {
+		*ymd_push(l) = *lruc_peek(lruc_k(ymd_argv(l, 0)), ymd_argv(l, 1));
+		return 1;
+	}
+	o = heap_of(l, ymd_argv(l, 0));
+	if (!heap_peek(o))
+		return 0;
+	*ymd_push(l) = *heap_peek(o);
+	return 1;
+}
+
+// set(...)
+//     New set of arguments.
+static int libx_set(L) {
+	struct hset *o = ymd_hset(l, ymd_argc(l));
+	int i;
+	for (i = 0; i < ymd_argc(l); ++i) {
+		if (is_nil(ymd_argv(l, i)))
+			ymd_panic(l, "Element of set can not be `nil`");
+		hset_put(l->vm, o, ymd_argv(l, i));
+	}
+	return 1;
+}
+
+// Argument `i' as a set: an array is converted to a new set in stack.
+static const struct hset *set_of(L, int i) {
+	const struct variable *arg = ymd_argv(l, i);
+	const struct dyay *a;
+	struct hset *o;
+	int j;
+	if (ymd_type(arg) != T_DYAY)
+		return hset_of(l, ymd_argv(l, i));
+	a = dyay_k(arg);
+	o = ymd_hset(l, a->count);
+	for (j = 0; j < a->count; ++j) {
+		if (!is_nil(a->elem + j))
+			hset_put(l->vm, o, a->elem + j);
+	}
+	return o;
+}
+
+// union(a, b)
+// intersect(a, b)
+// difference(a, b)
+//     New set of elements in a or b, in both of a and b, or in a but not
+//     in b. An array argument is same as a set of its elements.
+static int do_algebra(L, int op) {
+	const struct hset *a = set_of(l, 0), *b = set_of(l, 1);
+	int k = (ymd_type(ymd_argv(l, 0)) == T_DYAY) +
+	        (ymd_type(ymd_argv(l, 1)) == T_DYAY);
+	struct hset *o = ymd_hset(l, 0);
+	switch (op) {
+	case 0: // Bigger one's table is copied.
+		hset_merge(l->vm, o, a->count >= b->count ? a : b);
+		hset_merge(l->vm, o, a->count >= b->count ? b : a);
+		break;
+	case 1:
+		hset_intersect(l->vm, o, a, b);
+		break;
+	default:
+		hset_diff(l->vm, o, a, b);
+		break;
+	}
+	if (k > 0) { // Drop the converted sets.
+		*ymd_top(l, k) = *ymd_top(l, 0);
+		ymd_pop(l, k);
+	}
+	return 1;
+}
+
+static int libx_union(L) {
+	return do_algebra(l, 0);
+}
+
+static int libx_intersect(L) {
+	return do_algebra(l, 1);
+}
+
+static int libx_difference(L) {
+	return do_algebra(l, 2);
+}
+
+// lru(capacity)
+// lru(capacity, evict)
+//     New LRU cache of `capacity' pairs. c[k] gets value and makes it the
+//     most recently used one, c[k] = v puts and evicts the least recently
+//     used ones if it is full, c[k] = nil removes. All of them are O(1).
+//     evict(k, v) is called after each evicting.
+// lru(bytes, "bytes")
+// lru(bytes, "bytes", evict)
+//     Capacity in bytes: a pair costs its node and length of strings in
+//     it, see lruc_bytes().
+static int libx_lru(L) {
+	ymd_int_t limit = int_of(l, ymd_argv(l, 0));
+	struct func *evict = NULL;
+	int i = 1, inbytes = 0;
+	if (limit <= 0)
+		ymd_panic(l, "lru() bad capacity: %lld", limit);
+	if (ymd_argc(l) > i && ymd_type(ymd_argv(l, i)) == T_KSTR) {
+		const char *unit = kstr_of(l, ymd_argv(l, i))->land;
+		if (strcmp(unit, "bytes") == 0)
+			inbytes = 1;
+		else if (strcmp(unit, "entries") != 0)
+			ymd_panic(l, "lru() bad unit: %s, need \"entries\" or "
+			          "\"bytes\"", unit);
+		++i;
+	}
+	if (ymd_argc(l) > i && !is_nil(ymd_argv(l, i)))
+		evict = func_of(l, ymd_argv(l, i));
+	ymd_lruc(l, limit, inbytes, evict);
+	return 1;
+}
+
+// stats(lru)
+//     Counters of LRU cache: {hits, misses, evictions, bytes}
+static int libx_stats(L) {
+	const struct lruc *o = lruc_of(l, ymd_argv(l, 0));
+	ymd_hmap(l, 4);
+	ymd_int(l, o->hit);
+	ymd_def(l, "hits");
+	ymd_int(l, o->miss);
+	ymd_def(l, "misses");
+	ymd_int(l, o->evicted);
+	ymd_def(l, "evictions");
+	ymd_int(l, o->bytes);
+	ymd_def(l, "bytes");
+	return 1;
+}
+
 // len(arg)
 // argument follow:
 // nil      : always be 0;
@@ -146,6 +450,12 @@ static int libx_remove(L) {
 // array    : number of elements; 
 // hashmap  : number of k-v pairs;
 // skiplist : number of k-v pairs;
+// btree    : number of k-v pairs;
+// packed   : number of elements;
+// deque    : number of elements;
+// heap     : number of elements;
+// set      : number of elements;
+// lru      : number of k-v pairs;
 static int libx_len(L) {
 	const struct variable *arg0 = ymd_argv(l, 0);
 	switch (ymd_type(arg0)) {
@@ -158,20 +468,30 @@ static int libx_len(L) {
 	case T_DYAY:
 		ymd_int(l, dyay_k(arg0)->count);
 		break;
-	case T_HMAP: {
-		ymd_int_t n = 0;
-		struct kvi *i = hmap_k(arg0)->item,
-				   *k = i + (1 << hmap_k(arg0)->shift);
-		for (; i != k; ++i)
-			if (i->flag) ++n;
-		ymd_int(l, n);
-		} break;
-	case T_SKLS: {
-		ymd_int_t n = 0;
-		struct sknd *i = skls_k(arg0)->head->fwd[0];
-		for (; i != NULL; i = i->fwd[0]) ++n;
-		ymd_int(l, n);
-		} break;
+	case T_HMAP:
+		ymd_int(l, hmap_count(hmap_k(arg0)));
+		break;
+	case T_SKLS:
+		ymd_int(l, skls_k(arg0)->count);
+		break;
+	case T_BTRE:
+		ymd_int(l, btre_k(arg0)->count);
+		break;
+	case T_PKAY:
+		ymd_int(l, pkay_k(arg0)->count);
+		break;
+	case T_DEQU:
+		ymd_int(l, dequ_k(arg0)->count);
+		break;
+	case T_HEAP:
+		ymd_int(l, heap_k(arg0)->count);
+		break;
+	case T_HSET:
+		ymd_int(l, hset_k(arg0)->count);
+		break;
+	case T_LRUC:
+		ymd_int(l, lruc_k(arg0)->count);
+		break;
 	default:
 		ymd_panic(l, "len() don't support `%s', need a container or "
 				"string type", typeof_kz(ymd_type(arg0)));
@@ -190,6 +510,12 @@ static int libx_len(L) {
 // function -> "func (...) {...}"
 // hashmap  -> "{name:John, content:{1,2,3}}"
 // skiplist -> "@{name:John, content:{1,2,3}}"
+// btree    -> "@@{name:John, content:{1,2,3}}"
+// packed   -> "int64[1, 2, 3]"
+// deque    -> "deque[1, 2, 3]"
+// heap     -> "heap[1, 3, 2]"
+// set      -> "set{1, 2, 3}"
+// lru      -> "lru{c : 3, b : 2, a : 1}"
 // managed  -> "(stream)[24@0x08067FF]"
 static int libx_str(L) {
 	const struct variable *arg0 = ymd_argv(l, 0);
@@ -214,12 +540,12 @@ static int step_iter(L) {
 					*s = ymd_upval(l, 2),
 					rv;
 	setv_nil(&rv);
-	if (s->u.i > 0 && i->u.i < m->u.i) {
-		setv_int(&rv, i->u.i);
-	} else if (s->u.i < 0 && i->u.i > m->u.i) {
-		setv_int(&rv, i->u.i);
+	if (var_int(s) > 0 && var_int(i) < var_int(m)) {
+		setv_int(&rv, var_int(i));
+	} else if (var_int(s) < 0 && var_int(i) > var_int(m)) {
+		setv_int(&rv, var_int(i));
 	}
-	i->u.i += s->u.i;
+	setv_int(i, var_int(i) + var_int(s));
 	*ymd_push(l) = rv;
 	return 1;
 }
@@ -240,154 +566,393 @@ static int new_step_iter(L, ymd_int_t i, ymd_int_t m, ymd_int_t s) {
 #define ITER_VALUE 1
 #define ITER_KV    2
 
+// Container iterator:
+// bind[0]: struct iter; state in a managed data
+// bind[1]: container self
+// argv[0]: 2 if called by `for k, v in ...', ITER_KV iterator returns key
+//          and value as 2 variables, no any array made.
+// Iterator returns nothing at the end, same as `end'.
+struct iter {
+	int flag; // ITER_KEY, ITER_VALUE or ITER_KV
+	int i; // dyay: index, hmap: position of next pair, btre: index in leaf
+	       // lruc: next node
+	unsigned version; // container's version when iterator created
+	struct sknd *x; // skls: next node
+	struct sknd *end; // skls: node to stop at, NULL for the end of list
+	int rev; // skls, btre: walk backward
+	struct btlf *lf; // btre: leaf of next pair
+	struct btlf *lf_end; // btre: position to stop at: `lf_end' and `i_end',
+	int i_end;           //       NULL and 0 for the end of tree.
+};
+
+static const char *T_ITER = "iterator";
+
+// Raise a error if container has been modified.
+static YMD_INLINE struct iter *iter_of(L, unsigned version) {
+	struct iter *x = (struct iter *)mand_k(ymd_upval(l, 0))->land;
+	if (x->version != version) {
+		ymd_error(l, "Container has been modified in iteration");
+		ymd_raise(l);
+	}
+	return x;
+}
+
+// Anything else but int 2 means one variable, iterator may be called by
+// script directly.
+static YMD_INLINE int iter_nret(L) {
+	const struct variable *arg0;
+	if (ymd_argc(l) == 0)
+		return 1;
+	arg0 = ymd_argv(l, 0);
+	return ymd_type(arg0) == T_INT && var_int(arg0) == 2 ? 2 : 1;
+}
+
+static struct iter *new_iter(L, ymd_nafn_t fn, const char *name,
+                             const struct variable *obj, int flag,
+                             unsigned version) {
+	struct variable self = *obj; // `obj' may be in stack, pushing moves it.
+	struct iter *x;
+	ymd_nafn(l, fn, name, 2);
+	x = ymd_mand(l, T_ITER, sizeof(*x), NULL);
+	ymd_bind(l, 0);
+	*ymd_push(l) = self;
+	ymd_bind(l, 1);
+	x->flag = flag;
+	x->version = version;
+	return x;
+}
+
 // Dynamic array iterator
-// bind[0]: struct variable *i; current pointer
-// bind[1]: struct variable *m; end of pointer
-// bind[2]: int idx; index counter
-// bind[3]: iterator flag
-// bind[4]: dyay self
 static int dyay_iter(L) {
-	struct variable *i = ymd_upval(l, 0)->u.ext,
-	                *m = ymd_upval(l, 1)->u.ext;
-	if (i >= m)
+	const struct dyay *o = dyay_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	int rv = 1;
+	if (x->i >= o->count)
 		return 0;
-	switch (int_of(l, ymd_upval(l, 3))) {
-	case ITER_KEY: {
-		ymd_int_t idx = int_of(l, ymd_upval(l, 2));
-		ymd_int(l, idx);
-		setv_int(ymd_upval(l, 2), idx + 1);
-		} break;
-	case ITER_VALUE: {
-		*ymd_push(l) = *i;
-		} break;
-	case ITER_KV: {
-		ymd_int_t idx = int_of(l, ymd_upval(l, 2));
+	switch (x->flag) {
+	case ITER_KEY:
+		ymd_int(l, x->i);
+		break;
+	case ITER_VALUE:
+		*ymd_push(l) = o->elem[x->i];
+		break;
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			ymd_int(l, x->i);
+			*ymd_push(l) = o->elem[x->i];
+			break;
+		}
 		ymd_dyay(l, 2);
-		ymd_int(l, idx);
-		ymd_add(l);
-		*ymd_push(l) = *i;
-		ymd_add(l);
-		setv_int(ymd_upval(l, 2), idx + 1);
-		} break;
+		ymd_int(l, x->i); ymd_add(l);
+		*ymd_push(l) = o->elem[x->i]; ymd_add(l);
+		break;
 	default:
 		assert(!"No reached.");
 		break;
 	}
-	setv_ext(ymd_upval(l, 0), i + 1);
-	return 1;
+	++x->i;
+	return rv;
 }
 
-// Move hash map's slot to next valid one:
-static YMD_INLINE struct kvi *move2valid(struct kvi *i, struct kvi *m) {
-	while (i < m && i->flag == 0) ++i;
-	return i;
+// Packed array iterator
+static int pkay_iter(L) {
+	const struct pkay *o = pkay_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	struct variable v;
+	int rv = 1;
+	if (x->i >= o->count)
+		return 0;
+	pkay_get(o, x->i, &v);
+	switch (x->flag) {
+	case ITER_KEY:
+		ymd_int(l, x->i);
+		break;
+	case ITER_VALUE:
+		*ymd_push(l) = v;
+		break;
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			ymd_int(l, x->i);
+			*ymd_push(l) = v;
+			break;
+		}
+		ymd_dyay(l, 2);
+		ymd_int(l, x->i); ymd_add(l);
+		*ymd_push(l) = v; ymd_add(l);
+		break;
+	default:
+		assert(!"No reached.");
+		break;
+	}
+	++x->i;
+	return rv;
 }
 
 // Hash map iterator
-// bind[0]: struct kvi *i; current pointer
-// bind[1]: struct kvi *m; end of pointer
-// bind[2]: iterator flag
 static int hmap_iter(L) {
-	struct kvi *i = ymd_upval(l, 0)->u.ext,
-			   *m = ymd_upval(l, 1)->u.ext;
-	if (i >= m) {
-		setv_nil(ymd_push(l));
-		return 1;
+	const struct hmap *o = hmap_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	struct variable k;
+	int rv = 1, i = hmap_next(o, x->i);
+	if (i >= hmap_end(o))
+		return 0;
+	switch (x->flag) {
+	case ITER_KEY:
+		*ymd_push(l) = *hmap_key(o, i, &k);
+		break;
+	case ITER_VALUE:
+		*ymd_push(l) = *hmap_val(o, i);
+		break;
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			*ymd_push(l) = *hmap_key(o, i, &k);
+			*ymd_push(l) = *hmap_val(o, i);
+			break;
+		}
+		ymd_dyay(l, 2);
+		*ymd_push(l) = *hmap_key(o, i, &k); ymd_add(l);
+		*ymd_push(l) = *hmap_val(o, i); ymd_add(l);
+		break;
+	default:
+		assert(!"No reached.");
+		break;
 	}
-	switch (int_of(l, ymd_upval(l, 2))) {
+	x->i = i + 1;
+	return rv;
+}
+
+// Set iterator: keys() and values() get elements, pairs() gets
+// element and true.
+static int hset_iter(L) {
+	const struct hset *o = hset_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	int rv = 1, i = x->i;
+	while (i < hset_nslot(o) && !hset_full(o, i))
+		++i;
+	if (i >= hset_nslot(o))
+		return 0;
+	switch (x->flag) {
 	case ITER_KEY:
-		*ymd_push(l) = i->k;
+	case ITER_VALUE:
+		*ymd_push(l) = o->key[i];
+		break;
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			*ymd_push(l) = o->key[i];
+			ymd_bool(l, 1);
+			break;
+		}
+		ymd_dyay(l, 2);
+		*ymd_push(l) = o->key[i]; ymd_add(l);
+		ymd_bool(l, 1); ymd_add(l);
+		break;
+	default:
+		assert(!"No reached.");
+		break;
+	}
+	x->i = i + 1;
+	return rv;
+}
+
+// LRU cache iterator, from the most recently used one to the least.
+// Iterating does not change recency, but c[k] does, so use peek() in loop.
+static int lruc_iter(L) {
+	const struct lruc *o = lruc_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	const struct lrnd *nd;
+	int rv = 1;
+	if (x->i < 0)
+		return 0;
+	nd = o->node + x->i;
+	switch (x->flag) {
+	case ITER_KEY:
+		*ymd_push(l) = nd->k;
 		break;
 	case ITER_VALUE:
-		*ymd_push(l) = i->v;
+		*ymd_push(l) = nd->v;
 		break;
-	case ITER_KV: {
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			*ymd_push(l) = nd->k;
+			*ymd_push(l) = nd->v;
+			break;
+		}
 		ymd_dyay(l, 2);
-		*ymd_push(l) = i->k; ymd_add(l);
-		*ymd_push(l) = i->v; ymd_add(l);
-		} break;
+		*ymd_push(l) = nd->k; ymd_add(l);
+		*ymd_push(l) = nd->v; ymd_add(l);
+		break;
 	default:
 		assert(!"No reached.");
 		break;
 	}
-	setv_ext(ymd_upval(l, 0), move2valid(i + 1, m));
-	return 1;
+	x->i = nd->next;
+	return rv;
 }
 
 // Skip list iterator
-// bind[0]: struct sknd *i; current pointer
-// bind[1]: iterator flag
 static int skls_iter(L) {
-	struct sknd *i = ymd_upval(l, 0)->u.ext;
-	if (!i) {
-		setv_nil(ymd_push(l));
-		return 1;
+	const struct skls *o = skls_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	int rv = 1;
+	if (x->x == x->end)
+		return 0;
+	switch (x->flag) {
+	case ITER_KEY:
+		*ymd_push(l) = x->x->k;
+		break;
+	case ITER_VALUE:
+		*ymd_push(l) = x->x->v;
+		break;
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			*ymd_push(l) = x->x->k;
+			*ymd_push(l) = x->x->v;
+			break;
+		}
+		ymd_dyay(l, 2);
+		*ymd_push(l) = x->x->k; ymd_add(l);
+		*ymd_push(l) = x->x->v; ymd_add(l);
+		break;
+	default:
+		assert(!"No reached.");
+		break;
+	}
+	x->x = x->rev ? x->x->bwd : x->x->fwd[0];
+	return rv;
+}
+
+// Move B+ tree position to next or prev pair, NULL and 0 if no one.
+static YMD_INLINE void btre_step(struct btlf **lf, int *i, int rev) {
+	if (!rev) {
+		if (++*i < (*lf)->nd.n)
+			return;
+		*lf = (*lf)->next;
+		*i = 0;
+		return;
 	}
-	switch (int_of(l, ymd_upval(l, 1))) {
+	if (--*i >= 0)
+		return;
+	*lf = (*lf)->prev;
+	*i = *lf ? (*lf)->nd.n - 1 : 0;
+}
+
+// B+ tree iterator
+static int btre_iter(L) {
+	const struct btre *o = btre_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	int rv = 1;
+	if (x->lf == x->lf_end && x->i == x->i_end)
+		return 0;
+	switch (x->flag) {
 	case ITER_KEY:
-		*ymd_push(l) = i->k;
+		*ymd_push(l) = x->lf->nd.k[x->i];
 		break;
 	case ITER_VALUE:
-		*ymd_push(l) = i->v;
+		*ymd_push(l) = x->lf->v[x->i];
 		break;
-	case ITER_KV: {
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			*ymd_push(l) = x->lf->nd.k[x->i];
+			*ymd_push(l) = x->lf->v[x->i];
+			break;
+		}
 		ymd_dyay(l, 2);
-		*ymd_push(l) = i->k; ymd_add(l);
-		*ymd_push(l) = i->v; ymd_add(l);
-		} break;
+		*ymd_push(l) = x->lf->nd.k[x->i]; ymd_add(l);
+		*ymd_push(l) = x->lf->v[x->i]; ymd_add(l);
+		break;
 	default:
 		assert(!"No reached.");
 		break;
 	}
-	setv_ext(ymd_upval(l, 0), i->fwd[0]);
-	return 1;
+	btre_step(&x->lf, &x->i, x->rev);
+	return rv;
+}
+
+// Deque iterator, from front to back
+static int dequ_iter(L) {
+	const struct dequ *o = dequ_k(ymd_upval(l, 1));
+	struct iter *x = iter_of(l, o->version);
+	int rv = 1;
+	if (x->i >= o->count)
+		return 0;
+	switch (x->flag) {
+	case ITER_KEY:
+		ymd_int(l, x->i);
+		break;
+	case ITER_VALUE:
+		*ymd_push(l) = *dequ_get(o, x->i);
+		break;
+	case ITER_KV:
+		if ((rv = iter_nret(l)) == 2) {
+			ymd_int(l, x->i);
+			*ymd_push(l) = *dequ_get(o, x->i);
+			break;
+		}
+		ymd_dyay(l, 2);
+		ymd_int(l, x->i); ymd_add(l);
+		*ymd_push(l) = *dequ_get(o, x->i); ymd_add(l);
+		break;
+	default:
+		assert(!"No reached.");
+		break;
+	}
+	++x->i;
+	return rv;
 }
 
 static int new_contain_iter(L, const struct variable *obj, int flag) {
 	switch (ymd_type(obj)) {
 	case T_DYAY:
-		ymd_nafn(l, dyay_iter, "__dyay_iter__", 5);
-		ymd_ext(l, dyay_k(obj)->elem);
-		ymd_bind(l, 0);
-		ymd_ext(l, dyay_k(obj)->elem + dyay_k(obj)->count);
-		ymd_bind(l, 1);
-		ymd_int(l, 0);
-		ymd_bind(l, 2);
-		ymd_int(l, flag);
-		ymd_bind(l, 3);
-		setv_ref(ymd_push(l), obj->u.ref);
-		ymd_bind(l, 4);
+		new_iter(l, dyay_iter, "__dyay_iter__", obj, flag,
+		         dyay_k(obj)->version);
+		return 1;
+	case T_PKAY:
+		new_iter(l, pkay_iter, "__pkay_iter__", obj, flag,
+		         pkay_k(obj)->version);
+		return 1;
+	case T_DEQU:
+		new_iter(l, dequ_iter, "__dequ_iter__", obj, flag,
+		         dequ_k(obj)->version);
 		return 1;
+	case T_HSET:
+		new_iter(l, hset_iter, "__hset_iter__", obj, flag,
+		         hset_k(obj)->version);
+		return 1;
+	case T_LRUC: {
+		struct iter *x = new_iter(l, lruc_iter, "__lruc_iter__", obj, flag,
+		                          lruc_k(obj)->version);
+		x->i = lruc_k(obj)->head;
+		} return 1;
 	case T_HMAP: {
-		struct kvi *m = hmap_k(obj)->item + (1 << hmap_k(obj)->shift),
-				   *i = move2valid(hmap_k(obj)->item, m);
-		if (i >= m) {
+		const struct hmap *o = hmap_k(obj);
+		int i = hmap_next(o, 0);
+		struct iter *x;
+		if (i >= hmap_end(o)) {
 			ymd_nafn(l, libx_end, "end", 0);
 			return 1;
 		}
-		ymd_nafn(l, hmap_iter, "__hmap_iter__", 4);
-		ymd_ext(l, i);
-		ymd_bind(l, 0);
-		ymd_ext(l, m);
-		ymd_bind(l, 1);
-		ymd_int(l, flag);
-		ymd_bind(l, 2);
-		setv_ref(ymd_push(l), obj->u.ref);
-		ymd_bind(l, 3);
+		x = new_iter(l, hmap_iter, "__hmap_iter__", obj, flag, o->version);
+		x->i = i;
 		} return 1;
 	case T_SKLS: {
-		struct sknd *i = skls_k(obj)->head->fwd[0];
-		if (!i) {
+		const struct skls *o = skls_k(obj);
+		struct iter *x;
+		if (!o->head->fwd[0]) {
 			ymd_nafn(l, libx_end, "end", 0);
 			return 1;
 		}
-		ymd_nafn(l, skls_iter, "__skls_iter__", 3);
-		ymd_ext(l, i);
-		ymd_bind(l, 0);
-		ymd_int(l, flag);
-		ymd_bind(l, 1);
-		setv_ref(ymd_push(l), obj->u.ref);
-		ymd_bind(l, 2);
+		x = new_iter(l, skls_iter, "__skls_iter__", obj, flag, o->version);
+		x->x = o->head->fwd[0];
+		} return 1;
+	case T_BTRE: {
+		const struct btre *o = btre_k(obj);
+		struct iter *x;
+		if (!o->first) {
+			ymd_nafn(l, libx_end, "end", 0);
+			return 1;
+		}
+		x = new_iter(l, btre_iter, "__btre_iter__", obj, flag, o->version);
+		x->lf = o->first;
 		} return 1;
 	default:
 		ymd_panic(l, "Type is not be supported");
@@ -396,12 +961,112 @@ static int new_contain_iter(L, const struct variable *obj, int flag) {
 	return 0;
 }
 
+// Skip list range cursor: pairs in [lo, hi) of the list's order, walks
+// nodes in place. A missing bound means the end of list.
+static int new_skls_range(L, int rev) {
+	const struct skls *o = skls_of(l, ymd_argv(l, 0));
+	// Copy bounds: comparing function may move the stack.
+	struct variable lo, hi;
+	struct sknd *first, *last;
+	struct iter *x;
+	setv_nil(&lo);
+	setv_nil(&hi);
+	if (ymd_argc(l) > 1)
+		lo = *ymd_argv(l, 1);
+	if (ymd_argc(l) > 2)
+		hi = *ymd_argv(l, 2);
+	if (!is_nil(&lo) && !is_nil(&hi) &&
+		skls_key_compare(l->vm, o, &lo, &hi) > 0) {
+		struct variable tmp = lo;
+		lo = hi;
+		hi = tmp;
+	}
+	// [first, last) in forward order
+	first = !is_nil(&lo) ? skls_direct(l->vm, o, &lo) : o->head->fwd[0];
+	last  = !is_nil(&hi) ? skls_direct(l->vm, o, &hi) : NULL;
+	if (first == last) {
+		ymd_nafn(l, libx_end, "end", 0);
+		return 1;
+	}
+	x = new_iter(l, skls_iter, "__skls_iter__", ymd_argv(l, 0), ITER_KV,
+	             o->version);
+	if (rev) {
+		x->x = last ? last->bwd : o->tail;
+		x->end = first->bwd;
+		x->rev = 1;
+	} else {
+		x->x = first;
+		x->end = last;
+	}
+	return 1;
+}
+
+// B+ tree range cursor: same as skip list's, walks leaves in place.
+static int new_btre_range(L, int rev) {
+	const struct btre *o = btre_of(l, ymd_argv(l, 0));
+	// Copy bounds: comparing function may move the stack.
+	struct variable lo, hi;
+	struct btlf *first = o->first, *last = NULL;
+	int i = 0, k = 0;
+	struct iter *x;
+	setv_nil(&lo);
+	setv_nil(&hi);
+	if (ymd_argc(l) > 1)
+		lo = *ymd_argv(l, 1);
+	if (ymd_argc(l) > 2)
+		hi = *ymd_argv(l, 2);
+	if (!is_nil(&lo) && !is_nil(&hi) &&
+		btre_key_compare(l->vm, o, &lo, &hi) > 0) {
+		struct variable tmp = lo;
+		lo = hi;
+		hi = tmp;
+	}
+	// [first:i, last:k) in forward order
+	if (!is_nil(&lo))
+		i = btre_direct(l->vm, o, &lo, &first);
+	if (!is_nil(&hi))
+		k = btre_direct(l->vm, o, &hi, &last);
+	if (first == last && i == k) {
+		ymd_nafn(l, libx_end, "end", 0);
+		return 1;
+	}
+	x = new_iter(l, btre_iter, "__btre_iter__", ymd_argv(l, 0), ITER_KV,
+	             o->version);
+	if (rev) {
+		if (last) {
+			btre_step(&last, &k, 1);
+		} else {
+			last = o->last;
+			k = last->nd.n - 1;
+		}
+		btre_step(&first, &i, 1);
+		x->lf = last;
+		x->i = k;
+		x->lf_end = first;
+		x->i_end = i;
+		x->rev = 1;
+	} else {
+		x->lf = first;
+		x->i = i;
+		x->lf_end = last;
+		x->i_end = k;
+	}
+	return 1;
+}
+
 // range(begin, end, [step])
+// range(skip_list, [lo, [hi]])
+// range(btree, [lo, [hi]])
+//     Cursor of key and value pairs in [lo, hi), no copying.
 // Example:
 // range(1,100) = 1,2,3,...99
 // range(1,100,2) = 1,3,5,...99
 // range([9,8,7]) = 9,8,7
 static int libx_range(L) {
+	if (ymd_argc(l) > 0 && ymd_type(ymd_argv(l, 0)) == T_SKLS)
+		return new_skls_range(l, 0);
+	if (ymd_argc(l) > 0 && ymd_type(ymd_argv(l, 0)) == T_BTRE)
+		return new_btre_range(l, 0);
 	switch (ymd_argc(l)) {
 	case 2: {
 		ymd_int_t i = int_of(l, ymd_argv(l, 0)),
@@ -419,6 +1084,15 @@ static int libx_range(L) {
 	return 0;
 }
 
+// rrange(skip_list, [lo, [hi]])
+// rrange(btree, [lo, [hi]])
+//     Same as range(...) but from the last one to the first one.
+static int libx_rrange(L) {
+	if (ymd_type(ymd_argv(l, 0)) == T_BTRE)
+		return new_btre_range(l, 1);
+	return new_skls_range(l, 1);
+}
+
 static int libx_values(L) {
 	return new_contain_iter(l, ymd_argv(l, 0), ITER_VALUE);
 }
@@ -542,12 +1216,12 @@ static int libx_read(L) {
 	arg1 = ymd_argv(l, 1);
 	switch (ymd_type(arg1)) {
 	case T_KSTR:
-		if (strcmp(kstr_k(arg1)->land, "*all") == 0)
+		if (strcmp(kstr_of(l, arg1)->land, "*all") == 0)
 			return ansic_file_readall(l, self);
-		else if (strcmp(kstr_k(arg1)->land, "*line") == 0)
+		else if (strcmp(kstr_of(l, arg1)->land, "*line") == 0)
 			return ansic_file_readline(l, self);
 		else
-			ymd_panic(l, "Bad read() option: %s", kstr_k(arg1)->land);
+			ymd_panic(l, "Bad read() option: %s", kstr_of(l, arg1)->land);
 		break;
 	case T_INT:
 		return ansic_file_readn(l, self,
@@ -681,7 +1355,7 @@ static int libx_split(L) {
 		i   += ovec[1];
 	}
 	if (i < arg0->len) {
-		ymd_kstr(l, arg0->land + i, arg0->len - i);
+		setv_kstr(ymd_push(l), kstr_slice(l->vm, arg0, i, arg0->len - i));
 		ymd_add(l);
 	}
 	return 1;
@@ -782,11 +1456,14 @@ static int libx_atof(L) {
 }
 
 // Slice
+// String and array slices share memory with the origin, an array slice is
+// copied when it be changed.
 // slice(string, start, count)
 // slice(string, start) == slice(string, start, len(string) - start)
 // slice(array, start, count)
 // slice(array, start) == slice(array, start, len(array) - start)
 // slice(skip_list, begin, end) -> skip_list[begin, end) 
+// slice(btree, begin, end) -> btree[begin, end)
 static int libx_slice(L) {
 	struct variable *arg0 = ymd_argv(l, 0);
 	switch (ymd_type(arg0)) {
@@ -800,15 +1477,17 @@ static int libx_slice(L) {
 			start = int4of(l, ymd_argv(l, 1));
 			count = int4of(l, ymd_argv(l, 2));
 		}
+		if (start < 0)
+			ymd_panic(l, "slice() bad start: %lld", start);
 		count = YMD_MIN(count, o->len - start);
 		if (count <= 0)
 			ymd_kstr(l, "", 0);
 		else
-			ymd_kstr(l, o->land + start, count);
+			setv_kstr(ymd_push(l), kstr_slice(l->vm, o, start, count));
 		} break;
 	case T_DYAY: {
 		struct dyay *o = dyay_of(l, arg0);
-		ymd_int_t i, start, count;
+		ymd_int_t start, count;
 		if (ymd_argc(l) == 2) {
 			start = int4of(l, ymd_argv(l, 1));
 			count = o->count - start;
@@ -816,20 +1495,19 @@ static int libx_slice(L) {
 			start = int4of(l, ymd_argv(l, 1));
 			count = int4of(l, ymd_argv(l, 2));
 		}
+		if (start < 0)
+			ymd_panic(l, "slice() bad start: %lld", start);
 		count = YMD_MIN(count, o->count - start);
-		ymd_dyay(l, 0);
 		if (count <= 0)
-			break;
-		for (i = start; i < start + count; ++i) {
-			*ymd_push(l) = o->elem[i];
-			ymd_add(l);
-		}
+			ymd_dyay(l, 0);
+		else
+			setv_dyay(ymd_push(l), dyay_slice(l->vm, o, start, count));
 		} break;
 	case T_SKLS: {
 		const struct skls *o = skls_of(l, arg0);
 		const struct sknd *i, *k;
 		struct variable *arg1;
-		ymd_skls(l, o->cmp);
+		ymd_skls_key(l, o->cmp, o->key);
 		if (ymd_argc(l) == 2) {
 			arg1 = ymd_argv(l, 1);
 			k = NULL; // to end
@@ -851,6 +1529,29 @@ static int libx_slice(L) {
 			ymd_putf(l);
 		}
 		} break;
+	case T_BTRE: {
+		const struct btre *o = btre_of(l, arg0);
+		struct btlf *i, *k = NULL;
+		struct variable arg1 = *ymd_argv(l, 1);
+		int j, m = 0;
+		if (ymd_argc(l) > 2) {
+			struct variable arg2 = *ymd_argv(l, 2);
+			if (btre_key_compare(l->vm, o, &arg1, &arg2) > 0) {
+				struct variable tmp = arg1;
+				arg1 = arg2;
+				arg2 = tmp;
+			}
+			m = btre_direct(l->vm, o, &arg2, &k);
+		}
+		j = btre_direct(l->vm, o, &arg1, &i);
+		ymd_btre(l, o->cmp);
+		while (i && (i != k || j != m)) {
+			*ymd_push(l) = i->nd.k[j];
+			*ymd_push(l) = i->v[j];
+			ymd_putf(l);
+			btre_step(&i, &j, 0);
+		}
+		} break;
 	default:
 		ymd_panic(l, "slice() don't support `%s'",
 				typeof_kz(ymd_type(arg0)));
@@ -859,6 +1560,151 @@ static int libx_slice(L) {
 	return 1;
 }
 
+// Skip list by rank, ranks are zero-based and a negative rank counts
+// from the end: -1 is the last one.
+static YMD_INLINE ymd_int_t rank_of(L, const struct skls *o, int i) {
+	ymd_int_t r = int_of(l, ymd_argv(l, i));
+	return r < 0 ? r + o->count : r;
+}
+
+// rank(skip_list, key)
+//     Rank of key, or nil if key not in skip list.
+static int libx_rank(L) {
+	const struct skls *o = skls_of(l, ymd_argv(l, 0));
+	int r = skls_rank(l->vm, o, ymd_argv(l, 1));
+	if (r < 0)
+		ymd_nil(l);
+	else
+		ymd_int(l, r);
+	return 1;
+}
+
+static struct func *cmp_of(L, int i) {
+	if (ymd_argc(l) > i && !is_nil(ymd_argv(l, i)))
+		return func_of(l, ymd_argv(l, i));
+	return NULL;
+}
+
+static int nth_dyay(L) {
+	struct dyay *o = dyay_x(ymd_argv(l, 0)), *tmp;
+	ymd_int_t i = int_of(l, ymd_argv(l, 1));
+	if (i < 0)
+		i += o->count;
+	if (i < 0 || i >= o->count) {
+		ymd_nil(l);
+		return 1;
+	}
+	// Select in a copy, the array keeps its order.
+	tmp = dyay_slice(l->vm, o, 0, o->count);
+	setv_dyay(ymd_push(l), tmp);
+	*ymd_top(l, 0) = *dyay_select(l->vm, tmp, cmp_of(l, 2), (int)i);
+	return 1;
+}
+
+// nth(skip_list, i)
+//     The key at rank i, or nil if out of range; value by skip_list[key].
+// nth(array, i, [cmp])
+//     The element which would be at i if array were sorted, negative i counts
+//     from the end, nil if out of range. array is not changed.
+static int libx_nth(L) {
+	const struct skls *o;
+	const struct sknd *x;
+	ymd_int_t r;
+	if (ymd_type(ymd_argv(l, 0)) == T_DYAY)
+		return nth_dyay(l);
+	o = skls_of(l, ymd_argv(l, 0));
+	r = rank_of(l, o, 1);
+	x = (r < 0 || r >= o->count) ? NULL : skls_nth(o, (int)r);
+	if (!x)
+		ymd_nil(l);
+	else
+		*ymd_push(l) = x->k;
+	return 1;
+}
+
+// nslice(skip_list, start, count)
+// nslice(skip_list, start) == nslice(skip_list, start, len(skip_list) - start)
+//     New skip list of ranks [start, start + count).
+static int libx_nslice(L) {
+	const struct skls *o = skls_of(l, ymd_argv(l, 0));
+	ymd_int_t start = rank_of(l, o, 1), count;
+	const struct sknd *i;
+	if (start < 0)
+		ymd_panic(l, "nslice() bad start: %lld", start);
+	count = ymd_argc(l) > 2 ? int_of(l, ymd_argv(l, 2)) : o->count - start;
+	count = YMD_MIN(count, o->count - start);
+	ymd_skls_key(l, o->cmp, o->key);
+	if (count <= 0)
+		return 1;
+	for (i = skls_nth(o, (int)start); count--; i = i->fwd[0]) {
+		*ymd_push(l) = i->k;
+		*ymd_push(l) = i->v;
+		ymd_putf(l);
+	}
+	return 1;
+}
+
+// sort(array, [cmp])
+// stable_sort(array, [cmp])
+//     Sort array in place and return it, `cmp(lhs, rhs)' returns a negative
+//     number if lhs is less than rhs. Without `cmp' elements are ordered as
+//     `<' does.
+// sort_by(array, key)
+//     Same as stable_sort() but ordered by `key(elem)'.
+static int do_sort(L, int stable) {
+	struct variable *arg0 = ymd_argv(l, 0);
+	dyay_sort(l->vm, dyay_of(l, arg0), cmp_of(l, 1), stable);
+	*ymd_push(l) = *ymd_argv(l, 0);
+	return 1;
+}
+
+static int libx_sort(L) {
+	return do_sort(l, 0);
+}
+
+static int libx_stable_sort(L) {
+	return do_sort(l, 1);
+}
+
+static int libx_sort_by(L) {
+	dyay_sort_by(l->vm, dyay_of(l, ymd_argv(l, 0)),
+	             func_of(l, ymd_argv(l, 1)));
+	*ymd_push(l) = *ymd_argv(l, 0);
+	return 1;
+}
+
+// topk(array, k, [cmp])
+//     New array of the k greatest elements in descending order.
+static int libx_topk(L) {
+	struct dyay *o = dyay_of(l, ymd_argv(l, 0)), *top;
+	ymd_int_t k = int_of(l, ymd_argv(l, 1));
+	struct func *cmp = cmp_of(l, 2);
+	k = YMD_MAX(0, YMD_MIN(k, o->count));
+	ymd_dyay(l, (int)k);
+	top = dyay_x(ymd_top(l, 0));
+	top->count = (int)k; // Trace the heap
+	top->count = dyay_topk(l->vm, o, cmp, top->elem, (int)k);
+	return 1;
+}
+
+// lower_bound(array, x, [cmp])
+// upper_bound(array, x, [cmp])
+//     Binary search in sorted array: index of the first element not less
+//     than x, or greater than x for upper_bound(); len(array) if no one.
+static int do_bound(L, int upper) {
+	struct dyay *o = dyay_of(l, ymd_argv(l, 0));
+	ymd_int(l, dyay_bound(l->vm, o, cmp_of(l, 2), ymd_argv(l, 1), upper));
+	return 1;
+}
+
+static int libx_lower_bound(L) {
+	return do_bound(l, 0);
+}
+
+static int libx_upper_bound(L) {
+	return do_bound(l, 1);
+}
+
 static int libx_exit(L) {
 	(void)l;
 	longjmp(l->jpt->core, 1); // jump to top
@@ -866,45 +1712,66 @@ static int libx_exit(L) {
 }
 
 // rand()
-//     random range no limited
+//     random non-negative int
 // rand(num)
 //     random range to [0, num) num > 0 or (num, 0] num < 0
 // rand(min, max)
 //     random range [min, max)
+// If any argument is a float, the result is a uniform float in the range,
+// rand(1.0) gives [0, 1).
+// rand() with no argument: non-negative ones in all bits `int' has.
+#if defined(YMD_NANBOX)
+#define RAND_SHIFT 17
+#else
+#define RAND_SHIFT 1
+#endif
+
 static int libx_rand(L) {
-	ymd_int_t rv = 0;
 	int argc = ymd_argc(l);
-	switch (argc) {
-	case 0:
-		rv = rand();
-		break;
-	case 1: {
+	ymd_float_t fmin, fmax;
+	ymd_int_t min, max;
+	if (argc == 0) {
+		ymd_int(l, (ymd_int_t)(vm_rand(l->vm) >> RAND_SHIFT));
+		return 1;
+	}
+	if (ymd_type(ymd_argv(l, 0)) == T_FLOAT ||
+		(argc > 1 && ymd_type(ymd_argv(l, 1)) == T_FLOAT)) {
+		fmin = argc > 1 ? float4of(l, ymd_argv(l, 0)) : 0;
+		fmax = float4of(l, ymd_argv(l, argc > 1 ? 1 : 0));
+		ymd_float(l, fmin + (fmax - fmin) * vm_randf(l->vm));
+		return 1;
+	}
+	if (argc == 1) {
 		ymd_int_t limit = int_of(l, ymd_argv(l, 0));
 		if (limit > 0)
-			rv = rand() % limit;
+			min = 0, max = limit;
+		else if (limit < 0)
+			min = limit + 1, max = 1;
 		else
-			rv = -(rand() % (-limit));
-		} break;
-	case 2:
-	default: {
-		ymd_int_t arg0 = int_of(l, ymd_argv(l, 0)),
-				  arg1 = int_of(l, ymd_argv(l, 1));
-		ymd_int_t min, max;
-		if (arg0 < arg1)
-			min = arg0, max = arg1;
-		else if (arg0 > arg1)
-			min = arg1, max = arg0;
-		else
-			rv = arg0;
-		if (arg0 != arg1)
-			// FIXME: use better random system.
-			rv = min + (rand() % (max - min));
-		} break;
+			min = max = 0;
+	} else {
+		min = int_of(l, ymd_argv(l, 0));
+		max = int_of(l, ymd_argv(l, 1));
+		if (min > max) {
+			ymd_int_t t = min; min = max; max = t;
+		}
 	}
-	ymd_int(l, rv);
+	if (min == max) {
+		ymd_int(l, min);
+		return 1;
+	}
+	ymd_int(l, min + (ymd_int_t)vm_rand_below(l->vm,
+	        (ymd_uint_t)max - (ymd_uint_t)min));
 	return 1;
 }
 
+// srand(seed)
+//     Reset the random generator of this VM, same seed gives same sequence.
+static int libx_srand(L) {
+	vm_srand(l->vm, (ymd_uint_t)int_of(l, ymd_argv(l, 0)));
+	return 0;
+}
+
 static const char *gc_state_str[] = {
 	"pause",
 	"propagate",
@@ -945,7 +1812,7 @@ static int libx_setmetatable(L) {
 	if (ymd_type(ymd_argv(l, 1)) != T_HMAP &&
 		ymd_type(ymd_argv(l, 1)) != T_SKLS)
 		ymd_panic(l, "Not metatable type!");
-	mand_proto(o, ymd_argv(l, 1)->u.ref);
+	mand_proto(o, var_ref(ymd_argv(l, 1)));
 	return 0;
 }
 
@@ -1011,8 +1878,24 @@ LIBC_BEGIN(Builtin)
 	LIBC_ENTRY(insert)
 	LIBC_ENTRY(append)
 	LIBC_ENTRY(remove)
+	LIBC_ENTRY(deque)
+	LIBC_ENTRY(push_front)
+	LIBC_ENTRY(push_back)
+	LIBC_ENTRY(pop_front)
+	LIBC_ENTRY(pop_back)
+	LIBC_ENTRY(heap)
+	LIBC_ENTRY(push)
+	LIBC_ENTRY(pop)
+	LIBC_ENTRY(peek)
+	LIBC_ENTRY(set)
+	LIBC_ENTRY(union)
+	LIBC_ENTRY(intersect)
+	LIBC_ENTRY(difference)
+	LIBC_ENTRY(lru)
+	LIBC_ENTRY(stats)
 	LIBC_ENTRY(len)
 	LIBC_ENTRY(range)
+	LIBC_ENTRY(rrange)
 	LIBC_ENTRY(values)
 	LIBC_ENTRY(pairs)
 	LIBC_ENTRY(keys)
@@ -1020,6 +1903,15 @@ LIBC_BEGIN(Builtin)
 	LIBC_ENTRY(atoi)
 	LIBC_ENTRY(atof)
 	LIBC_ENTRY(slice)
+	LIBC_ENTRY(rank)
+	LIBC_ENTRY(nth)
+	LIBC_ENTRY(nslice)
+	LIBC_ENTRY(sort)
+	LIBC_ENTRY(stable_sort)
+	LIBC_ENTRY(sort_by)
+	LIBC_ENTRY(topk)
+	LIBC_ENTRY(lower_bound)
+	LIBC_ENTRY(upper_bound)
 	LIBC_ENTRY(split)
 	LIBC_ENTRY(panic)
 	LIBC_ENTRY(strbuf)
@@ -1033,6 +1925,7 @@ LIBC_BEGIN(Builtin)
 	LIBC_ENTRY(env)
 	LIBC_ENTRY(exit)
 	LIBC_ENTRY(rand)
+	LIBC_ENTRY(srand)
 	LIBC_ENTRY(gc)
 	LIBC_ENTRY(setmetatable)
 	LIBC_ENTRY(metatable)
@@ -1049,6 +1942,10 @@ int ymd_load_lib(struct ymd_mach *vm, ymd_libc_t lbx) {
 		ymd_putg(l, i->symbol.z);
 		++rv;
 	}
+	// Packed arrays are built-in values: len(), str(), pairs() and pickle
+	// know them, so their library comes with the built-ins.
+	if (lbx == lbxBuiltin)
+		rv += ymd_load_packed(vm);
 	return rv;
 }
 
@@ -42,5 +42,9 @@ int ymd_load_os(struct ymd_mach *vm);
 // Serializing and Parsing
 int ymd_load_pickle(struct ymd_mach *vm);
 
+// Load packed library:
+// Packed numeric arrays and their kernels
+int ymd_load_packed(struct ymd_mach *vm);
+
 #endif // YMD_LIBC_H
 
@@ -9,20 +9,20 @@
 static int readdir_iter(L) {
 	WIN32_FIND_DATAA ffd;
 	struct variable *ff = ymd_upval(l, 1);
-	if (ff->u.ext == INVALID_HANDLE_VALUE) {
+	if (var_ext(ff) == INVALID_HANDLE_VALUE) {
 		char name[MAX_PATH];
 		struct kstr *up0 = kstr_of(l, ymd_upval(l, 0));
 		strncpy_s(name, ARRAY_SIZEOF(name), up0->land, up0->len);
 		if (name[strlen(name) - 1] != '*')
 			strcat_s(name, sizeof(name), "\\*");
 
-		ff->u.ext = FindFirstFileA(name, &ffd);
-		if (ff->u.ext == INVALID_HANDLE_VALUE)
+		setv_ext(ff, FindFirstFileA(name, &ffd));
+		if (var_ext(ff) == INVALID_HANDLE_VALUE)
 			return 0;
 		ymd_kstr(l, ffd.cFileName, -1);
 		return 1;
 	}
-	if (!FindNextFileA(ff->u.ext, &ffd))
+	if (!FindNextFileA(var_ext(ff), &ffd))
 		return 0;
 	ymd_kstr(l, ffd.cFileName, -1);
 	return 1;
@@ -0,0 +1,226 @@
+#include "core.h"
+#include "libc.h"
+
+#define L struct ymd_context *l
+
+// packed.int64(count)
+// packed.int64(array)
+//     New packed array of `count' zeros, or elements of an array or a packed
+//     array converted to the kind. float64(), int32() and uint8() are same.
+//     Int kinds wrap around like C's unsigned, floats out of the range of
+//     int64 saturate.
+static int new_pkay(L, int kind) {
+	struct variable *arg0, x;
+	struct pkay *o;
+	int i, k;
+	if (ymd_argc(l) == 0 || ymd_type(ymd_argv(l, 0)) == T_INT) {
+		ymd_int_t n = ymd_argc(l) > 0 ? int_of(l, ymd_argv(l, 0)) : 0;
+		if (n < 0)
+			ymd_panic(l, "packed.%s() bad count: %lld",
+			          pkay_kind_name(kind), n);
+		ymd_pkay(l, kind, (int)n);
+		return 1;
+	}
+	arg0 = ymd_argv(l, 0);
+	switch (ymd_type(arg0)) {
+	case T_DYAY:
+		k = dyay_k(arg0)->count;
+		break;
+	case T_PKAY:
+		k = pkay_k(arg0)->count;
+		break;
+	default:
+		ymd_panic(l, "packed.%s() needs a count or an array",
+		          pkay_kind_name(kind));
+		return 0;
+	}
+	o = ymd_pkay(l, kind, k);
+	arg0 = ymd_argv(l, 0); // Stack may be moved
+	if (ymd_type(arg0) == T_DYAY) {
+		const struct dyay *a = dyay_k(arg0);
+		for (i = 0; i < k; ++i)
+			pkay_set(l->vm, o, i, a->elem + i);
+	} else if (pkay_kind(pkay_k(arg0)) == kind) {
+		if (k > 0)
+			memcpy(o->u.raw, pkay_k(arg0)->u.raw, k * pkay_elem_size(kind));
+	} else {
+		const struct pkay *a = pkay_k(arg0);
+		for (i = 0; i < k; ++i)
+			pkay_set(l->vm, o, i, pkay_get(a, i, &x));
+	}
+	return 1;
+}
+
+static int libx_int64(L) {
+	return new_pkay(l, PKAY_I64);
+}
+
+static int libx_float64(L) {
+	return new_pkay(l, PKAY_F64);
+}
+
+static int libx_int32(L) {
+	return new_pkay(l, PKAY_I32);
+}
+
+static int libx_uint8(L) {
+	return new_pkay(l, PKAY_U8);
+}
+
+// packed.kind(a)
+//     "int64", "float64", "int32" or "uint8"
+static int libx_kind(L) {
+	const struct pkay *o = pkay_of(l, ymd_argv(l, 0));
+	ymd_kstr(l, pkay_kind_name(pkay_kind(o)), -1);
+	return 1;
+}
+
+// packed.sum(a)
+//     int for integer kinds, float for float64.
+static int libx_sum(L) {
+	struct variable rv;
+	pkay_sum(pkay_of(l, ymd_argv(l, 0)), &rv);
+	*ymd_push(l) = rv;
+	return 1;
+}
+
+// packed.min(a)
+// packed.max(a)
+//     nil if a is empty.
+static int do_minmax(L, int max) {
+	struct variable rv;
+	if (!pkay_minmax(pkay_of(l, ymd_argv(l, 0)), max, &rv))
+		return 0;
+	*ymd_push(l) = rv;
+	return 1;
+}
+
+static int libx_min(L) {
+	return do_minmax(l, 0);
+}
+
+static int libx_max(L) {
+	return do_minmax(l, 1);
+}
+
+// packed.dot(a, b)
+//     Sum of a[i] * b[i], a and b are in the same kind and length.
+static int libx_dot(L) {
+	struct variable rv;
+	pkay_dot(l->vm, pkay_of(l, ymd_argv(l, 0)), pkay_of(l, ymd_argv(l, 1)),
+	         &rv);
+	*ymd_push(l) = rv;
+	return 1;
+}
+
+// packed.scale(a, k)
+//     a[i] = a[i] * k in place, returns a.
+static int libx_scale(L) {
+	pkay_scale(l->vm, pkay_of(l, ymd_argv(l, 0)), ymd_argv(l, 1));
+	*ymd_push(l) = *ymd_argv(l, 0);
+	return 1;
+}
+
+// packed.add(a, b)
+//     a[i] = a[i] + b[i] in place, b is a packed array in the same kind and
+//     length, or a number. Returns a.
+static int libx_add(L) {
+	pkay_addto(l->vm, pkay_of(l, ymd_argv(l, 0)), ymd_argv(l, 1));
+	*ymd_push(l) = *ymd_argv(l, 0);
+	return 1;
+}
+
+// packed.prefix_sum(a)
+//     a[i] = a[0] + ... + a[i] in place, returns a.
+static int libx_prefix_sum(L) {
+	pkay_prefix_sum(pkay_of(l, ymd_argv(l, 0)));
+	*ymd_push(l) = *ymd_argv(l, 0);
+	return 1;
+}
+
+// packed.lt(a, b), le(), gt(), ge(), eq(), ne()
+//     New uint8 mask: mask[i] = a[i] < b[i] ? 1 : 0, b is a packed array in
+//     the same kind and length, or a number.
+static int do_mask(L, int op) {
+	struct pkay *mask;
+	pkay_of(l, ymd_argv(l, 0));
+	mask = ymd_pkay(l, PKAY_U8, pkay_k(ymd_argv(l, 0))->count);
+	pkay_mask(l->vm, pkay_k(ymd_argv(l, 0)), op, ymd_argv(l, 1), mask);
+	return 1;
+}
+
+static int libx_lt(L) {
+	return do_mask(l, PKAY_LT);
+}
+
+static int libx_le(L) {
+	return do_mask(l, PKAY_LE);
+}
+
+static int libx_gt(L) {
+	return do_mask(l, PKAY_GT);
+}
+
+static int libx_ge(L) {
+	return do_mask(l, PKAY_GE);
+}
+
+static int libx_eq(L) {
+	return do_mask(l, PKAY_EQ);
+}
+
+static int libx_ne(L) {
+	return do_mask(l, PKAY_NE);
+}
+
+// packed.filter(a, mask)
+//     New packed array of a[i] which mask[i] is not 0.
+static int libx_filter(L) {
+	const struct pkay *a = pkay_of(l, ymd_argv(l, 0)),
+	                  *mask = pkay_of(l, ymd_argv(l, 1));
+	struct pkay *o;
+	int i, k = 0, size = pkay_elem_size(pkay_kind(a));
+	if (pkay_kind(mask) != PKAY_U8 || mask->count != a->count)
+		ymd_panic(l, "packed.filter() needs a uint8 mask in same length");
+	for (i = 0; i < mask->count; ++i)
+		k += (mask->u.u8[i] != 0);
+	o = ymd_pkay(l, pkay_kind(a), k);
+	// `a' and `mask' are in the heap, not moved by pushing.
+	for (i = 0, k = 0; i < mask->count; ++i) {
+		if (mask->u.u8[i])
+			memcpy((ymd_byte_t *)o->u.raw + (k++) * size,
+			       (const ymd_byte_t *)a->u.raw + i * size, size);
+	}
+	return 1;
+}
+
+LIBC_BEGIN(Packed)
+	LIBC_ENTRY(int64)
+	LIBC_ENTRY(float64)
+	LIBC_ENTRY(int32)
+	LIBC_ENTRY(uint8)
+	LIBC_ENTRY(kind)
+	LIBC_ENTRY(sum)
+	LIBC_ENTRY(min)
+	LIBC_ENTRY(max)
+	LIBC_ENTRY(dot)
+	LIBC_ENTRY(scale)
+	LIBC_ENTRY(add)
+	LIBC_ENTRY(prefix_sum)
+	LIBC_ENTRY(lt)
+	LIBC_ENTRY(le)
+	LIBC_ENTRY(gt)
+	LIBC_ENTRY(ge)
+	LIBC_ENTRY(eq)
+	LIBC_ENTRY(ne)
+	LIBC_ENTRY(filter)
+LIBC_END
+
+int ymd_load_packed(struct ymd_mach *vm) {
+	struct ymd_context *l = ioslate(vm);
+	int i;
+	ymd_hmap(l, 0);
+	i = ymd_load_mem(l, "packed", lbxPacked);
+	ymd_putg(l, "packed");
+	return i;
+}
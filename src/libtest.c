@@ -187,14 +187,14 @@ static int libx_True(L) {
 	struct variable *arg0 = ymd_argv(l, 1);
 	if (is_nil(arg0))
 		yut_fail1(l, "!nil", arg0);
-	if (ymd_type(arg0) == T_BOOL && !arg0->u.i)
+	if (ymd_type(arg0) == T_BOOL && !var_int(arg0))
 		yut_fail1(l, "true or !nil", arg0);
 	return 0;
 }
 
 static int libx_False(L) {
 	struct variable *arg0 = ymd_argv(l, 1);
-	if (!is_nil(arg0) && (ymd_type(arg0) == T_BOOL && arg0->u.i))
+	if (!is_nil(arg0) && (ymd_type(arg0) == T_BOOL && var_int(arg0)))
 		yut_fail1(l, "false or nil", arg0);
 	return 0;
 }
@@ -346,10 +346,10 @@ static int yut_test(struct ymd_mach *vm, const struct filter *filter,
 	if (ymd_type(test) != T_SKLS || !ftest(filter, clazz))
 		return 0;
 	// Get all of environmord functions.
-	setup    = yut_method(vm, test->u.ref, "setup");
-	teardown = yut_method(vm, test->u.ref, "teardown");
-	init     = yut_method(vm, test->u.ref, "init");
-	final    = yut_method(vm, test->u.ref, "final");
+	setup    = yut_method(vm, var_ref(test), "setup");
+	teardown = yut_method(vm, var_ref(test), "teardown");
+	init     = yut_method(vm, var_ref(test), "init");
+	final    = yut_method(vm, var_ref(test), "final");
 	if (setjmp(yut_jpt(l, vm_getg(vm, "Assert")))) {
 		l->info = curr;
 		yut_fault(); // Print failed message
@@ -420,24 +420,31 @@ int ymd_test(struct ymd_context *l, const char *pattern, int repeated,
 	if (pattern && pattern[0])
 		ymd_printf("${[!yellow]Use filter: %s}$\n", pattern);
 	for (t = 0; t < repeated; ++t) {
-		struct kvi *k = l->vm->global->item + 
-			(size_t)(1 << l->vm->global->shift);
-		struct kvi *i;
+		const struct hmap *g = l->vm->global;
+		struct dyay *tests;
+		int i, j;
 		if (repeated > 1)
 			ymd_printf("${[!yellow]Repeated test %d of %d ...}$\n",
 					t + 1, repeated);
-		for (i = l->vm->global->item; i != k; ++i) {
-			const char *clazz;
-			if (!i->flag)
-				continue;
-			clazz = kstr_of(l, &i->k)->land;
-			if (strstr(clazz, "Test")) { // Check "Test" prefix
-				if (yut_test(l->vm, &filter, clazz, &i->v) < 0) {
-					rv = 1;
-					goto final;
-				}
+		// Test cases can change the global map, so don't hold pointers
+		// into it: collect all of test classes first.
+		ymd_dyay(l, 0);
+		tests = dyay_x(ymd_top(l, 0));
+		for (i = hmap_next(g, 0); i < hmap_end(g); i = hmap_next(g, i + 1)) {
+			struct variable buf, k = *hmap_key(g, i, &buf);
+			if (strstr(kstr_of(l, &k)->land, "Test")) { // Check "Test" prefix
+				*dyay_add(l->vm, tests) = k;
+				*dyay_add(l->vm, tests) = *hmap_val(g, i);
 			}
 		}
+		for (j = 0; j < tests->count; j += 2) {
+			const char *clazz = kstr_k(tests->elem + j)->land;
+			if (yut_test(l->vm, &filter, clazz, tests->elem + j + 1) < 0) {
+				rv = 1;
+				goto final;
+			}
+		}
+		ymd_pop(l, 1);
 	}
 final:
 	free((void*)filter.test_pattern);
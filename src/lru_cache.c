@@ -0,0 +1,191 @@
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define MIN_MAX 16
+
+//------------------------------------------------------------------
+// LRU cache:
+// -----------------------------------------------------------------
+struct lruc *lruc_new(struct ymd_mach *vm, ymd_int_t limit, int inbytes,
+                      struct func *evict) {
+	struct lruc *x = gc_new(vm, sizeof(*x), T_LRUC);
+	assert (limit > 0);
+	if (inbytes)
+		x->reserved |= LRUC_BYTES;
+	x->limit = limit;
+	x->evict = evict;
+	x->head  = -1;
+	x->tail  = -1;
+	x->free  = -1;
+	hmap_init(vm, &x->index, 0);
+	return x;
+}
+
+void lruc_final(struct ymd_mach *vm, struct lruc *o) {
+	hmap_final(vm, &o->index);
+	if (o->node) {
+		assert (o->max > 0);
+		mm_free(vm, o->node, o->max, sizeof(*o->node));
+		o->node  = NULL;
+		o->count = 0;
+		o->max   = 0;
+	}
+}
+
+static YMD_INLINE ymd_int_t kstr_bytes(const struct variable *v) {
+	return ymd_type(v) == T_KSTR ? kstr_k(v)->len : 0;
+}
+
+ymd_int_t lruc_bytes(const struct variable *k, const struct variable *v) {
+	return (ymd_int_t)sizeof(struct lrnd) + kstr_bytes(k) + kstr_bytes(v);
+}
+
+static void unlink_node(struct lruc *o, int i) {
+	struct lrnd *x = o->node + i;
+	if (x->prev >= 0)
+		o->node[x->prev].next = x->next;
+	else
+		o->head = x->next;
+	if (x->next >= 0)
+		o->node[x->next].prev = x->prev;
+	else
+		o->tail = x->prev;
+}
+
+static void link_front(struct lruc *o, int i) {
+	struct lrnd *x = o->node + i;
+	x->prev = -1;
+	x->next = o->head;
+	if (o->head >= 0)
+		o->node[o->head].prev = i;
+	else
+		o->tail = i;
+	o->head = i;
+}
+
+static YMD_INLINE void touch(struct lruc *o, int i) {
+	if (o->head == i)
+		return;
+	unlink_node(o, i);
+	link_front(o, i);
+}
+
+// New nodes are linked as free ones, positions of nodes are not changed.
+static void resize(struct ymd_mach *vm, struct lruc *o) {
+	int i, old = o->max;
+	o->max = old ? old << 1 : MIN_MAX;
+	if (!lruc_inbytes(o) && o->max > o->limit + 1)
+		o->max = (int)o->limit + 1; // Evicting is after putting.
+	assert (o->max > old);
+	o->node = mm_realloc(vm, o->node, old, o->max, sizeof(*o->node));
+	for (i = o->max - 1; i >= old; --i) {
+		setv_nil(&o->node[i].k);
+		setv_nil(&o->node[i].v);
+		o->node[i].prev = -1;
+		o->node[i].next = o->free;
+		o->free = i;
+	}
+}
+
+static YMD_INLINE int position(const struct lruc *o,
+                               const struct variable *k) {
+	const struct variable *i = hmap_get((struct hmap *)&o->index, k);
+	return is_nil(i) ? -1 : (int)var_int(i);
+}
+
+struct variable *lruc_get(struct lruc *o, const struct variable *k) {
+	int i = position(o, k);
+	if (i < 0) {
+		++o->miss;
+		return knil;
+	}
+	++o->hit;
+	if (o->head != i) {
+		touch(o, i);
+		++o->version;
+	}
+	return &o->node[i].v;
+}
+
+struct variable *lruc_peek(const struct lruc *o, const struct variable *k) {
+	int i = position(o, k);
+	return i < 0 ? knil : &o->node[i].v;
+}
+
+// Unlink node `i' and give it back to free list, the pair is kept in
+// `k' and `v'.
+static void drop(struct ymd_mach *vm, struct lruc *o, int i,
+                 struct variable *k, struct variable *v) {
+	struct lrnd *x = o->node + i;
+	*k = x->k;
+	*v = x->v;
+	hmap_remove(vm, &o->index, k);
+	unlink_node(o, i);
+	// Nothing refers the pair now, it can be collected if no one else
+	// holds it.
+	setv_nil(&x->k);
+	setv_nil(&x->v);
+	x->prev = -1;
+	x->next = o->free;
+	o->free = i;
+	--o->count;
+	o->bytes -= lruc_bytes(k, v);
+	++o->version;
+}
+
+static YMD_INLINE int overflow(const struct lruc *o) {
+	if (lruc_inbytes(o))
+		return o->bytes > o->limit;
+	return o->count > o->limit;
+}
+
+static void evict(struct ymd_mach *vm, struct lruc *o) {
+	struct ymd_context *l = ioslate(vm);
+	struct variable k, v;
+	drop(vm, o, o->tail, &k, &v);
+	++o->evicted;
+	if (!o->evict)
+		return;
+	setv_func(ymd_push(l), o->evict);
+	*ymd_push(l) = k;
+	*ymd_push(l) = v;
+	ymd_pop(l, ymd_call(l, o->evict, 2, 0)); // Drop what it returns.
+}
+
+void lruc_put(struct ymd_mach *vm, struct lruc *o, const struct variable *k,
+              const struct variable *v) {
+	int i = position(o, k);
+	if (i >= 0) {
+		struct lrnd *x = o->node + i;
+		o->bytes += lruc_bytes(k, v) - lruc_bytes(&x->k, &x->v);
+		x->v = *v;
+		touch(o, i);
+	} else {
+		if (o->free < 0)
+			resize(vm, o);
+		i = o->free;
+		o->free = o->node[i].next;
+		o->node[i].k = *k;
+		o->node[i].v = *v;
+		setv_int(hmap_put(vm, &o->index, k), i);
+		link_front(o, i);
+		++o->count;
+		o->bytes += lruc_bytes(k, v);
+	}
+	++o->version;
+	// Eviction function may put or remove, check it again after each one.
+	while (o->count > 0 && overflow(o))
+		evict(vm, o);
+}
+
+int lruc_remove(struct ymd_mach *vm, struct lruc *o,
+                const struct variable *k) {
+	struct variable x, y;
+	int i = position(o, k);
+	if (i < 0)
+		return 0;
+	drop(vm, o, i, &x, &y);
+	return 1;
+}
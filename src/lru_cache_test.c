@@ -0,0 +1,123 @@
+#include "core.h"
+#include "lru_cache_test.def"
+
+static struct ymd_mach *setup() {
+	struct ymd_mach *vm = ymd_init();
+	gc_active(vm, +1);
+	return vm;
+}
+
+static void teardown(struct ymd_mach *vm) {
+	gc_active(vm, -1);
+	ymd_final(vm);
+}
+
+static void put_int(struct ymd_mach *vm, struct lruc *o, int k, int v) {
+	struct variable x, y;
+	setv_int(&x, k);
+	setv_int(&y, v);
+	lruc_put(vm, o, &x, &y);
+}
+
+static struct variable *get_int(struct lruc *o, int k) {
+	struct variable x;
+	setv_int(&x, k);
+	return lruc_get(o, &x);
+}
+
+static int test_lruc_recency(struct ymd_mach *vm) {
+	struct lruc *o = lruc_new(vm, 3, 0, NULL);
+	struct variable k;
+	int i;
+	for (i = 1; i <= 3; ++i)
+		put_int(vm, o, i, i * 100);
+	ASSERT_EQ(int, var_int(get_int(o, 1)), 100);
+	put_int(vm, o, 4, 400); // 2 is the least recently used one.
+	ASSERT_EQ(int, o->count, 3);
+	ASSERT_TRUE(is_nil(get_int(o, 2)));
+	ASSERT_EQ(large, o->hit, 1);
+	ASSERT_EQ(large, o->miss, 1);
+	ASSERT_EQ(large, o->evicted, 1);
+	// Order: 4, 1, 3
+	ASSERT_EQ(int, var_int(&o->node[o->head].k), 4);
+	ASSERT_EQ(int, var_int(&o->node[o->node[o->head].next].k), 1);
+	ASSERT_EQ(int, var_int(&o->node[o->tail].k), 3);
+	// Putting an old key refreshes it, nothing is evicted.
+	put_int(vm, o, 3, 300);
+	ASSERT_EQ(int, var_int(&o->node[o->head].v), 300);
+	ASSERT_EQ(int, var_int(&o->node[o->tail].k), 1);
+	ASSERT_EQ(large, o->evicted, 1);
+	// Peeking changes nothing.
+	setv_int(&k, 1);
+	ASSERT_EQ(int, var_int(lruc_peek(o, &k)), 100);
+	ASSERT_EQ(int, var_int(&o->node[o->tail].k), 1);
+	ASSERT_EQ(large, o->hit, 1);
+	ASSERT_TRUE(lruc_remove(vm, o, &k));
+	ASSERT_FALSE(lruc_remove(vm, o, &k));
+	ASSERT_EQ(int, o->count, 2);
+	ASSERT_EQ(int, var_int(&o->node[o->tail].k), 4);
+	return 0;
+}
+
+static int test_lruc_bytes(struct ymd_mach *vm) {
+	ymd_int_t node = lruc_bytes(knil, knil);
+	struct lruc *o = lruc_new(vm, node * 2 + 10, 1, NULL);
+	struct variable k, v;
+	ASSERT_EQ(large, node, (ymd_int_t)sizeof(struct lrnd));
+	setv_kstr(&k, kstr_fetch(vm, "a", -1));
+	setv_kstr(&v, kstr_fetch(vm, "1234", -1));
+	lruc_put(vm, o, &k, &v);
+	setv_kstr(&k, kstr_fetch(vm, "b", -1));
+	lruc_put(vm, o, &k, &v);
+	ASSERT_EQ(int, o->count, 2);
+	ASSERT_EQ(large, o->bytes, node * 2 + 10);
+	// Replacing value changes bytes, `a' is evicted.
+	setv_kstr(&v, kstr_fetch(vm, "12345", -1));
+	lruc_put(vm, o, &k, &v);
+	ASSERT_EQ(int, o->count, 1);
+	ASSERT_EQ(large, o->evicted, 1);
+	ASSERT_EQ(large, o->bytes, node + 6);
+	// A pair bigger than capacity can not be kept.
+	setv_kstr(&v, kstr_fetch(vm, "0123456789012345678901234567890123456789"
+	                         "0123456789012345678901234567890123456789", -1));
+	lruc_put(vm, o, &k, &v);
+	ASSERT_EQ(int, o->count, 0);
+	ASSERT_EQ(large, o->bytes, 0);
+	ASSERT_EQ(int, o->head, -1);
+	ASSERT_EQ(int, o->tail, -1);
+	return 0;
+}
+
+// Nodes out of the list are nil, evicted pairs are referenced by nothing.
+static int test_lruc_churn(struct ymd_mach *vm) {
+	struct lruc *o = lruc_new(vm, 100, 0, NULL);
+	int i, n;
+	for (i = 0; i < 10000; ++i) {
+		int k = (i * 7919) % 1009;
+		if (i % 7 == 0) {
+			struct variable x;
+			setv_int(&x, k);
+			lruc_remove(vm, o, &x);
+		} else if (i % 3 == 0) {
+			get_int(o, k);
+		} else {
+			put_int(vm, o, k, i);
+		}
+		ASSERT_LE(int, o->count, 100);
+	}
+	ASSERT_LE(int, o->max, 101);
+	ASSERT_EQ(int, hmap_count(&o->index), o->count);
+	for (n = 0, i = o->head; i >= 0; i = o->node[i].next) {
+		ASSERT_EQ(int, var_int(hmap_get(&o->index, &o->node[i].k)), i);
+		++n;
+	}
+	ASSERT_EQ(int, n, o->count);
+	for (i = o->free; i >= 0; i = o->node[i].next) {
+		ASSERT_TRUE(is_nil(&o->node[i].k));
+		ASSERT_TRUE(is_nil(&o->node[i].v));
+		++n;
+	}
+	ASSERT_EQ(int, n, o->max);
+	ASSERT_EQ(large, o->hit + o->miss, 10000 / 3 - 10000 / 21);
+	return 0;
+}
@@ -21,7 +21,7 @@ static int test_dynamic_stack (struct ymd_mach *vm) {
 
 	while (i--) {
 		struct variable *top = ymd_push(l);
-		ASSERT_EQ(int, T_NIL, top->tt);
+		ASSERT_EQ(int, T_NIL, var_tt(top));
 	}
 	ymd_push(l);
 
@@ -41,10 +41,10 @@ static int test_stack_incrment (struct ymd_mach *vm) {
 	ymd_int(l, k);
 
 	ASSERT_EQ(ulong, YMD_INIT_STACK * 2, l->kstk);
-	ASSERT_EQ(large, k, ymd_top(l, 0)->u.i);
+	ASSERT_EQ(large, k, var_int(ymd_top(l, 0)));
 
 	ymd_pop(l, 1);
-	ASSERT_EQ(large, pi, ymd_top(l, 0)->u.i);
+	ASSERT_EQ(large, pi, var_int(ymd_top(l, 0)));
 
 	ymd_pop(l, 1);
 	ASSERT_EQ(ulong, YMD_INIT_STACK * 2, l->kstk);
@@ -14,18 +14,18 @@
 		gc_white2gray(gcx(o))
 
 #define gc_markv(v) \
-	if ((v)->tt == T_REF && \
-			gc_whiteo((v)->u.ref)) \
-		gc_mark_obj((v)->u.ref)
+	if (is_ref(v) && \
+			gc_whiteo(var_ref(v))) \
+		gc_mark_obj(var_ref(v))
 
 #define gc_travelo(o) \
 	if (!mm_busy(o)) \
 		gc_travel_obj(gcx(o))
 
 #define gc_travelv(v) \
-	if ((v)->tt == T_REF && \
-			!mm_busy((v)->u.ref)) \
-		gc_travel_obj((v)->u.ref)
+	if (is_ref(v) && \
+			!mm_busy(var_ref(v))) \
+		gc_travel_obj(var_ref(v))
 
 
 static void gc_adjust(struct ymd_mach *vm, size_t prev);
@@ -42,6 +42,7 @@ static void gc_move2gray(struct ymd_mach *vm);
 static void gc_mark_obj(struct gc_node *o);
 static void  gc_travel_obj(struct gc_node *o);
 static int gc_travel_func(struct func *o);
+static void gc_travel_btnd(struct btnd *o);
 
 static YMD_INLINE void gc_white2gray(struct gc_node *o) {
 	assert (gc_whiteo(o) && "Only white object can become gray.");
@@ -98,7 +99,7 @@ static size_t gc_record(struct ymd_mach *vm, size_t inc, int neg) {
 void *gc_new(struct ymd_mach *vm, size_t size, unsigned char type) {
 	struct gc_struct *gc = &vm->gc;
 	struct gc_node *x = vm_zalloc(vm, size);
-	assert(type < (1 << 4));
+	assert(type < T_MAX);
 	x->type = type;
 	x->marked = gc->white; // Initial mark is current white.
 	gc_record(vm, size, 0);
@@ -143,7 +144,7 @@ int gc_step(struct ymd_mach *vm) { // Run gc in one step.
 			gc_atomic(vm);
 		break;
 	case GC_SWEEPSTRING:
-		if (gc->sweep_kpool < (1 << vm->kpool.shift))
+		if (gc->sweep_kpool < kpool_nslot(&vm->kpool))
 			gc_sweep_kpool(vm);
 		else
 			gc_final_kpool(vm);
@@ -172,7 +173,10 @@ void gc_del(struct ymd_mach *vm, void *p) {
 	switch (o->type) {
 	case T_KSTR:
 		chunk = sizeof(struct kstr);
-		chunk += kstr_f(o)->len;
+		if (kstr_f(o)->reserved & KSTR_BUF)
+			chunk += kstr_f(o)->hash; // Capacity of buffer
+		else if (!(kstr_f(o)->reserved & KSTR_VIEW))
+			chunk += kstr_f(o)->len;
 		break;
 	case T_FUNC:
 		func_final(vm, func_f(o));
@@ -190,6 +194,30 @@ void gc_del(struct ymd_mach *vm, void *p) {
 		skls_final(vm, skls_f(o));
 		chunk = sizeof(struct skls);
 		break;
+	case T_BTRE:
+		btre_final(vm, btre_f(o));
+		chunk = sizeof(struct btre);
+		break;
+	case T_PKAY:
+		pkay_final(vm, pkay_f(o));
+		chunk = sizeof(struct pkay);
+		break;
+	case T_DEQU:
+		dequ_final(vm, dequ_f(o));
+		chunk = sizeof(struct dequ);
+		break;
+	case T_HEAP:
+		heap_final(vm, heap_f(o));
+		chunk = sizeof(struct heap);
+		break;
+	case T_HSET:
+		hset_final(vm, hset_f(o));
+		chunk = sizeof(struct hset);
+		break;
+	case T_LRUC:
+		lruc_final(vm, lruc_f(o));
+		chunk = sizeof(struct lruc);
+		break;
 	case T_MAND:
 		mand_final(vm, mand_f(o));
 		chunk = sizeof(struct mand);
@@ -335,9 +363,10 @@ static void gc_sweep_kpool(struct ymd_mach *vm) {
 	struct gc_struct *gc = &vm->gc;
 	struct kpool *kt = &vm->kpool;
 	int step = gc->sweep_step;
-	struct gc_node **i = kt->slot + gc->sweep_kpool,
-				   **k = kt->slot + (1 << kt->shift);
-	for (; i != k; ++i) {
+	// Pool can not be resized in sweeping, the bucket index is stable.
+	int n = gc->sweep_kpool, k = kpool_nslot(kt);
+	for (; n < k; ++n) {
+		struct gc_node **i = kpool_bucket(kt, n);
 		struct gc_node dummy = {*i, 0, 0, 0}, *p = &dummy, *x = *i;
 		// Find fisrt valid slot
 		if (!x)
@@ -365,7 +394,7 @@ static void gc_sweep_kpool(struct ymd_mach *vm) {
 		if (!step--) break;
 	}
 	// Save current slot's index.
-	gc->sweep_kpool = (int)(++i - kt->slot);
+	gc->sweep_kpool = n + 1;
 }
 
 static void gc_final_kpool(struct ymd_mach *vm) {
@@ -380,6 +409,8 @@ static void gc_final_kpool(struct ymd_mach *vm) {
 	gc->alloced = NULL;
 	// -> sweep objects
 	gc->state = GC_SWEEP;
+	// Strings swept, maybe pool is too large now.
+	kpool_shrink(vm);
 }
 
 // Incrmential sweep non-string objects
@@ -422,15 +453,13 @@ static void gc_final_sweep(struct ymd_mach *vm) {
 }
 
 static int gc_mark_global(struct ymd_mach *vm) {
-	struct kvi *initial = vm->global->item,
-			   *i = NULL,
-			   *k = initial + (1 << vm->global->shift);
-	int count = 0;
+	const struct hmap *o = vm->global;
+	int i, count = 0;
 	assert(gc_fixedo(vm->global) && "Global must be fixed.");
-	for (i = initial; i != k; ++i) {
-		if (!i->flag) continue;
-		gc_markv(&i->k);
-		gc_markv(&i->v);
+	for (i = hmap_next(o, 0); i < hmap_end(o); i = hmap_next(o, i + 1)) {
+		if (i >= o->asize)
+			gc_markv(&o->item[i - o->asize].k);
+		gc_markv(hmap_val(o, i));
 		++count;
 	}
 	return count;
@@ -499,11 +528,19 @@ static void gc_mark_obj(struct gc_node *o) {
 		else
 			gc_white2gray(o);
 		break;
+	case T_PKAY: // No reference in it
+		gc_white2black(o);
+		break;
 	case T_MAND:
 	case T_FUNC:
 	case T_DYAY:
 	case T_HMAP:
 	case T_SKLS:
+	case T_BTRE:
+	case T_DEQU:
+	case T_HEAP:
+	case T_HSET:
+	case T_LRUC:
 		gc_white2gray(o);
 		break;
 	default:
@@ -517,29 +554,37 @@ static void gc_travel_obj(struct gc_node *o) {
 	gc_gray2black(o);
 	switch (o->type) {
 	case T_KSTR:
+		if (kstr_f(o)->reserved & KSTR_VIEW) {
+			gc_travelo(kstr_f(o)->u.parent);
+		}
 		break;
 	case T_MAND:
 		if (mand_f(o)->proto) {
 			gc_travelo(mand_f(o)->proto);
 		}
 		break;
+	case T_PKAY: // No reference in it
+		break;
 	case T_FUNC:
 		gc_travel_func(func_f(o));
 		break;
 	case T_DYAY: {
 		int i;
+		if (dyay_f(o)->parent) { // All elements are in parent.
+			gc_travelo(dyay_f(o)->parent);
+			break;
+		}
 		for (i = 0; i < dyay_f(o)->count; ++i) {
 			gc_travelv(dyay_f(o)->elem + i);
 		}
 		} break;
 	case T_HMAP: {
-		struct kvi *initial = hmap_f(o)->item,
-				   *i = NULL,
-				   *k = initial + (1 << hmap_f(o)->shift);
-		for (i = initial; i != k; ++i) {
-			if (!i->flag) continue;
-			gc_travelv(&i->k);
-			gc_travelv(&i->v);
+		struct hmap *x = hmap_f(o);
+		int i;
+		for (i = hmap_next(x, 0); i < hmap_end(x); i = hmap_next(x, i + 1)) {
+			if (i >= x->asize)
+				gc_travelv(&x->item[i - x->asize].k);
+			gc_travelv(hmap_val(x, i));
 		}
 		} break;
 	case T_SKLS: {
@@ -548,9 +593,61 @@ static void gc_travel_obj(struct gc_node *o) {
 		if (x->cmp != SKLS_ASC && x->cmp != SKLS_DASC) {
 			gc_travelo(x->cmp);
 		}
+		if (x->key)
+			gc_travelo(x->key);
 		for (i = x->head->fwd[0]; i != NULL; i = i->fwd[0]) {
 			gc_travelv(&i->k);
 			gc_travelv(&i->v);
+			if (x->key)
+				gc_travelv(sknd_okey(i));
+		}
+		} break;
+	case T_BTRE: {
+		struct btre *x = btre_f(o);
+		if (x->cmp != SKLS_ASC && x->cmp != SKLS_DASC) {
+			gc_travelo(x->cmp);
+		}
+		if (x->root)
+			gc_travel_btnd(x->root);
+		} break;
+	case T_DEQU: {
+		int i;
+		for (i = 0; i < dequ_f(o)->count; ++i) {
+			gc_travelv(dequ_get(dequ_f(o), i));
+		}
+		} break;
+	case T_HEAP: {
+		struct heap *x = heap_f(o);
+		int i;
+		if (x->cmp != SKLS_ASC && x->cmp != SKLS_DASC) {
+			gc_travelo(x->cmp);
+		}
+		if (x->key)
+			gc_travelo(x->key);
+		for (i = 0; i < x->count; ++i) {
+			gc_travelv(x->elem + i);
+			if (x->key)
+				gc_travelv(x->okey + i);
+		}
+		} break;
+	case T_HSET: {
+		struct hset *x = hset_f(o);
+		int i;
+		for (i = 0; i < hset_nslot(x); ++i) {
+			if (hset_full(x, i))
+				gc_travelv(x->key + i);
+		}
+		} break;
+	case T_LRUC: {
+		// Only the linked nodes, keys in index are same as theirs. Evicted
+		// pairs are not reached from here any more.
+		struct lruc *x = lruc_f(o);
+		int i;
+		if (x->evict)
+			gc_travelo(x->evict);
+		for (i = x->head; i >= 0; i = x->node[i].next) {
+			gc_travelv(&x->node[i].k);
+			gc_travelv(&x->node[i].v);
 		}
 		} break;
 	default:
@@ -560,6 +657,24 @@ static void gc_travel_obj(struct gc_node *o) {
 	mm_idle(o);
 }
 
+// Separators in internal nodes may be keys already removed from leaves,
+// so every node's keys must be marked.
+static void gc_travel_btnd(struct btnd *o) {
+	int i;
+	for (i = 0; i < o->n; ++i) {
+		gc_travelv(o->k + i);
+	}
+	if (o->leaf) {
+		for (i = 0; i < o->n; ++i) {
+			gc_travelv(((struct btlf *)o)->v + i);
+		}
+		return;
+	}
+	for (i = 0; i <= o->n; ++i) {
+		gc_travel_btnd(((struct btin *)o)->child[i]);
+	}
+}
+
 static int gc_travel_func(struct func *o) {
 	int i;
 	struct chunk *core;
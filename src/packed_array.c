@@ -0,0 +1,423 @@
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#define MAX_ADD 16
+
+//------------------------------------------------------------------
+// Packed array:
+// -----------------------------------------------------------------
+static const struct {
+	int size;
+	const char *name;
+} kinds[PKAY_MAX] = {
+	{ sizeof(ymd_int_t),   "int64", },
+	{ sizeof(ymd_float_t), "float64", },
+	{ sizeof(ymd_i32_t),   "int32", },
+	{ sizeof(ymd_byte_t),  "uint8", },
+};
+
+int pkay_elem_size(int kind) {
+	assert (kind >= 0 && kind < PKAY_MAX);
+	return kinds[kind].size;
+}
+
+const char *pkay_kind_name(int kind) {
+	assert (kind >= 0 && kind < PKAY_MAX);
+	return kinds[kind].name;
+}
+
+int pkay_kind_of(const char *z) {
+	int i;
+	for (i = 0; i < PKAY_MAX; ++i) {
+		if (strcmp(kinds[i].name, z) == 0)
+			return i;
+	}
+	return -1;
+}
+
+struct pkay *pkay_new(struct ymd_mach *vm, int kind, int count) {
+	struct pkay *x = gc_new(vm, sizeof(*x), T_PKAY);
+	assert (kind >= 0 && kind < PKAY_MAX);
+	pkay_kind(x) = (unsigned char)kind;
+	x->count = count > 0 ? count : 0;
+	x->max = x->count;
+	if (x->max > 0)
+		x->u.raw = mm_zalloc(vm, x->max, kinds[kind].size);
+	return x;
+}
+
+void pkay_final(struct ymd_mach *vm, struct pkay *o) {
+	if (o->u.raw) {
+		assert (o->max > 0);
+		mm_free(vm, o->u.raw, o->max, kinds[pkay_kind(o)].size);
+		o->u.raw = NULL;
+		o->count = 0;
+		o->max   = 0;
+	}
+}
+
+int pkay_equals(const struct pkay *o, const struct pkay *rhs) {
+	int i;
+	if (o == rhs)
+		return 1;
+	if (pkay_kind(o) != pkay_kind(rhs) || o->count != rhs->count)
+		return 0;
+	if (o->count == 0) // No buffer
+		return 1;
+	if (pkay_kind(o) != PKAY_F64)
+		return memcmp(o->u.raw, rhs->u.raw,
+		              o->count * kinds[pkay_kind(o)].size) == 0;
+	for (i = 0; i < o->count; ++i) {
+		if (o->u.f64[i] != rhs->u.f64[i])
+			return 0;
+	}
+	return 1;
+}
+
+int pkay_compare(const struct pkay *o, const struct pkay *rhs) {
+	struct variable x, y;
+	int i, k;
+	if (o == rhs)
+		return 0;
+	if (pkay_kind(o) != pkay_kind(rhs))
+		return pkay_kind(o) < pkay_kind(rhs) ? -1 : 1;
+	k = YMD_MIN(o->count, rhs->count);
+	for (i = 0; i < k; ++i) {
+		int rv = num_compare(pkay_get(o, i, &x), pkay_get(rhs, i, &y));
+		if (rv != 0)
+			return rv < 0 ? -1 : 1;
+	}
+	if (o->count < rhs->count)
+		return -1;
+	else if (o->count > rhs->count)
+		return 1;
+	return 0;
+}
+
+struct variable *pkay_get(const struct pkay *o, int i, struct variable *v) {
+	assert (i >= 0 && i < o->count);
+	switch (pkay_kind(o)) {
+	case PKAY_I64:
+		setv_int(v, o->u.i64[i]);
+		break;
+	case PKAY_F64:
+		setv_float(v, o->u.f64[i]);
+		break;
+	case PKAY_I32:
+		setv_int(v, o->u.i32[i]);
+		break;
+	case PKAY_U8:
+		setv_int(v, o->u.u8[i]);
+		break;
+	default:
+		assert (!"No reached.");
+		break;
+	}
+	return v;
+}
+
+// Casting a float out of range to int is undefined, so it saturates and
+// NaN is 0. Then it is narrowed as an int.
+static YMD_INLINE ymd_int_t int_of_float(ymd_float_t f) {
+	if (f != f)
+		return 0;
+	if (f >= (ymd_float_t)LLONG_MAX) // 2^63
+		return LLONG_MAX;
+	if (f <= (ymd_float_t)LLONG_MIN)
+		return LLONG_MIN;
+	return (ymd_int_t)f;
+}
+
+// Returns 1 if `v' is a float in `*f', or 0 if it is an int in `*n'.
+static int num_of(struct ymd_mach *vm, const struct variable *v,
+                  ymd_int_t *n, ymd_float_t *f) {
+	switch (ymd_type(v)) {
+	case T_INT:
+		*n = var_int(v);
+		return 0;
+	case T_FLOAT:
+		*f = var_float(v);
+		return 1;
+	default:
+		ymd_panic(ioslate(vm), "Packed array needs a number, not `%s'",
+		          typeof_kz(ymd_type(v)));
+		break;
+	}
+	return 0;
+}
+
+void pkay_set(struct ymd_mach *vm, struct pkay *o, int i,
+		const struct variable *v) {
+	ymd_int_t n = 0;
+	ymd_float_t f = 0;
+	int isf = num_of(vm, v, &n, &f);
+	assert (i >= 0 && i < o->count);
+	if (pkay_kind(o) == PKAY_F64) {
+		o->u.f64[i] = isf ? f : (ymd_float_t)n;
+		return;
+	}
+	if (isf)
+		n = int_of_float(f);
+	switch (pkay_kind(o)) {
+	case PKAY_I64:
+		o->u.i64[i] = n;
+		break;
+	case PKAY_I32:
+		o->u.i32[i] = (ymd_i32_t)n;
+		break;
+	case PKAY_U8:
+		o->u.u8[i] = (ymd_byte_t)n;
+		break;
+	default:
+		assert (!"No reached.");
+		break;
+	}
+}
+
+void pkay_add(struct ymd_mach *vm, struct pkay *o, const struct variable *v) {
+	if (o->count >= o->max) { // Resize
+		int old = o->max, size = kinds[pkay_kind(o)].size;
+		o->max = o->count * 3 / 2 + MAX_ADD;
+		o->u.raw = mm_realloc(vm, o->u.raw, old, o->max, size);
+	}
+	++o->count;
+	++o->version;
+	pkay_set(vm, o, o->count - 1, v);
+}
+
+//------------------------------------------------------------------
+// Kernels:
+// -----------------------------------------------------------------
+// Reductions keep 4 partial results, so no one waits for the previous
+// element: compilers vectorize these loops without -ffast-math.
+#define MASK_LOOP(m, n, expr) do { \
+	int i; \
+	for (i = 0; i < (n); ++i) \
+		(m)[i] = (ymd_byte_t)(expr); \
+} while (0)
+
+#define MASK_LOOPS(m, n, op, lhs, rhs) \
+	switch (op) { \
+	case PKAY_LT: MASK_LOOP(m, n, lhs <  rhs); break; \
+	case PKAY_LE: MASK_LOOP(m, n, lhs <= rhs); break; \
+	case PKAY_GT: MASK_LOOP(m, n, lhs >  rhs); break; \
+	case PKAY_GE: MASK_LOOP(m, n, lhs >= rhs); break; \
+	case PKAY_EQ: MASK_LOOP(m, n, lhs == rhs); break; \
+	case PKAY_NE: MASK_LOOP(m, n, lhs != rhs); break; \
+	default: assert (!"No reached."); break; \
+	}
+
+// Int kinds compute in unsigned, so they wrap around as narrowing does
+// instead of overflowing.
+#define SETV_UINT(v, n)  setv_int(v, (ymd_int_t)(n))
+#define CAST_INT(T, f)   ((T)int_of_float(f))
+#define CAST_FLOAT(T, f) ((T)(f))
+
+// x: union member and name prefix, T: element type, A: arithmetic type,
+// CAST: float to T
+#define DEFINE_KERNELS(x, T, A, SETV, CAST) \
+static void x##_sum(const struct pkay *o, struct variable *rv) { \
+	const T *a = o->u.x; \
+	A s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+	int i, n = o->count; \
+	for (i = 0; i + 4 <= n; i += 4) { \
+		s0 += (A)a[i]; \
+		s1 += (A)a[i + 1]; \
+		s2 += (A)a[i + 2]; \
+		s3 += (A)a[i + 3]; \
+	} \
+	for (; i < n; ++i) \
+		s0 += (A)a[i]; \
+	SETV(rv, (s0 + s1) + (s2 + s3)); \
+} \
+static void x##_dot(const struct pkay *o, const struct pkay *rhs, \
+                    struct variable *rv) { \
+	const T *a = o->u.x, *b = rhs->u.x; \
+	A s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+	int i, n = o->count; \
+	for (i = 0; i + 4 <= n; i += 4) { \
+		s0 += (A)a[i] * (A)b[i]; \
+		s1 += (A)a[i + 1] * (A)b[i + 1]; \
+		s2 += (A)a[i + 2] * (A)b[i + 2]; \
+		s3 += (A)a[i + 3] * (A)b[i + 3]; \
+	} \
+	for (; i < n; ++i) \
+		s0 += (A)a[i] * (A)b[i]; \
+	SETV(rv, (s0 + s1) + (s2 + s3)); \
+} \
+static void x##_minmax(const struct pkay *o, int max, \
+                       struct variable *rv) { \
+	const T *a = o->u.x; \
+	T m0 = a[0], m1 = a[0], m2 = a[0], m3 = a[0]; \
+	int i, n = o->count; \
+	if (max) { \
+		for (i = 0; i + 4 <= n; i += 4) { \
+			m0 = a[i] > m0 ? a[i] : m0; \
+			m1 = a[i + 1] > m1 ? a[i + 1] : m1; \
+			m2 = a[i + 2] > m2 ? a[i + 2] : m2; \
+			m3 = a[i + 3] > m3 ? a[i + 3] : m3; \
+		} \
+		for (; i < n; ++i) \
+			m0 = a[i] > m0 ? a[i] : m0; \
+		m0 = YMD_MAX(m0, m1); \
+		m2 = YMD_MAX(m2, m3); \
+		SETV(rv, YMD_MAX(m0, m2)); \
+	} else { \
+		for (i = 0; i + 4 <= n; i += 4) { \
+			m0 = a[i] < m0 ? a[i] : m0; \
+			m1 = a[i + 1] < m1 ? a[i + 1] : m1; \
+			m2 = a[i + 2] < m2 ? a[i + 2] : m2; \
+			m3 = a[i + 3] < m3 ? a[i + 3] : m3; \
+		} \
+		for (; i < n; ++i) \
+			m0 = a[i] < m0 ? a[i] : m0; \
+		m0 = YMD_MIN(m0, m1); \
+		m2 = YMD_MIN(m2, m3); \
+		SETV(rv, YMD_MIN(m0, m2)); \
+	} \
+} \
+static void x##_scale_i(struct pkay *o, ymd_int_t k) { \
+	T *a = o->u.x; \
+	int i, n = o->count; \
+	for (i = 0; i < n; ++i) \
+		a[i] = (T)((A)a[i] * (A)k); \
+} \
+static void x##_scale_f(struct pkay *o, ymd_float_t k) { \
+	T *a = o->u.x; \
+	int i, n = o->count; \
+	for (i = 0; i < n; ++i) \
+		a[i] = CAST(T, a[i] * k); \
+} \
+static void x##_add_v(struct pkay *o, const struct pkay *rhs) { \
+	T *a = o->u.x; \
+	const T *b = rhs->u.x; \
+	int i, n = o->count; \
+	for (i = 0; i < n; ++i) \
+		a[i] = (T)((A)a[i] + (A)b[i]); \
+} \
+static void x##_add_i(struct pkay *o, ymd_int_t k) { \
+	T *a = o->u.x; \
+	int i, n = o->count; \
+	for (i = 0; i < n; ++i) \
+		a[i] = (T)((A)a[i] + (A)k); \
+} \
+static void x##_add_f(struct pkay *o, ymd_float_t k) { \
+	T *a = o->u.x; \
+	int i, n = o->count; \
+	for (i = 0; i < n; ++i) \
+		a[i] = CAST(T, a[i] + k); \
+} \
+static void x##_prefix_sum(struct pkay *o) { \
+	T *a = o->u.x; \
+	A s = 0; \
+	int i, n = o->count; \
+	for (i = 0; i < n; ++i) { \
+		s += (A)a[i]; \
+		a[i] = (T)s; \
+	} \
+} \
+static void x##_mask_v(const struct pkay *o, int op, \
+                       const struct pkay *rhs, ymd_byte_t *m) { \
+	const T *a = o->u.x, *b = rhs->u.x; \
+	MASK_LOOPS(m, o->count, op, a[i], b[i]) \
+} \
+static void x##_mask_i(const struct pkay *o, int op, ymd_int_t k, \
+                       ymd_byte_t *m) { \
+	const T *a = o->u.x; \
+	MASK_LOOPS(m, o->count, op, a[i], k) \
+} \
+static void x##_mask_f(const struct pkay *o, int op, ymd_float_t k, \
+                       ymd_byte_t *m) { \
+	const T *a = o->u.x; \
+	MASK_LOOPS(m, o->count, op, a[i], k) \
+}
+
+DEFINE_KERNELS(i64, ymd_int_t, ymd_uint_t, SETV_UINT, CAST_INT)
+DEFINE_KERNELS(f64, ymd_float_t, ymd_float_t, setv_float, CAST_FLOAT)
+DEFINE_KERNELS(i32, ymd_i32_t, ymd_uint_t, SETV_UINT, CAST_INT)
+DEFINE_KERNELS(u8, ymd_byte_t, ymd_uint_t, SETV_UINT, CAST_INT)
+
+// Call the kernel `fn' of array `o''s kind with arguments `args'.
+#define KIND_CALL(o, fn, args) \
+	switch (pkay_kind(o)) { \
+	case PKAY_I64: i64_##fn args; break; \
+	case PKAY_F64: f64_##fn args; break; \
+	case PKAY_I32: i32_##fn args; break; \
+	case PKAY_U8:  u8_##fn args; break; \
+	default: assert (!"No reached."); break; \
+	}
+
+static void check_same(struct ymd_mach *vm, const struct pkay *o,
+                       const struct pkay *rhs) {
+	if (pkay_kind(o) != pkay_kind(rhs))
+		ymd_panic(ioslate(vm), "Packed arrays in different kinds: %s, %s",
+		          kinds[pkay_kind(o)].name, kinds[pkay_kind(rhs)].name);
+	if (o->count != rhs->count)
+		ymd_panic(ioslate(vm), "Packed arrays in different counts: %d, %d",
+		          o->count, rhs->count);
+}
+
+void pkay_sum(const struct pkay *o, struct variable *rv) {
+	KIND_CALL(o, sum, (o, rv))
+}
+
+int pkay_minmax(const struct pkay *o, int max, struct variable *rv) {
+	if (o->count == 0)
+		return 0;
+	KIND_CALL(o, minmax, (o, max, rv))
+	return 1;
+}
+
+void pkay_dot(struct ymd_mach *vm, const struct pkay *o,
+		const struct pkay *rhs, struct variable *rv) {
+	check_same(vm, o, rhs);
+	KIND_CALL(o, dot, (o, rhs, rv))
+}
+
+void pkay_scale(struct ymd_mach *vm, struct pkay *o,
+		const struct variable *k) {
+	ymd_int_t n = 0;
+	ymd_float_t f = 0;
+	if (num_of(vm, k, &n, &f)) {
+		KIND_CALL(o, scale_f, (o, f))
+	} else {
+		KIND_CALL(o, scale_i, (o, n))
+	}
+}
+
+void pkay_addto(struct ymd_mach *vm, struct pkay *o,
+		const struct variable *rhs) {
+	ymd_int_t n = 0;
+	ymd_float_t f = 0;
+	if (ymd_type(rhs) == T_PKAY) {
+		check_same(vm, o, pkay_k(rhs));
+		KIND_CALL(o, add_v, (o, pkay_k(rhs)))
+	} else if (num_of(vm, rhs, &n, &f)) {
+		KIND_CALL(o, add_f, (o, f))
+	} else {
+		KIND_CALL(o, add_i, (o, n))
+	}
+}
+
+void pkay_prefix_sum(struct pkay *o) {
+	KIND_CALL(o, prefix_sum, (o))
+}
+
+void pkay_mask(struct ymd_mach *vm, const struct pkay *o, int op,
+		const struct variable *rhs, struct pkay *mask) {
+	ymd_int_t n = 0;
+	ymd_float_t f = 0;
+	assert (pkay_kind(mask) == PKAY_U8);
+	assert (mask->count == o->count);
+	if (ymd_type(rhs) == T_PKAY) {
+		check_same(vm, o, pkay_k(rhs));
+		KIND_CALL(o, mask_v, (o, op, pkay_k(rhs), mask->u.u8))
+	} else if (num_of(vm, rhs, &n, &f)) {
+		KIND_CALL(o, mask_f, (o, op, f, mask->u.u8))
+	} else {
+		KIND_CALL(o, mask_i, (o, op, n, mask->u.u8))
+	}
+}
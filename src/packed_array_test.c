@@ -0,0 +1,160 @@
+#include "core.h"
+#include "yut_rand.h"
+#include <limits.h>
+#include <math.h>
+#include "packed_array_test.def"
+
+static struct ymd_mach *setup() {
+	struct ymd_mach *vm = ymd_init();
+	gc_active(vm, +1);
+	return vm;
+}
+
+static void teardown(struct ymd_mach *vm) {
+	gc_active(vm, -1);
+	ymd_final(vm);
+}
+
+static int test_pkay_creation(struct ymd_mach *vm) {
+	struct pkay *o = pkay_new(vm, PKAY_I32, 3);
+	struct variable v;
+	int i;
+	ASSERT_EQ(int, o->count, 3);
+	ASSERT_EQ(int, pkay_kind(o), PKAY_I32);
+	ASSERT_EQ(int, ymd_type(pkay_get(o, 0, &v)), T_INT);
+	ASSERT_EQ(large, var_int(&v), 0);
+	for (i = 0; i < 100; ++i) {
+		setv_float(&v, i + 0.5);
+		pkay_add(vm, o, &v);
+	}
+	ASSERT_EQ(int, o->count, 103);
+	ASSERT_EQ(large, var_int(pkay_get(o, 102, &v)), 99);
+
+	o = pkay_new(vm, PKAY_U8, 1);
+	setv_int(&v, 257);
+	pkay_set(vm, o, 0, &v);
+	ASSERT_EQ(large, var_int(pkay_get(o, 0, &v)), 1);
+	setv_int(&v, -1);
+	pkay_set(vm, o, 0, &v);
+	ASSERT_EQ(large, var_int(pkay_get(o, 0, &v)), 255);
+
+	ASSERT_EQ(int, pkay_kind_of("float64"), PKAY_F64);
+	ASSERT_EQ(int, pkay_kind_of("int16"), -1);
+	ASSERT_STREQ(pkay_kind_name(PKAY_U8), "uint8");
+	return 0;
+}
+
+// Kernels have unrolled loops, check every length of tail.
+static int test_pkay_kernels(struct ymd_mach *vm) {
+	struct variable v, k;
+	int n, i;
+	for (n = 1; n < 40; ++n) {
+		struct pkay *a = pkay_new(vm, PKAY_I64, n),
+		            *f = pkay_new(vm, PKAY_F64, n),
+		            *m = pkay_new(vm, PKAY_U8, n);
+		ymd_int_t sum = 0, dot = 0, min = 0, max = 0;
+		for (i = 0; i < n; ++i) {
+			ymd_int_t x = (i * 37) % 23 - 11;
+			a->u.i64[i] = x;
+			f->u.f64[i] = (ymd_float_t)x;
+			sum += x;
+			dot += x * x;
+			min = (i == 0 || x < min) ? x : min;
+			max = (i == 0 || x > max) ? x : max;
+		}
+		pkay_sum(a, &v);
+		ASSERT_EQ(large, var_int(&v), sum);
+		pkay_sum(f, &v);
+		ASSERT_DOUBLE_EQ(var_float(&v), (ymd_float_t)sum);
+		pkay_dot(vm, a, a, &v);
+		ASSERT_EQ(large, var_int(&v), dot);
+		pkay_dot(vm, f, f, &v);
+		ASSERT_DOUBLE_EQ(var_float(&v), (ymd_float_t)dot);
+		ASSERT_TRUE(pkay_minmax(a, 0, &v));
+		ASSERT_EQ(large, var_int(&v), min);
+		ASSERT_TRUE(pkay_minmax(f, 1, &v));
+		ASSERT_DOUBLE_EQ(var_float(&v), (ymd_float_t)max);
+
+		setv_int(&k, 0);
+		pkay_mask(vm, a, PKAY_GT, &k, m);
+		for (i = 0; i < n; ++i)
+			ASSERT_EQ(int, m->u.u8[i], a->u.i64[i] > 0);
+		setv_pkay(&k, f);
+		pkay_mask(vm, f, PKAY_EQ, &k, m);
+		pkay_sum(m, &v);
+		ASSERT_EQ(large, var_int(&v), n);
+
+		setv_int(&k, 3);
+		pkay_scale(vm, a, &k);
+		setv_float(&k, 1.5);
+		pkay_addto(vm, f, &k);
+		setv_pkay(&k, a);
+		pkay_addto(vm, a, &k);
+		for (i = 0; i < n; ++i) {
+			ymd_int_t x = (i * 37) % 23 - 11;
+			ASSERT_EQ(large, a->u.i64[i], x * 6);
+			ASSERT_DOUBLE_EQ(f->u.f64[i], x + 1.5);
+		}
+		pkay_prefix_sum(a);
+		ASSERT_EQ(large, a->u.i64[n - 1], sum * 6);
+	}
+	ASSERT_FALSE(pkay_minmax(pkay_new(vm, PKAY_I32, 0), 0, &v));
+	return 0;
+}
+
+static int test_pkay_compare(struct ymd_mach *vm) {
+	struct pkay *a = pkay_new(vm, PKAY_F64, 3), *b = pkay_new(vm, PKAY_F64, 3);
+	struct variable x, y;
+	a->u.f64[1] = 1.0;
+	b->u.f64[1] = 1.0;
+	setv_pkay(&x, a);
+	setv_pkay(&y, b);
+	ASSERT_TRUE(equals(&x, &y));
+	b->u.f64[2] = -1.0;
+	ASSERT_FALSE(equals(&x, &y));
+	ASSERT_GT(int, compare(&x, &y), 0);
+	setv_pkay(&y, pkay_new(vm, PKAY_I64, 3));
+	ASSERT_FALSE(equals(&x, &y));
+	setv_pkay(&x, pkay_new(vm, PKAY_I64, 0));
+	setv_pkay(&y, pkay_new(vm, PKAY_I64, 0));
+	ASSERT_TRUE(equals(&x, &y));
+	return 0;
+}
+
+// Int kinds wrap around, floats out of range saturate. Expected results
+// are set to `w' in the same way: out of range int is float in NaN-boxed
+// build.
+static int test_pkay_overflow(struct ymd_mach *vm) {
+	struct pkay *a = pkay_new(vm, PKAY_I64, 2), *b = pkay_new(vm, PKAY_I32, 2);
+	struct variable v, w;
+	a->u.i64[0] = LLONG_MAX;
+	a->u.i64[1] = 1;
+	pkay_sum(a, &v);
+	setv_int(&w, LLONG_MIN);
+	ASSERT_TRUE(equals(&v, &w));
+	pkay_prefix_sum(a);
+	ASSERT_EQ(large, a->u.i64[1], LLONG_MIN);
+	setv_int(&v, 3);
+	pkay_scale(vm, a, &v);
+	ASSERT_EQ(large, a->u.i64[0], (ymd_int_t)((ymd_uint_t)LLONG_MAX * 3));
+	setv_float(&v, 1e300);
+	pkay_scale(vm, a, &v);
+	ASSERT_EQ(large, a->u.i64[0], LLONG_MAX);
+	ASSERT_EQ(large, a->u.i64[1], LLONG_MIN);
+	setv_float(&v, -1e300);
+	pkay_set(vm, a, 0, &v);
+	ASSERT_EQ(large, a->u.i64[0], LLONG_MIN);
+
+	b->u.i32[0] = INT_MAX;
+	b->u.i32[1] = INT_MAX;
+	pkay_dot(vm, b, b, &v);
+	setv_int(&w, (ymd_int_t)INT_MAX * INT_MAX * 2);
+	ASSERT_TRUE(equals(&v, &w));
+	setv_int(&v, 1);
+	pkay_addto(vm, b, &v);
+	ASSERT_EQ(int, b->u.i32[0], INT_MIN);
+	setv_float(&v, NAN);
+	pkay_addto(vm, b, &v);
+	ASSERT_EQ(int, b->u.i32[1], 0);
+	return 0;
+}
@@ -40,36 +40,32 @@ int ymd_dump_dyay(struct zostream *os, const struct dyay *ax, int *ok) {
 }
 
 int ymd_dump_hmap(struct zostream *os, const struct hmap *mx, int *ok) {
-	int n, t = 0;
-	const struct kvi *i, *k = mx->item + (1 << mx->shift);
+	struct variable k;
+	int i, t = 0;
 	if_recursived(mx, CHECK_OK);
 	mm_work(mutable(mx));
 	// :tt
-	t += zos_u32(os, T_HMAP);
+	t += zos_u32(os, hmap_ordered(mx) ? T_OHMAP : T_HMAP);
 	// :count
-	for (n = 0, i = mx->item; i != k; ++i) if (i->flag) ++n;
-	t += zos_u32(os, n);
+	t += zos_u32(os, hmap_count(mx));
 	// :item
-	for (i = mx->item; i != k; ++i) {
-		if (i->flag) {
-			t += ymd_serialize(os, &i->k, CHECK_OK);
-			t += ymd_serialize(os, &i->v, CHECK_OK);
-		}
+	for (i = hmap_next(mx, 0); i < hmap_end(mx); i = hmap_next(mx, i + 1)) {
+		t += ymd_serialize(os, hmap_key(mx, i, &k), CHECK_OK);
+		t += ymd_serialize(os, hmap_val(mx, i), CHECK_OK);
 	}
 	mm_idle(mutable(mx));
 	return t;
 }
 
 int ymd_dump_skls(struct zostream *os, const struct skls *sk, int *ok) {
-	int n, t = 0;
+	int t = 0;
 	const struct sknd *i;
 	if_recursived(sk, CHECK_OK);
 	mm_work(mutable(sk));
 	// :tt
 	t += zos_u32(os, T_SKLS);
 	// :count
-	for (n = 0, i = sk->head->fwd[0]; i != NULL; i = i->fwd[0]) ++n;
-	t += zos_u32(os, n);
+	t += zos_u32(os, sk->count);
 	// :node
 	for (i = sk->head->fwd[0]; i != NULL; i = i->fwd[0]) {
 		t += ymd_serialize(os, &i->k, CHECK_OK);
@@ -79,6 +75,130 @@ int ymd_dump_skls(struct zostream *os, const struct skls *sk, int *ok) {
 	return t;
 }
 
+int ymd_dump_btre(struct zostream *os, const struct btre *bt, int *ok) {
+	int t = 0, j;
+	const struct btlf *i;
+	if_recursived(bt, CHECK_OK);
+	mm_work(mutable(bt));
+	// :tt
+	t += zos_u32(os, T_BTRE);
+	// :count
+	t += zos_u32(os, bt->count);
+	// :pair
+	for (i = bt->first; i != NULL; i = i->next) {
+		for (j = 0; j < i->nd.n; ++j) {
+			t += ymd_serialize(os, i->nd.k + j, CHECK_OK);
+			t += ymd_serialize(os, i->v + j, CHECK_OK);
+		}
+	}
+	mm_idle(mutable(bt));
+	return t;
+}
+
+int ymd_dump_pkay(struct zostream *os, const struct pkay *pk) {
+	int t = 0, k = pk->count * pkay_elem_size(pkay_kind(pk));
+	// :tt
+	t += zos_u32(os, T_PKAY);
+	// :kind
+	t += zos_u32(os, pkay_kind(pk));
+	// :count
+	t += zos_u32(os, pk->count);
+	// :elem, in native byte order as floats are
+	if (k > 0)
+		zos_append(os, pk->u.raw, k);
+	return t + k;
+}
+
+int ymd_dump_dequ(struct zostream *os, const struct dequ *dq, int *ok) {
+	int j, i = 0;
+	if_recursived(dq, CHECK_OK);
+	mm_work(mutable(dq));
+	// :tt
+	i += zos_u32(os, T_DEQU);
+	// :count
+	i += zos_u32(os, dq->count);
+	// :elem, from front to back
+	for (j = 0; j < dq->count; ++j) {
+		i += ymd_serialize(os, dequ_get(dq, j), CHECK_OK);
+	}
+	mm_idle(mutable(dq));
+	return i;
+}
+
+int ymd_dump_heap(struct zostream *os, const struct heap *hp, int *ok) {
+	int j, i = 0, user = (hp->cmp != SKLS_ASC && hp->cmp != SKLS_DASC);
+	if_recursived(hp, CHECK_OK);
+	// Native functions can not be dumped.
+	pickle_assert(!user || !hp->cmp->is_c);
+	pickle_assert(!hp->key || !hp->key->is_c);
+	mm_work(mutable(hp));
+	// :tt
+	i += zos_u32(os, T_HEAP);
+	// :order 0: asc, 1: dasc, 2: comparing function
+	i += zos_u32(os, user ? 2 : (hp->cmp == SKLS_DASC));
+	if (user) {
+		i += ymd_dump_func(os, hp->cmp, CHECK_OK);
+	}
+	// :key
+	i += zos_u32(os, hp->key != NULL);
+	if (hp->key) {
+		i += ymd_dump_func(os, hp->key, CHECK_OK);
+	}
+	// :count
+	i += zos_u32(os, hp->count);
+	// :elem, in storage order
+	for (j = 0; j < hp->count; ++j) {
+		i += ymd_serialize(os, hp->elem + j, CHECK_OK);
+	}
+	mm_idle(mutable(hp));
+	return i;
+}
+
+int ymd_dump_hset(struct zostream *os, const struct hset *hs, int *ok) {
+	int j, i = 0;
+	if_recursived(hs, CHECK_OK);
+	mm_work(mutable(hs));
+	// :tt
+	i += zos_u32(os, T_HSET);
+	// :count
+	i += zos_u32(os, hs->count);
+	// :key
+	for (j = 0; j < hset_nslot(hs); ++j) {
+		if (hset_full(hs, j)) {
+			i += ymd_serialize(os, hs->key + j, CHECK_OK);
+		}
+	}
+	mm_idle(mutable(hs));
+	return i;
+}
+
+int ymd_dump_lruc(struct zostream *os, const struct lruc *lc, int *ok) {
+	int j, i = 0;
+	if_recursived(lc, CHECK_OK);
+	pickle_assert(!lc->evict || !lc->evict->is_c);
+	mm_work(mutable(lc));
+	// :tt
+	i += zos_u32(os, T_LRUC);
+	// :bytes 0: capacity in entries, 1: in bytes
+	i += zos_u32(os, lruc_inbytes(lc) != 0);
+	// :limit
+	i += zos_i64(os, lc->limit);
+	// :evict
+	i += zos_u32(os, lc->evict != NULL);
+	if (lc->evict) {
+		i += ymd_dump_func(os, lc->evict, CHECK_OK);
+	}
+	// :count
+	i += zos_u32(os, lc->count);
+	// :pair, from the least recently used one, counters are not dumped.
+	for (j = lc->tail; j >= 0; j = lc->node[j].prev) {
+		i += ymd_serialize(os, &lc->node[j].k, CHECK_OK);
+		i += ymd_serialize(os, &lc->node[j].v, CHECK_OK);
+	}
+	mm_idle(mutable(lc));
+	return i;
+}
+
 int ymd_dump_chunk(struct zostream *os, const struct chunk *bk, int *ok) {
 	int k, j, i = 0;
 	// :inst
@@ -136,15 +256,15 @@ int ymd_serialize(struct zostream *os, const struct variable *v,
 		break;
 	case T_INT:
 		i += zos_u32(os, T_INT);
-		i += zos_i64(os, v->u.i);
+		i += zos_i64(os, var_int(v));
 		break;
 	case T_FLOAT:
 		i += zos_u32(os, T_FLOAT);
-		i += zos_float(os, v->u.f);
+		i += zos_float(os, var_float(v));
 		break;
 	case T_BOOL:
 		i += zos_u32(os, T_BOOL);
-		i += zos_u64(os, v->u.i);
+		i += zos_u64(os, var_int(v));
 		break;
 	case T_KSTR:
 		i += ymd_dump_kstr(os, kstr_k(v));
@@ -161,6 +281,24 @@ int ymd_serialize(struct zostream *os, const struct variable *v,
 	case T_SKLS:
 		i += ymd_dump_skls(os, skls_k(v), ok);
 		break;
+	case T_BTRE:
+		i += ymd_dump_btre(os, btre_k(v), ok);
+		break;
+	case T_PKAY:
+		i += ymd_dump_pkay(os, pkay_k(v));
+		break;
+	case T_DEQU:
+		i += ymd_dump_dequ(os, dequ_k(v), ok);
+		break;
+	case T_HEAP:
+		i += ymd_dump_heap(os, heap_k(v), ok);
+		break;
+	case T_HSET:
+		i += ymd_dump_hset(os, hset_k(v), ok);
+		break;
+	case T_LRUC:
+		i += ymd_dump_lruc(os, lruc_k(v), ok);
+		break;
 	default:
 		*ok = 0;
 		break;
@@ -285,10 +423,13 @@ int ymd_load_func(struct zistream *is, int *ok) {
 	return i;
 }
 
-int ymd_load_hmap(struct zistream *is, int *ok) {
+int ymd_load_hmap(struct zistream *is, int ordered, int *ok) {
 	struct ymd_context *l = context(is);
 	int i, k = zis_u32(is);
-	ymd_hmap(l, k);
+	if (ordered)
+		ymd_hmap_ordered(l, k);
+	else
+		ymd_hmap(l, k);
 	for (i = 0; i < k; ++i) {
 		ymd_parse(is, CHECK_OK);
 		ymd_parse(is, CHECK_OK);
@@ -299,8 +440,29 @@ int ymd_load_hmap(struct zistream *is, int *ok) {
 
 int ymd_load_skls(struct zistream *is, int *ok) {
 	struct ymd_context *l = context(is);
+	struct skls_loader ld;
+	struct variable v;
 	int i, k = zis_u32(is);
 	ymd_skls(l, SKLS_ASC);
+	// Pairs are dumped in order, so link them without searching.
+	skls_load_begin(&ld, skls_x(ymd_top(l, 0)));
+	for (i = 0; i < k; ++i) {
+		ymd_parse(is, CHECK_OK);
+		ymd_parse(is, CHECK_OK);
+		if (is_nil(ymd_top(l, 1)))
+			ymd_panic(l, "No any key will be `nil'");
+		v = *ymd_top(l, 0);
+		*skls_load(l->vm, &ld, ymd_top(l, 1)) = v;
+		ymd_pop(l, 2);
+	}
+	return 0;
+}
+
+int ymd_load_btre(struct zistream *is, int *ok) {
+	struct ymd_context *l = context(is);
+	int i, k = zis_u32(is);
+	ymd_btre(l, SKLS_ASC);
+	// Pairs are dumped in order: each one goes to the last leaf.
 	for (i = 0; i < k; ++i) {
 		ymd_parse(is, CHECK_OK);
 		ymd_parse(is, CHECK_OK);
@@ -309,6 +471,115 @@ int ymd_load_skls(struct zistream *is, int *ok) {
 	return 0;
 }
 
+int ymd_load_pkay(struct zistream *is, int *ok) {
+	struct ymd_context *l = context(is);
+	struct pkay *o;
+	ymd_u32_t kind = zis_u32(is), k = zis_u32(is);
+	pickle_assert(kind < PKAY_MAX);
+	pickle_assert(k <= (ymd_u32_t)zis_remain(is) / pkay_elem_size(kind));
+	o = ymd_pkay(l, kind, k);
+	if (k > 0)
+		zis_fetch(is, o->u.raw, k * pkay_elem_size(kind));
+	return 0;
+}
+
+int ymd_load_dequ(struct zistream *is, int *ok) {
+	struct ymd_context *l = context(is);
+	struct dequ *o;
+	ymd_u32_t i, k = zis_u32(is);
+	pickle_assert(k <= (ymd_u32_t)zis_remain(is)); // 1 byte :tt at least
+	o = ymd_dequ(l, k);
+	for (i = 0; i < k; ++i) {
+		ymd_parse(is, CHECK_OK);
+		*dequ_push(l->vm, o, 0) = *ymd_top(l, 0);
+		ymd_pop(l, 1);
+	}
+	return 0;
+}
+
+int ymd_load_heap(struct zistream *is, int *ok) {
+	struct ymd_context *l = context(is);
+	struct func *cmp, *key = NULL;
+	struct heap *o;
+	ymd_u32_t i, k, n = 0, order = zis_u32(is);
+	pickle_assert(order <= 2);
+	cmp = order == 0 ? SKLS_ASC : SKLS_DASC;
+	if (order == 2) {
+		pickle_assert(T_FUNC == zis_u32(is));
+		ymd_load_func(is, CHECK_OK);
+		cmp = func_x(ymd_top(l, 0));
+		++n;
+	}
+	if (zis_u32(is)) {
+		pickle_assert(order != 2);
+		pickle_assert(T_FUNC == zis_u32(is));
+		ymd_load_func(is, CHECK_OK);
+		key = func_x(ymd_top(l, 0));
+		++n;
+	}
+	k = zis_u32(is);
+	pickle_assert(k <= (ymd_u32_t)zis_remain(is)); // 1 byte :tt at least
+	o = ymd_heap(l, cmp, key);
+	// Elements are in heap order already, pushing moves none of them.
+	for (i = 0; i < k; ++i) {
+		ymd_parse(is, CHECK_OK);
+		heap_push(l->vm, o, ymd_top(l, 0));
+		ymd_pop(l, 1);
+	}
+	if (n > 0) { // Functions are in the heap now.
+		*ymd_top(l, n) = *ymd_top(l, 0);
+		ymd_pop(l, n);
+	}
+	return 0;
+}
+
+int ymd_load_hset(struct zistream *is, int *ok) {
+	struct ymd_context *l = context(is);
+	struct hset *o;
+	ymd_u32_t i, k = zis_u32(is);
+	pickle_assert(k <= (ymd_u32_t)zis_remain(is)); // 1 byte :tt at least
+	o = ymd_hset(l, k);
+	for (i = 0; i < k; ++i) {
+		ymd_parse(is, CHECK_OK);
+		pickle_assert(!is_nil(ymd_top(l, 0)));
+		hset_put(l->vm, o, ymd_top(l, 0));
+		ymd_pop(l, 1);
+	}
+	return 0;
+}
+
+int ymd_load_lruc(struct zistream *is, int *ok) {
+	struct ymd_context *l = context(is);
+	struct func *evict = NULL;
+	struct lruc *o;
+	ymd_u32_t i, k, inbytes = zis_u32(is);
+	ymd_int_t limit = zis_i64(is);
+	pickle_assert(inbytes <= 1);
+	pickle_assert(limit > 0);
+	if (zis_u32(is)) {
+		pickle_assert(T_FUNC == zis_u32(is));
+		ymd_load_func(is, CHECK_OK);
+		evict = func_x(ymd_top(l, 0));
+	}
+	k = zis_u32(is);
+	pickle_assert(k <= (ymd_u32_t)zis_remain(is) / 2); // 2 bytes at least
+	pickle_assert(inbytes || k <= limit);
+	o = ymd_lruc(l, limit, inbytes, evict);
+	// Putting from the least recently used one restores the order.
+	for (i = 0; i < k; ++i) {
+		ymd_parse(is, CHECK_OK);
+		ymd_parse(is, CHECK_OK);
+		pickle_assert(!is_nil(ymd_top(l, 1)));
+		lruc_put(l->vm, o, ymd_top(l, 1), ymd_top(l, 0));
+		ymd_pop(l, 2);
+	}
+	if (evict) { // Function is in the cache now.
+		*ymd_top(l, 1) = *ymd_top(l, 0);
+		ymd_pop(l, 1);
+	}
+	return 0;
+}
+
 int ymd_parse(struct zistream *is, int *ok) {
 	struct ymd_context *l = context(is);
 	ymd_u32_t tt = zis_u32(is);
@@ -336,11 +607,30 @@ int ymd_parse(struct zistream *is, int *ok) {
 		ymd_load_dyay(is, CHECK_OK);
 		break;
 	case T_HMAP:
-		ymd_load_hmap(is, CHECK_OK);
+	case T_OHMAP:
+		ymd_load_hmap(is, tt == T_OHMAP, CHECK_OK);
 		break;
 	case T_SKLS:
 		ymd_load_skls(is, CHECK_OK);
 		break;
+	case T_BTRE:
+		ymd_load_btre(is, CHECK_OK);
+		break;
+	case T_PKAY:
+		ymd_load_pkay(is, CHECK_OK);
+		break;
+	case T_DEQU:
+		ymd_load_dequ(is, CHECK_OK);
+		break;
+	case T_HEAP:
+		ymd_load_heap(is, CHECK_OK);
+		break;
+	case T_HSET:
+		ymd_load_hset(is, CHECK_OK);
+		break;
+	case T_LRUC:
+		ymd_load_lruc(is, CHECK_OK);
+		break;
 	default:
 		*ok = 0;
 		break;
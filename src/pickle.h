@@ -6,10 +6,19 @@
 struct zistream;
 struct zostream;
 
+// Type tag of hash map which keeps inserting order.
+#define T_OHMAP (0x100 | T_HMAP)
+
 int ymd_dump_kstr(struct zostream *os, const struct kstr *kz);
 int ymd_dump_dyay(struct zostream *os, const struct dyay *ax, int *ok);
 int ymd_dump_hmap(struct zostream *os, const struct hmap *mx, int *ok);
 int ymd_dump_skls(struct zostream *os, const struct skls *sk, int *ok);
+int ymd_dump_btre(struct zostream *os, const struct btre *bt, int *ok);
+int ymd_dump_pkay(struct zostream *os, const struct pkay *pk);
+int ymd_dump_dequ(struct zostream *os, const struct dequ *dq, int *ok);
+int ymd_dump_heap(struct zostream *os, const struct heap *hp, int *ok);
+int ymd_dump_hset(struct zostream *os, const struct hset *hs, int *ok);
+int ymd_dump_lruc(struct zostream *os, const struct lruc *lc, int *ok);
 int ymd_dump_chunk(struct zostream *os, const struct chunk *bk, int *ok);
 int ymd_dump_func(struct zostream *os, const struct func *fn, int *ok);
 int ymd_serialize(struct zostream *os, const struct variable *v,int *ok);
@@ -21,8 +30,14 @@ int ymd_load_kstr(struct zistream *is, int *ok);
 int ymd_load_dyay(struct zistream *is, int *ok);
 int ymd_load_chunk(struct zistream *is, struct chunk *x, int *ok);
 int ymd_load_func(struct zistream *is, int *ok);
-int ymd_load_hmap(struct zistream *is, int *ok);
+int ymd_load_hmap(struct zistream *is, int ordered, int *ok);
 int ymd_load_skls(struct zistream *is, int *ok);
+int ymd_load_btre(struct zistream *is, int *ok);
+int ymd_load_pkay(struct zistream *is, int *ok);
+int ymd_load_dequ(struct zistream *is, int *ok);
+int ymd_load_heap(struct zistream *is, int *ok);
+int ymd_load_hset(struct zistream *is, int *ok);
+int ymd_load_lruc(struct zistream *is, int *ok);
 int ymd_parse(struct zistream *is, int *ok);
 
 // load variable to top
@@ -176,7 +176,12 @@ static int dump_o (void *o, unsigned tt, struct ymd_mach *vm) {
 	if (tt == T_HMAP) {
 		i = ymd_dump_hmap(&os, o, CHECK_OK);
 	} else {
-		i = ymd_dump_skls(&os, o, CHECK_OK);
+		// Ordered by key or by inserting, pairs are in the same order.
+		if (tt == T_SKLS) {
+			i = ymd_dump_skls(&os, o, CHECK_OK);
+		} else {
+			i = ymd_dump_hmap(&os, o, CHECK_OK);
+		}
 		zis_pipe(&is, &os);
 		ASSERT_EQ(uint,   zis_u32(&is), tt);
 		ASSERT_EQ(uint,   zis_u32(&is), 5);
@@ -225,7 +230,8 @@ static int dump_o (void *o, unsigned tt, struct ymd_mach *vm) {
 		//=====
 		ASSERT_EQ(int, zis_remain(&is), 0);
 	}
-	ASSERT_EQ(int, i, 58);
+	// Tag of ordered hash map is encoded in 2 bytes.
+	ASSERT_EQ(int, i, tt == T_OHMAP ? 59 : 58);
 	zis_final(&is);
 	zos_final(&os);
 	return 0;
@@ -239,6 +245,10 @@ static int test_dump_skls (struct ymd_mach *vm) {
 	return dump_o (skls_new(vm, SKLS_ASC), T_SKLS, vm);
 }
 
+static int test_dump_ordered_hmap (struct ymd_mach *vm) {
+	return dump_o (hmap_new_ordered(vm, 0), T_OHMAP, vm);
+}
+
 static int test_load_simple (struct ymd_mach *vm) {
 	struct ymd_context *l = ioslate(vm);
 	struct zostream os = ZOS_INIT;
@@ -256,20 +266,20 @@ static int test_load_simple (struct ymd_mach *vm) {
 	zis_pipe(&is, &os);
 
 	ymd_parse(&is, CHECK_OK);
-	ASSERT_EQ(uint, ymd_top(l, 0)->tt, T_NIL);
+	ASSERT_EQ(uint, var_tt(ymd_top(l, 0)), T_NIL);
 	ymd_pop(l, 1);
 
 	ymd_parse(&is, CHECK_OK);
-	ASSERT_EQ(uint,  ymd_top(l, 0)->tt,    T_INT);
-	ASSERT_EQ(large, ymd_top(l, 0)->u.i, 0x8040);
+	ASSERT_EQ(uint,  var_tt(ymd_top(l, 0)),    T_INT);
+	ASSERT_EQ(large, var_int(ymd_top(l, 0)), 0x8040);
 
 	ymd_parse(&is, CHECK_OK);
-	ASSERT_EQ(uint,  ymd_top(l, 0)->tt,    T_BOOL);
-	ASSERT_EQ(large, ymd_top(l, 0)->u.i, 1);
+	ASSERT_EQ(uint,  var_tt(ymd_top(l, 0)),    T_BOOL);
+	ASSERT_EQ(large, var_int(ymd_top(l, 0)), 1);
 
 	ymd_parse(&is, CHECK_OK);
-	ASSERT_EQ(uint,  ymd_top(l, 0)->tt,    T_BOOL);
-	ASSERT_EQ(large, ymd_top(l, 0)->u.i, 0);
+	ASSERT_EQ(uint,  var_tt(ymd_top(l, 0)),    T_BOOL);
+	ASSERT_EQ(large, var_int(ymd_top(l, 0)), 0);
 	zis_final(&is);
 	zos_final(&os);
 	return 0;
@@ -324,11 +334,11 @@ static int test_load_dyay (struct ymd_mach *vm) {
 	ax = dyay_x(ymd_top(l, 0));
 	ASSERT_EQ(int,   ax->count, 3);
 
-	ASSERT_EQ(uint,  ax->elem[0].tt, T_INT);
-	ASSERT_EQ(large, ax->elem[0].u.i, 0x20108040LL);
+	ASSERT_EQ(uint,  var_tt(&ax->elem[0]), T_INT);
+	ASSERT_EQ(large, var_int(&ax->elem[0]), 0x20108040LL);
 
-	ASSERT_EQ(uint,  ax->elem[1].tt, T_BOOL);
-	ASSERT_EQ(large, ax->elem[1].u.i, 1LL);
+	ASSERT_EQ(uint,  var_tt(&ax->elem[1]), T_BOOL);
+	ASSERT_EQ(large, var_int(&ax->elem[1]), 1LL);
 
 	ASSERT_EQ(int,  ymd_type(&ax->elem[2]), T_KSTR);
 	ASSERT_STREQ(kstr_k(ax->elem + 2)->land, "01234567");
@@ -370,16 +380,16 @@ static int load_o (int tt, struct ymd_mach *vm) {
 	zis_pipe(&is, &os);
 	ymd_parse(&is, CHECK_OK);
 	ASSERT_EQ(int, ymd_type(ymd_top(l, 0)), tt);
-	o = ymd_top(l, 0)->u.ref;
+	o = var_ref(ymd_top(l, 0));
 
-	ASSERT_EQ(int,  vm_mem(l->vm, o, "1st")->tt, T_INT);
-	ASSERT_EQ(large, vm_mem(l->vm, o, "1st")->u.i, 1LL);
+	ASSERT_EQ(int,  var_tt(vm_mem(l->vm, o, "1st")), T_INT);
+	ASSERT_EQ(large, var_int(vm_mem(l->vm, o, "1st")), 1LL);
 
-	ASSERT_EQ(int,  vm_mem(l->vm, o, "2nd")->tt, T_INT);
-	ASSERT_EQ(large, vm_mem(l->vm, o, "2nd")->u.i, 2LL);
+	ASSERT_EQ(int,  var_tt(vm_mem(l->vm, o, "2nd")), T_INT);
+	ASSERT_EQ(large, var_int(vm_mem(l->vm, o, "2nd")), 2LL);
 
-	ASSERT_EQ(int,  vm_mem(l->vm, o, "3rd")->tt, T_INT);
-	ASSERT_EQ(large, vm_mem(l->vm, o, "3rd")->u.i, 3LL);
+	ASSERT_EQ(int,  var_tt(vm_mem(l->vm, o, "3rd")), T_INT);
+	ASSERT_EQ(large, var_int(vm_mem(l->vm, o, "3rd")), 3LL);
 
 	ymd_pop(l, 1);
 	zis_final(&is);
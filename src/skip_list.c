@@ -2,45 +2,39 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-#include <time.h>
 #include <stdio.h>
 
 //------------------------------------------------------------------
 // Skip List:
 // -----------------------------------------------------------------
-#define MAX_LEVEL 16
+#define MAX_LEVEL SKLS_MAX_LEVEL
 
-static unsigned int rand_range(unsigned int mod) {
-	unsigned int raw = (unsigned)rand();
-	unsigned int rv = 0;
-	rv |= ((raw & 0xfffff000) >> 12) ^ ((unsigned)time(NULL));
-	rv |= (raw & 0x00000fff) << 20;
-	return rv % mod;
+// Level from one random word: each trailing zero bit is a won coin flip,
+// so P(lvl > n) = 2^-n, capped by the bit set at MAX_LEVEL - 1.
+static unsigned short randlv(struct ymd_mach *vm) {
+	ymd_uint_t r = vm_rand(vm) | (1ULL << (MAX_LEVEL - 1));
+	return (unsigned short)(ymd_lowest_bit(r) + 1);
 }
 
-static unsigned short randlv() {
-	unsigned short lvl = 1;
-	while (rand_range(100) < 50 && lvl < MAX_LEVEL)
-		++lvl;
-	return lvl;
-}
+#define sknd_size(lv) \
+	(sizeof(struct sknd) + ((lv) - 1) * sizeof(struct sknd*) + \
+	 (lv) * sizeof(int))
+
+#define node_size(o, lv) \
+	((o)->key ? sknd_okey_off(lv) + sizeof(struct variable) : sknd_size(lv))
 
-static struct sknd *mknode(struct ymd_mach *vm, unsigned short lv) {
-	struct sknd *x = mm_zalloc(vm, 1, sizeof(struct sknd) +
-	                           (lv - 1) * sizeof(struct sknd*));
+static struct sknd *mknode(struct ymd_mach *vm, size_t size,
+                           unsigned short lv) {
+	struct sknd *x = mm_zalloc(vm, 1, size);
 	x->n = lv;
 	return x;
 }
 
-static YMD_INLINE int skls_count(const struct skls *o) {
-	int rv = 0;
-	const struct sknd *i = o->head;
-	while ((i = i->fwd[0]) != NULL)
-		++rv;
-	return rv;
-}
+// The key to order by of node `x'
+#define ordk(o, x) ((o)->key ? sknd_okey(x) : &(x)->k)
 
-ymd_int_t skls_key_compare(struct ymd_mach *vm, const struct skls *o,
+// Compare the keys to order by.
+static ymd_int_t order_compare(struct ymd_mach *vm, const struct skls *o,
 		const struct variable *lhs, const struct variable *rhs) {
 	ymd_int_t rv;
 	struct ymd_context *l = ioslate(vm);
@@ -59,33 +53,86 @@ ymd_int_t skls_key_compare(struct ymd_mach *vm, const struct skls *o,
 	return rv;
 }
 
+// The key to order by of `k': key(k) for a key function list, the result
+// stays in the stack until ordkey_pop().
+static const struct variable *ordkey_push(struct ymd_mach *vm,
+		const struct skls *o, const struct variable *k) {
+	struct ymd_context *l = ioslate(vm);
+	struct variable arg;
+	if (!o->key)
+		return k;
+	arg = *k; // `k' may be in the stack, copy it before growing.
+	setv_func(ymd_push(l), o->key);
+	*ymd_push(l) = arg;
+	if (!ymd_call(l, o->key, 1, 0))
+		ymd_panic(l, "ordkey_push() Bad key function");
+	return ymd_top(l, 0);
+}
+
+#define ordkey_pop(vm, o) \
+	do { if ((o)->key) ymd_pop(ioslate(vm), 1); } while (0)
+
+ymd_int_t skls_key_compare(struct ymd_mach *vm, const struct skls *o,
+		const struct variable *lhs, const struct variable *rhs) {
+	struct variable lk, rk = *rhs;
+	ymd_int_t rv;
+	if (!o->key)
+		return order_compare(vm, o, lhs, rhs);
+	lk = *ordkey_push(vm, o, lhs);
+	rv = order_compare(vm, o, &lk, ordkey_push(vm, o, &rk));
+	ymd_pop(ioslate(vm), 2);
+	return rv;
+}
+
+// Find the insert position of key to order by `k': update[i] is the last
+// node before `k' in level i, and rank[i] is its rank (the head's rank
+// is 0).
 static struct sknd *skls_pos(struct ymd_mach *vm, struct skls *o,
-		const struct variable *k, struct sknd *update[MAX_LEVEL]) {
+		const struct variable *k, struct sknd *update[MAX_LEVEL],
+		int rank[MAX_LEVEL]) {
 	struct sknd *x = o->head;
-	int i;
+	int i, r = 0;
 	memset(update, 0, MAX_LEVEL * sizeof(struct sknd*));
 	for (i = o->lv - 1; i >= 0; --i) {
-		while (x->fwd[i] && skls_key_compare(vm, o, &x->fwd[i]->k, k) < 0)
+		while (x->fwd[i] && order_compare(vm, o, ordk(o, x->fwd[i]), k) < 0) {
+			r += sknd_span(x)[i];
 			x = x->fwd[i];
+		}
 		update[i] = x;
+		rank[i] = r;
 	}
 	return x->fwd[0];
 }
 
 static struct sknd *append(struct ymd_mach *vm, struct skls *o,
-		struct sknd *update[]) {
+		struct sknd *update[], int rank[]) {
 	struct sknd *x;
-	unsigned short i, lvl = randlv();
+	unsigned short i, lvl = randlv(vm);
 	if (lvl > o->lv) {
-		for (i = o->lv; i < lvl; ++i)
+		for (i = o->lv; i < lvl; ++i) {
 			update[i] = o->head;
+			rank[i] = 0;
+			sknd_span(o->head)[i] = o->count;
+		}
 		o->lv = lvl;
 	}
-	x = mknode(vm, lvl); ++o->count;
+	x = mknode(vm, node_size(o, lvl), lvl);
 	for (i = 0; i < lvl; ++i) {
+		int *span = sknd_span(update[i]);
 		x->fwd[i] = update[i]->fwd[i];
 		update[i]->fwd[i] = x;
+		sknd_span(x)[i] = span[i] - (rank[0] - rank[i]);
+		span[i] = rank[0] - rank[i] + 1;
 	}
+	// Higher levels jump over the new node.
+	for (; i < o->lv; ++i)
+		++sknd_span(update[i])[i];
+	x->bwd = update[0] == o->head ? NULL : update[0];
+	if (x->fwd[0])
+		x->fwd[0]->bwd = x;
+	else
+		o->tail = x;
+	++o->count;
 	return x;
 }
 
@@ -93,19 +140,28 @@ static struct variable *skfind(struct ymd_mach *vm, const struct skls *o,
 		const struct variable *k) {
 	struct sknd *x = o->head;
 	int i;
-	// For get/put operation
+	// For get/put operation, `k' is the key to order by.
 	if (vm) {
 		for (i = o->lv - 1; i >= 0; --i) {
-			while (x->fwd[i] && skls_key_compare(vm, o, &x->fwd[i]->k, k) < 0) {
+			while (x->fwd[i] &&
+			       order_compare(vm, o, ordk(o, x->fwd[i]), k) < 0) {
 				x = x->fwd[i];
 			}
 		}
 		x = x->fwd[0];
-		return (x && skls_key_compare(vm, o, &x->k, k) == 0) ? &x->v : knil;
+		return (x && order_compare(vm, o, ordk(o, x), k) == 0) ? &x->v : knil;
+	}
+	// For pure comparing: a user or key function ordered list can not be
+	// searched without calling its function, so walk it.
+	if (o->key || (o->cmp != SKLS_ASC && o->cmp != SKLS_DASC)) {
+		while ((x = x->fwd[0]) != NULL)
+			if (equals(&x->k, k))
+				return &x->v;
+		return knil;
 	}
-	// For pure comparing
 	for (i = o->lv - 1; i >= 0; --i) {
-		while (x->fwd[i] && compare(&x->fwd[i]->k, k) < 0) {
+		while (x->fwd[i] && (o->cmp == SKLS_ASC ?
+		       compare(&x->fwd[i]->k, k) : compare(k, &x->fwd[i]->k)) < 0) {
 			x = x->fwd[i];
 		}
 	}
@@ -117,7 +173,18 @@ struct skls *skls_new(struct ymd_mach *vm, struct func *order) {
 	struct skls *x = gc_new(vm, sizeof(struct skls), T_SKLS);
 	x->lv = 0;
 	x->cmp = order;
-	x->head = mknode(vm, MAX_LEVEL);
+	x->key = NULL;
+	x->head = mknode(vm, sknd_size(MAX_LEVEL), MAX_LEVEL);
+	x->tail = NULL;
+	return x;
+}
+
+struct skls *skls_new_key(struct ymd_mach *vm, struct func *order,
+                          struct func *key) {
+	struct skls *x;
+	assert (!key || order == SKLS_ASC || order == SKLS_DASC);
+	x = skls_new(vm, order);
+	x->key = key;
 	return x;
 }
 
@@ -127,23 +194,23 @@ void skls_final(struct ymd_mach *vm, struct skls *o) {
 	while (i) {
 		p = i;
 		i = i->fwd[0];
-		mm_free(vm, p, 1, sizeof(struct sknd) +
-		        (p->n - 1) * sizeof(struct sknd *));
+		mm_free(vm, p, 1, p == o->head ? sknd_size(p->n) :
+		        node_size(o, p->n));
 	}
 }
 
 int skls_equals(const struct skls *o, const struct skls *rhs) {
 	const struct sknd *i = o->head;
-	int count = 0, rhs_count = skls_count(rhs);
 	if (o == rhs)
 		return 1;
+	if (o->count != rhs->count)
+		return 0;
 	assert(i != NULL);
 	while ((i = i->fwd[0]) != NULL) {
 		if (!equals(&i->v, skfind(NULL, rhs, &i->k)))
 			return 0;
-		++count;
 	}
-	return (count == rhs_count);
+	return 1;
 }
 
 int skls_compare(const struct skls *o, const struct skls *rhs) {
@@ -157,51 +224,172 @@ int skls_compare(const struct skls *o, const struct skls *rhs) {
 	return rv;
 }
 
+// Put `key' which key to order by is `ok'.
+static struct variable *put_ordkey(struct ymd_mach *vm, struct skls *o,
+		const struct variable *key, const struct variable *ok) {
+	struct sknd *update[MAX_LEVEL], *x;
+	int rank[MAX_LEVEL];
+	x = skls_pos(vm, o, ok, update, rank);
+	if (!x || order_compare(vm, o, ordk(o, x), ok) != 0) { // Has found k ?
+		x = append(vm, o, update, rank);
+		++o->version;
+	}
+	if (o->key)
+		*sknd_okey(x) = *ok;
+	x->k = *key;
+	return &x->v;
+}
+
 struct variable *skls_put(struct ymd_mach *vm, struct skls *o,
 		const struct variable *k) {
-	struct sknd *update[MAX_LEVEL], *x;
+	struct variable key = *k, *rv;
 	assert(!is_nil(k));
-	x = skls_pos(vm, o, k, update);
-	if (!x || skls_key_compare(vm, o, &x->k, k) != 0) // Has found k ?
-		x = append(vm, o, update);
-	x->k = *k;
-	return &x->v;
+	rv = put_ordkey(vm, o, &key, ordkey_push(vm, o, &key));
+	ordkey_pop(vm, o);
+	return rv;
 }
 
 struct variable *skls_get(struct ymd_mach *vm, struct skls *o,
 		const struct variable *k) {
+	struct variable *rv;
 	assert(!is_nil(k));
-	return skfind(vm, o, k);
+	rv = skfind(vm, o, ordkey_push(vm, o, k));
+	ordkey_pop(vm, o);
+	return rv;
 }
 
 int skls_remove(struct ymd_mach *vm, struct skls *o,
 		const struct variable *k) {
-	struct sknd *update[MAX_LEVEL], *x = skls_pos(vm, o, k, update);
-	int i;
-	if (skls_key_compare(vm, o, &x->k, k) != 0)
+	struct sknd *update[MAX_LEVEL], *x;
+	const struct variable *ok = ordkey_push(vm, o, k);
+	int i, rank[MAX_LEVEL];
+	x = skls_pos(vm, o, ok, update, rank);
+	i = !x || order_compare(vm, o, ordk(o, x), ok) != 0;
+	ordkey_pop(vm, o);
+	if (i)
 		return 0;
 	for (i = 0; i < o->lv; ++i) {
-		if (update[i]->fwd[i] != x) break;
-		update[i]->fwd[i] = x->fwd[i];
+		int *span = sknd_span(update[i]);
+		if (update[i]->fwd[i] == x) {
+			span[i] += sknd_span(x)[i] - 1;
+			update[i]->fwd[i] = x->fwd[i];
+		} else {
+			--span[i];
+		}
 	}
-	mm_free(vm, x, 1, sizeof(struct sknd) +
-			(x->n - 1) * sizeof(struct sknd *));
+	if (x->fwd[0])
+		x->fwd[0]->bwd = x->bwd;
+	else
+		o->tail = x->bwd;
+	mm_free(vm, x, 1, node_size(o, x->n));
+	--o->count;
+	++o->version;
 	while (o->lv > 0 && o->head->fwd[o->lv - 1] == NULL)
 		--o->lv;
 	return 1;
 }
 
+void skls_load_begin(struct skls_loader *ld, struct skls *o) {
+	struct sknd *x = o->head;
+	int i, r = 0;
+	ld->o = o;
+	ld->sorted = 1;
+	for (i = o->lv - 1; i >= 0; --i) {
+		while (x->fwd[i]) {
+			r += sknd_span(x)[i];
+			x = x->fwd[i];
+		}
+		ld->last[i] = x;
+		ld->rank[i] = r;
+	}
+}
+
+struct variable *skls_load(struct ymd_mach *vm, struct skls_loader *ld,
+		const struct variable *k) {
+	struct skls *o = ld->o;
+	struct variable key = *k;
+	const struct variable *ok;
+	struct sknd *x;
+	ymd_int_t rv = 1;
+	int i;
+	assert(!is_nil(k));
+	if (!ld->sorted)
+		return skls_put(vm, o, &key);
+	ok = ordkey_push(vm, o, &key);
+	if (o->tail && (rv = order_compare(vm, o, ordk(o, o->tail), ok)) >= 0) {
+		struct variable *v;
+		if (rv == 0) { // Same as the last one
+			ordkey_pop(vm, o);
+			o->tail->k = key;
+			return &o->tail->v;
+		}
+		ld->sorted = 0;
+		v = put_ordkey(vm, o, &key, ok);
+		ordkey_pop(vm, o);
+		return v;
+	}
+	// The last nodes are just the update path of the tail.
+	x = append(vm, o, ld->last, ld->rank);
+	for (i = 0; i < x->n; ++i) {
+		ld->last[i] = x;
+		ld->rank[i] = o->count;
+	}
+	++o->version;
+	if (o->key)
+		*sknd_okey(x) = *ok;
+	ordkey_pop(vm, o);
+	x->k = key;
+	return &x->v;
+}
+
 // >=
 struct sknd *skls_direct(struct ymd_mach *vm, const struct skls *o,
 		const struct variable *k) {
 	struct sknd *x = o->head;
 	int i;
+	k = ordkey_push(vm, o, k);
 	for (i = o->lv - 1; i >= 0; --i) {
-		while (x->fwd[i] && skls_key_compare(vm, o, &x->fwd[i]->k, k) < 0) {
+		while (x->fwd[i] && order_compare(vm, o, ordk(o, x->fwd[i]), k) < 0) {
+			x = x->fwd[i];
+		}
+	}
+	ordkey_pop(vm, o);
+	return x->fwd[0];
+}
+
+
+int skls_rank(struct ymd_mach *vm, const struct skls *o,
+		const struct variable *k) {
+	struct sknd *x = o->head;
+	int i, r = 0;
+	k = ordkey_push(vm, o, k);
+	for (i = o->lv - 1; i >= 0; --i) {
+		while (x->fwd[i] && order_compare(vm, o, ordk(o, x->fwd[i]), k) < 0) {
+			r += sknd_span(x)[i];
 			x = x->fwd[i];
 		}
 	}
 	x = x->fwd[0];
-	return x;
+	if (!x || order_compare(vm, o, ordk(o, x), k) != 0)
+		r = -1;
+	ordkey_pop(vm, o);
+	return r;
 }
 
+struct sknd *skls_nth(const struct skls *o, int i) {
+	struct sknd *x = o->head;
+	int j, r = 0;
+	if (i < 0 || i >= o->count)
+		return NULL;
+	++i; // The head's rank is 0, so the first node is 1.
+	for (j = o->lv - 1; j >= 0; --j) {
+		while (x->fwd[j] && r + sknd_span(x)[j] <= i) {
+			r += sknd_span(x)[j];
+			x = x->fwd[j];
+		}
+		if (r == i)
+			return x;
+	}
+	assert (!"No reached.");
+	return NULL;
+}
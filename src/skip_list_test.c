@@ -31,7 +31,7 @@ static int test_skls_creation_1 (struct ymd_mach *vm) {
 	rv = skls_get(vm, ls, &k2);
 	ASSERT_NOTNULL(rv);
 	ASSERT_EQ(int, ymd_type(rv), T_INT);
-	ASSERT_EQ(large, rv->u.i, 1024LL);
+	ASSERT_EQ(large, var_int(rv), 1024LL);
 	return 0;
 }
 
@@ -66,7 +66,7 @@ static int test_skls_sequence (struct ymd_mach *vm) {
 	ASSERT_NOTNULL(x);
 	i = 0;
 	while ((x = x->fwd[0]) != NULL)
-		ASSERT_EQ(large, x->k.u.i, i++);
+		ASSERT_EQ(large, var_int(&x->k), i++);
 	EXPECT_EQ(int, i, BENCHMARK_COUNT);
 	return 0;
 }
@@ -154,8 +154,8 @@ static int test_skls_search_1 (struct ymd_mach *vm) {
 			snprintf(buf, sizeof(buf), "%u", index);
 			setv_kstr(&k, kstr_fetch(vm, buf, -1));
 			rv = skls_get(vm, list, &k);
-			ASSERT_EQ(int, rv->tt, T_INT);
-			ASSERT_EQ(large, rv->u.i, index);
+			ASSERT_EQ(int, var_tt(rv), T_INT);
+			ASSERT_EQ(large, var_int(rv), index);
 		}
 		TIME_RECORD_END
 	RAND_END
@@ -176,7 +176,7 @@ static int test_skls_search_2 (struct ymd_mach *vm) {
 		int j = 16;
 		while (j--) {
 			setv_int(&k, j);
-			ASSERT_EQ(large, skls_get(vm, map, &k)->u.i, j);
+			ASSERT_EQ(large, var_int(skls_get(vm, map, &k)), j);
 		}
 	}
 	TIME_RECORD_END
@@ -205,12 +205,12 @@ static int test_skls_removing (struct ymd_mach *vm) {
 
 	setv_int(&k, 1024);
 	setv_int(skls_put(vm, map, &k), 1000);
-	ASSERT_EQ(int,  skls_get(vm, map, &k)->tt, T_INT);
-	ASSERT_EQ(large, skls_get(vm, map, &k)->u.i,  1000LL);
+	ASSERT_EQ(int,  var_tt(skls_get(vm, map, &k)), T_INT);
+	ASSERT_EQ(large, var_int(skls_get(vm, map, &k)),  1000LL);
 	setv_int(&k, 14);
 	setv_int(skls_put(vm, map, &k), 10);
-	ASSERT_EQ(int,  skls_get(vm, map, &k)->tt, T_INT);
-	ASSERT_EQ(large, skls_get(vm, map, &k)->u.i,  10LL);
+	ASSERT_EQ(int,  var_tt(skls_get(vm, map, &k)), T_INT);
+	ASSERT_EQ(large, var_int(skls_get(vm, map, &k)),  10LL);
 	setv_int(&k, 4);
 	ASSERT_FALSE(skls_remove(vm, map, &k));
 	return 0;
@@ -227,11 +227,11 @@ static int test_skls_direct_by_asc (struct ymd_mach *vm) {
 	}
 	setv_int(&k, 3); i = 3;
 	for (p = skls_direct(vm, map, &k); p != NULL; p = p->fwd[0]) {
-		ASSERT_EQ(large, num[i++], p->k.u.i);
+		ASSERT_EQ(large, num[i++], var_int(&p->k));
 	}
 	setv_int(&k, 6); i = 6;
 	for (p = skls_direct(vm, map, &k); p != NULL; p = p->fwd[0]) {
-		ASSERT_EQ(large, num[i++], p->k.u.i);
+		ASSERT_EQ(large, num[i++], var_int(&p->k));
 	}
 	setv_int(&k, 101);
 	ASSERT_NULL(skls_direct(vm, map, &k));
@@ -251,8 +251,84 @@ static int test_skls_direct_by_dasc (struct ymd_mach *vm) {
 	e = skls_direct(vm, map, &k);
 	setv_int(&k, 7); i = 0;
 	for (p = skls_direct(vm, map, &k); p != e; p = p->fwd[0]) {
-		ASSERT_EQ(large, exp[i++], p->k.u.i);
+		ASSERT_EQ(large, exp[i++], var_int(&p->k));
 	}
 	return 0;
 }
 
+
+static int test_skls_rank (struct ymd_mach *vm) {
+	struct skls *ls = skls_new(vm, SKLS_ASC);
+	struct variable k;
+	struct sknd *x;
+	int i, r;
+	// Even keys in [0, 2000), then remove every 4th of them.
+	for (i = 999; i >= 0; --i) {
+		setv_int(&k, i * 2);
+		setv_int(skls_put(vm, ls, &k), i);
+	}
+	for (i = 0; i < 2000; i += 8) {
+		setv_int(&k, i);
+		ASSERT_TRUE(skls_remove(vm, ls, &k));
+	}
+	setv_int(&k, 1);
+	ASSERT_FALSE(skls_remove(vm, ls, &k));
+	setv_int(&k, 4000);
+	ASSERT_FALSE(skls_remove(vm, ls, &k));
+	ASSERT_EQ(int, ls->count, 750);
+	// Rank and nth must agree with level 0 walking.
+	for (r = 0, x = ls->head->fwd[0]; x != NULL; x = x->fwd[0], ++r) {
+		ASSERT_TRUE(skls_nth(ls, r) == x);
+		ASSERT_EQ(int, skls_rank(vm, ls, &x->k), r);
+	}
+	ASSERT_EQ(int, r, 750);
+	// Backward links are the reverse of level 0.
+	for (r = 749, x = ls->tail; x != NULL; x = x->bwd, --r)
+		ASSERT_TRUE(skls_nth(ls, r) == x);
+	ASSERT_EQ(int, r, -1);
+	ASSERT_NULL(skls_nth(ls, 750));
+	ASSERT_NULL(skls_nth(ls, -1));
+	setv_int(&k, 8);
+	ASSERT_EQ(int, skls_rank(vm, ls, &k), -1);
+	setv_int(&k, 3);
+	ASSERT_EQ(int, skls_rank(vm, ls, &k), -1);
+	return 0;
+}
+
+static int test_skls_load(struct ymd_mach *vm) {
+	struct skls *ls = skls_new(vm, SKLS_ASC);
+	struct skls_loader ld;
+	struct sknd *x;
+	struct variable k;
+	int i, r;
+	skls_load_begin(&ld, ls);
+	for (i = 0; i < 1000; ++i) {
+		setv_int(&k, i * 2);
+		setv_int(skls_load(vm, &ld, &k), i);
+	}
+	ASSERT_TRUE(ld.sorted);
+	setv_int(&k, 1998); // Same as the last one
+	setv_int(skls_load(vm, &ld, &k), -1);
+	ASSERT_TRUE(ld.sorted);
+	ASSERT_EQ(int, ls->count, 1000);
+	setv_int(&k, 501); // Out of order, fall back
+	setv_int(skls_load(vm, &ld, &k), 501);
+	ASSERT_FALSE(ld.sorted);
+	setv_int(&k, 5000);
+	setv_int(skls_load(vm, &ld, &k), 5000);
+	ASSERT_EQ(int, ls->count, 1002);
+	// Spans and backward links must be same as putting one by one.
+	for (r = 0, x = ls->head->fwd[0]; x != NULL; x = x->fwd[0], ++r) {
+		ASSERT_TRUE(skls_nth(ls, r) == x);
+		ASSERT_EQ(int, skls_rank(vm, ls, &x->k), r);
+		if (x->bwd)
+			ASSERT_TRUE(compare(&x->bwd->k, &x->k) < 0);
+	}
+	ASSERT_EQ(int, r, 1002);
+	ASSERT_EQ(large, var_int(&ls->tail->k), 5000);
+	setv_int(&k, 1998);
+	ASSERT_EQ(large, var_int(skls_get(vm, ls, &k)), -1);
+	setv_int(&k, 501);
+	ASSERT_EQ(int, skls_rank(vm, ls, &k), 251);
+	return 0;
+}
@@ -0,0 +1,516 @@
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+//------------------------------------------------------------------
+// Sorting and selecting:
+// -----------------------------------------------------------------
+// Pattern-defeating quicksort for `sort', and merge sort for the stable
+// ones. Elements only move by swapping or into a buffer which is a rooted
+// array, so a comparing function can run the GC at any time. Without
+// comparing function, elements are ordered as `<' does: vm_compare().
+#define INSERTION_SORT 24 // Small partitions
+#define NINTHER 128 // Large partitions take pivot by Tukey's ninther
+#define PARTIAL_INSERTION 8 // Max moves of partial insertion sort
+
+struct sorter {
+	struct ymd_mach *vm;
+	struct func *cmp; // Comparing function or NULL
+	struct dyay *o; // Sorting array, it must be not changed by `cmp'
+	struct variable *elem;
+};
+
+// A decorated element for sorting by key.
+struct sort_pair {
+	struct variable k;
+	struct variable v;
+};
+
+static int call_less(struct sorter *s, const struct variable *lhs,
+		const struct variable *rhs) {
+	struct ymd_context *l = ioslate(s->vm);
+	ymd_int_t rv;
+	setv_func(ymd_push(l), s->cmp);
+	*ymd_push(l) = *lhs;
+	*ymd_push(l) = *rhs;
+	if (!ymd_call(l, s->cmp, 2, 0))
+		ymd_panic(l, "sort() Bad comparing function");
+	rv = int4of(l, ymd_top(l, 0));
+	ymd_pop(l, 1);
+	if (s->o->elem != s->elem)
+		ymd_panic(l, "Array has been modified in sorting");
+	return rv < 0;
+}
+
+#define LESS_INT(s, a, b)   (var_int(a) < var_int(b))
+#define LESS_FLOAT(s, a, b) (var_float(a) < var_float(b))
+#define LESS_KSTR(s, a, b)  (kstr_compare(kstr_k(a), kstr_k(b)) < 0)
+#define LESS_ANY(s, a, b)   (vm_compare(a, b) < 0)
+#define LESS_USER(s, a, b)  call_less(s, a, b)
+
+#define LESS_PAIR_INT(s, a, b)   LESS_INT(s, &(a)->k, &(b)->k)
+#define LESS_PAIR_FLOAT(s, a, b) LESS_FLOAT(s, &(a)->k, &(b)->k)
+#define LESS_PAIR_KSTR(s, a, b)  LESS_KSTR(s, &(a)->k, &(b)->k)
+#define LESS_PAIR_ANY(s, a, b)   LESS_ANY(s, &(a)->k, &(b)->k)
+
+#define SWAP(T, a, b) do { T __t = *(a); *(a) = *(b); *(b) = __t; } while (0)
+
+#define DEFINE_INSERTION(name, T, LESS) \
+static void name##_insertion(struct sorter *s, T *a, int n) { \
+	int i, j; \
+	(void)s; \
+	for (i = 1; i < n; ++i) \
+		for (j = i; j > 0 && LESS(s, a + j, a + j - 1); --j) \
+			SWAP(T, a + j, a + j - 1); \
+}
+
+// pdqsort: https://github.com/orlp/pdqsort
+// All loops are guarded, an inconsistent comparing function only makes a
+// bad order but never goes out of range.
+#define DEFINE_PDQSORT(name, T, LESS) \
+DEFINE_INSERTION(name, T, LESS) \
+static int name##_partial_insertion(struct sorter *s, T *a, int n) { \
+	int i, j, moves = 0; \
+	(void)s; \
+	for (i = 1; i < n; ++i) { \
+		for (j = i; j > 0 && LESS(s, a + j, a + j - 1); --j) \
+			SWAP(T, a + j, a + j - 1); \
+		if ((moves += i - j) > PARTIAL_INSERTION) \
+			return 0; \
+	} \
+	return 1; \
+} \
+static void name##_sort3(struct sorter *s, T *a, T *b, T *c) { \
+	(void)s; \
+	if (LESS(s, b, a)) SWAP(T, a, b); \
+	if (LESS(s, c, b)) SWAP(T, b, c); \
+	if (LESS(s, b, a)) SWAP(T, a, b); \
+} \
+static void name##_sift(struct sorter *s, T *a, int i, int n) { \
+	int k; \
+	(void)s; \
+	while ((k = i * 2 + 1) < n) { \
+		if (k + 1 < n && LESS(s, a + k, a + k + 1)) \
+			++k; \
+		if (!LESS(s, a + i, a + k)) \
+			break; \
+		SWAP(T, a + i, a + k); \
+		i = k; \
+	} \
+} \
+static void name##_heapsort(struct sorter *s, T *a, int n) { \
+	int i; \
+	for (i = n / 2 - 1; i >= 0; --i) \
+		name##_sift(s, a, i, n); \
+	for (i = n - 1; i > 0; --i) { \
+		SWAP(T, a, a + i); \
+		name##_sift(s, a, 0, i); \
+	} \
+} \
+/* Pivot is a[0]: [0, pos) < pivot <= (pos, n) */ \
+static int name##_partition_right(struct sorter *s, T *a, int n, int *done) { \
+	int first = 1, last = n - 1; \
+	(void)s; \
+	while (first <= last && LESS(s, a + first, a)) ++first; \
+	while (first <= last && !LESS(s, a + last, a)) --last; \
+	*done = first > last; \
+	while (first < last) { \
+		SWAP(T, a + first, a + last); \
+		++first; --last; \
+		while (first <= last && LESS(s, a + first, a)) ++first; \
+		while (first <= last && !LESS(s, a + last, a)) --last; \
+	} \
+	SWAP(T, a, a + last); \
+	return last; \
+} \
+/* Pivot is a[0]: [0, pos) <= pivot < (pos, n) */ \
+static int name##_partition_left(struct sorter *s, T *a, int n) { \
+	int first = 1, last = n - 1; \
+	(void)s; \
+	while (first <= last && !LESS(s, a, a + first)) ++first; \
+	while (first <= last && LESS(s, a, a + last)) --last; \
+	while (first < last) { \
+		SWAP(T, a + first, a + last); \
+		++first; --last; \
+		while (first <= last && !LESS(s, a, a + first)) ++first; \
+		while (first <= last && LESS(s, a, a + last)) --last; \
+	} \
+	SWAP(T, a, a + last); \
+	return last; \
+} \
+static void name##_loop(struct sorter *s, T *a, int n, int bad, \
+                        int leftmost) { \
+	while (n >= INSERTION_SORT) { \
+		int pos, rn, done, half = n / 2; \
+		if (n > NINTHER) { \
+			name##_sort3(s, a, a + half, a + n - 1); \
+			name##_sort3(s, a + 1, a + half - 1, a + n - 2); \
+			name##_sort3(s, a + 2, a + half + 1, a + n - 3); \
+			name##_sort3(s, a + half - 1, a + half, a + half + 1); \
+			SWAP(T, a, a + half); \
+		} else { \
+			name##_sort3(s, a + half, a, a + n - 1); \
+		} \
+		/* Pivot equals its predecessor: put the equal ones left. */ \
+		if (!leftmost && !LESS(s, a - 1, a)) { \
+			pos = name##_partition_left(s, a, n); \
+			a += pos + 1; \
+			n -= pos + 1; \
+			continue; \
+		} \
+		pos = name##_partition_right(s, a, n, &done); \
+		rn = n - pos - 1; \
+		if (pos < n / 8 || rn < n / 8) { \
+			/* Bad partition, break patterns or give up to heap sort */ \
+			if (--bad == 0) { \
+				name##_heapsort(s, a, n); \
+				return; \
+			} \
+			if (pos >= INSERTION_SORT) { \
+				SWAP(T, a, a + pos / 4); \
+				SWAP(T, a + pos - 1, a + pos - pos / 4); \
+			} \
+			if (rn >= INSERTION_SORT) { \
+				SWAP(T, a + pos + 1, a + pos + 1 + rn / 4); \
+				SWAP(T, a + n - 1, a + n - rn / 4); \
+			} \
+		} else if (done && name##_partial_insertion(s, a, pos) && \
+		           name##_partial_insertion(s, a + pos + 1, rn)) { \
+			return; \
+		} \
+		name##_loop(s, a, pos, bad, leftmost); \
+		a += pos + 1; \
+		n = rn; \
+		leftmost = 0; \
+	} \
+	name##_insertion(s, a, n); \
+} \
+static void name##_pdqsort(struct sorter *s, T *a, int n) { \
+	int bad = 0; \
+	while ((1 << bad) < n) ++bad; \
+	name##_loop(s, a, n, bad + 1, 1); \
+}
+
+// Top-down merge sort, `buf' has `n / 2' elements at least.
+#define DEFINE_MERGESORT(name, T, LESS) \
+DEFINE_INSERTION(name##_m, T, LESS) \
+static void name##_mergesort(struct sorter *s, T *a, int n, T *buf) { \
+	int i, j, k, half = n / 2; \
+	if (n < INSERTION_SORT) { \
+		name##_m_insertion(s, a, n); \
+		return; \
+	} \
+	name##_mergesort(s, a, half, buf); \
+	name##_mergesort(s, a + half, n - half, buf); \
+	if (!LESS(s, a + half, a + half - 1)) \
+		return; /* Already in order */ \
+	memcpy(buf, a, half * sizeof(T)); \
+	i = 0; j = half; k = 0; \
+	while (i < half && j < n) { \
+		if (LESS(s, a + j, buf + i)) \
+			a[k++] = a[j++]; \
+		else \
+			a[k++] = buf[i++]; \
+	} \
+	while (i < half) \
+		a[k++] = buf[i++]; \
+}
+
+// Selecting by the pdqsort's partitioning, `_topk' keeps the `k' greatest
+// ones in a min-heap.
+#define DEFINE_SELECT(name, T, LESS) \
+static void name##_siftr(struct sorter *s, T *a, int i, int n) { \
+	int k; \
+	(void)s; \
+	while ((k = i * 2 + 1) < n) { \
+		if (k + 1 < n && LESS(s, a + k + 1, a + k)) \
+			++k; \
+		if (!LESS(s, a + k, a + i)) \
+			break; \
+		SWAP(T, a + i, a + k); \
+		i = k; \
+	} \
+} \
+static void name##_topk(struct sorter *s, const T *src, int n, T *heap, \
+                        int k) { \
+	int i; \
+	for (i = 0; i < k; ++i) \
+		heap[i] = src[i]; \
+	for (i = k / 2 - 1; i >= 0; --i) \
+		name##_siftr(s, heap, i, k); \
+	for (i = k; i < n; ++i) { \
+		if (LESS(s, heap, src + i)) { \
+			heap[0] = src[i]; \
+			name##_siftr(s, heap, 0, k); \
+		} \
+	} \
+	/* Pop the least ones to the end: descending order */ \
+	for (i = k - 1; i > 0; --i) { \
+		SWAP(T, heap, heap + i); \
+		name##_siftr(s, heap, 0, i); \
+	} \
+} \
+static void name##_select(struct sorter *s, T *a, int n, int nth) { \
+	int bad = 0; \
+	while ((1 << bad) < n) ++bad; \
+	bad *= 2; \
+	while (n >= INSERTION_SORT) { \
+		int pos, done, half = n / 2; \
+		if (n > NINTHER) { \
+			name##_sort3(s, a, a + half, a + n - 1); \
+			name##_sort3(s, a + 1, a + half - 1, a + n - 2); \
+			name##_sort3(s, a + 2, a + half + 1, a + n - 3); \
+			name##_sort3(s, a + half - 1, a + half, a + half + 1); \
+			SWAP(T, a, a + half); \
+		} else { \
+			name##_sort3(s, a + half, a, a + n - 1); \
+		} \
+		pos = name##_partition_right(s, a, n, &done); \
+		if (pos == 0) { \
+			/* No one is less than pivot: [0, pos] equal the pivot. */ \
+			pos = name##_partition_left(s, a, n); \
+			if (nth <= pos) \
+				return; \
+		} \
+		if (pos == nth) \
+			return; \
+		if ((pos < n / 8 || n - pos - 1 < n / 8) && --bad == 0) { \
+			name##_heapsort(s, a, n); \
+			return; \
+		} \
+		if (nth < pos) { \
+			n = pos; \
+		} else { \
+			a += pos + 1; \
+			n -= pos + 1; \
+			nth -= pos + 1; \
+		} \
+	} \
+	name##_insertion(s, a, n); \
+}
+
+DEFINE_PDQSORT(int, struct variable, LESS_INT)
+DEFINE_PDQSORT(float, struct variable, LESS_FLOAT)
+DEFINE_PDQSORT(kstr, struct variable, LESS_KSTR)
+DEFINE_PDQSORT(any, struct variable, LESS_ANY)
+DEFINE_PDQSORT(user, struct variable, LESS_USER)
+
+DEFINE_SELECT(int, struct variable, LESS_INT)
+DEFINE_SELECT(float, struct variable, LESS_FLOAT)
+DEFINE_SELECT(kstr, struct variable, LESS_KSTR)
+DEFINE_SELECT(any, struct variable, LESS_ANY)
+DEFINE_SELECT(user, struct variable, LESS_USER)
+
+DEFINE_MERGESORT(int, struct variable, LESS_INT)
+DEFINE_MERGESORT(float, struct variable, LESS_FLOAT)
+DEFINE_MERGESORT(kstr, struct variable, LESS_KSTR)
+DEFINE_MERGESORT(any, struct variable, LESS_ANY)
+DEFINE_MERGESORT(user, struct variable, LESS_USER)
+
+DEFINE_MERGESORT(pair_int, struct sort_pair, LESS_PAIR_INT)
+DEFINE_MERGESORT(pair_float, struct sort_pair, LESS_PAIR_FLOAT)
+DEFINE_MERGESORT(pair_kstr, struct sort_pair, LESS_PAIR_KSTR)
+DEFINE_MERGESORT(pair_any, struct sort_pair, LESS_PAIR_ANY)
+
+// Same type of all elements: T_INT, T_FLOAT, T_KSTR, or T_NIL for mixed
+// ones.
+static int same_type(const struct variable *a, int n, int step) {
+	unsigned tt = n > 0 ? ymd_type(a) : T_NIL;
+	int i;
+	if (tt != T_INT && tt != T_FLOAT && tt != T_KSTR)
+		return T_NIL;
+	for (i = step; i < n * step; i += step)
+		if (ymd_type(a + i) != tt)
+			return T_NIL;
+	return (int)tt;
+}
+
+// Buffer of merge sort: an array in the stack, so that elements moved to
+// it are still marked.
+static struct variable *sort_buffer(struct ymd_mach *vm, int n) {
+	struct dyay *buf = dyay_new(vm, n > 0 ? n : 1);
+	buf->count = n;
+	setv_dyay(ymd_push(ioslate(vm)), buf);
+	return buf->elem;
+}
+
+static YMD_INLINE void sorter_init(struct sorter *s, struct ymd_mach *vm,
+		struct dyay *o, struct func *cmp) {
+	s->vm = vm;
+	s->cmp = cmp;
+	s->o = o;
+	s->elem = o->elem;
+}
+
+void dyay_sort(struct ymd_mach *vm, struct dyay *o, struct func *cmp,
+		int stable) {
+	struct sorter s;
+	struct variable *a, *buf = NULL;
+	int n = o->count;
+	if (n < 2)
+		return;
+	dyay_own(vm, o);
+	++o->version;
+	a = o->elem;
+	sorter_init(&s, vm, o, cmp);
+	if (stable)
+		buf = sort_buffer(vm, n / 2);
+#define SORT(name) \
+	if (stable) \
+		name##_mergesort(&s, a, n, buf); \
+	else \
+		name##_pdqsort(&s, a, n)
+	switch (cmp ? -1 : same_type(a, n, 1)) {
+	case T_INT:
+		SORT(int);
+		break;
+	case T_FLOAT:
+		SORT(float);
+		break;
+	case T_KSTR:
+		SORT(kstr);
+		break;
+	case T_NIL:
+		SORT(any);
+		break;
+	default:
+		SORT(user);
+		break;
+	}
+#undef SORT
+	if (stable)
+		ymd_pop(ioslate(vm), 1);
+}
+
+void dyay_sort_by(struct ymd_mach *vm, struct dyay *o, struct func *key) {
+	struct ymd_context *l = ioslate(vm);
+	struct sorter s;
+	struct sort_pair *a, *buf;
+	struct dyay *tmp;
+	int i, n = o->count;
+	if (n < 2)
+		return;
+	// Decorate: key(elem) and elem pairs, in a rooted array.
+	tmp = dyay_new(vm, n * 2);
+	tmp->count = n * 2;
+	setv_dyay(ymd_push(l), tmp);
+	for (i = 0; i < n; ++i) {
+		if (o->count != n)
+			ymd_panic(l, "Array has been modified in sorting");
+		tmp->elem[i * 2 + 1] = o->elem[i];
+		setv_func(ymd_push(l), key);
+		*ymd_push(l) = o->elem[i];
+		if (!ymd_call(l, key, 1, 0))
+			ymd_panic(l, "sort_by() Bad key function");
+		tmp->elem[i * 2] = *ymd_top(l, 0);
+		ymd_pop(l, 1);
+	}
+	if (o->count != n)
+		ymd_panic(l, "Array has been modified in sorting");
+	buf = (struct sort_pair *)sort_buffer(vm, (n / 2) * 2);
+	a = (struct sort_pair *)tmp->elem;
+	sorter_init(&s, vm, tmp, NULL);
+	switch (same_type(tmp->elem, n, 2)) {
+	case T_INT:
+		pair_int_mergesort(&s, a, n, buf);
+		break;
+	case T_FLOAT:
+		pair_float_mergesort(&s, a, n, buf);
+		break;
+	case T_KSTR:
+		pair_kstr_mergesort(&s, a, n, buf);
+		break;
+	default:
+		pair_any_mergesort(&s, a, n, buf);
+		break;
+	}
+	// Undecorate
+	dyay_own(vm, o);
+	++o->version;
+	for (i = 0; i < n; ++i)
+		o->elem[i] = a[i].v;
+	ymd_pop(l, 2);
+}
+
+int dyay_topk(struct ymd_mach *vm, struct dyay *o, struct func *cmp,
+		struct variable *top, int k) {
+	struct sorter s;
+	int n = o->count;
+	if (k > n)
+		k = n;
+	if (k <= 0)
+		return 0;
+	sorter_init(&s, vm, o, cmp);
+	switch (cmp ? -1 : same_type(o->elem, n, 1)) {
+	case T_INT:
+		int_topk(&s, o->elem, n, top, k);
+		break;
+	case T_FLOAT:
+		float_topk(&s, o->elem, n, top, k);
+		break;
+	case T_KSTR:
+		kstr_topk(&s, o->elem, n, top, k);
+		break;
+	case T_NIL:
+		any_topk(&s, o->elem, n, top, k);
+		break;
+	default:
+		user_topk(&s, o->elem, n, top, k);
+		break;
+	}
+	return k;
+}
+
+struct variable *dyay_select(struct ymd_mach *vm, struct dyay *o,
+		struct func *cmp, int i) {
+	struct sorter s;
+	int n = o->count;
+	assert (i >= 0 && i < n);
+	dyay_own(vm, o);
+	++o->version;
+	sorter_init(&s, vm, o, cmp);
+	switch (cmp ? -1 : same_type(o->elem, n, 1)) {
+	case T_INT:
+		int_select(&s, o->elem, n, i);
+		break;
+	case T_FLOAT:
+		float_select(&s, o->elem, n, i);
+		break;
+	case T_KSTR:
+		kstr_select(&s, o->elem, n, i);
+		break;
+	case T_NIL:
+		any_select(&s, o->elem, n, i);
+		break;
+	default:
+		user_select(&s, o->elem, n, i);
+		break;
+	}
+	return o->elem + i;
+}
+
+int dyay_bound(struct ymd_mach *vm, struct dyay *o, struct func *cmp,
+		const struct variable *k, int upper) {
+	struct sorter s;
+	struct variable key = *k; // `k' may be in the stack
+	int lo = 0, hi = o->count;
+	sorter_init(&s, vm, o, cmp);
+	while (lo < hi) {
+		int mid = (lo + hi) >> 1, rv;
+		if (s.elem != o->elem || hi > o->count)
+			ymd_panic(ioslate(vm), "Array has been modified in searching");
+		// lower: first elem >= key, upper: first elem > key
+		if (upper)
+			rv = !(cmp ? call_less(&s, &key, o->elem + mid) :
+			       LESS_ANY(&s, &key, o->elem + mid));
+		else
+			rv = cmp ? call_less(&s, o->elem + mid, &key) :
+			     LESS_ANY(&s, o->elem + mid, &key);
+		if (rv)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
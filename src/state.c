@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
 #include <assert.h>
 
 #define MAX_MSG_LEN 1024
@@ -114,8 +116,8 @@ int vm_loaded(struct ymd_mach *vm, const char *name) {
 		setv_int(vm_def(vm, lib, name), 0);
 		return 0;
 	}
-	++count->u.i;
-	return count->u.i;
+	setv_int(count, var_int(count) + 1);
+	return var_int(count);
 }
 
 int vm_bool(const struct variable *lhs) {
@@ -123,7 +125,7 @@ int vm_bool(const struct variable *lhs) {
 	case T_NIL:
 		return 0;
 	case T_BOOL:
-		return lhs->u.i;
+		return var_int(lhs);
 	default:
 		break;
 	}
@@ -136,6 +138,15 @@ void vm_pcre_lazy(struct ymd_mach *vm) {
 	vm->pcre_js = pcre_jit_stack_alloc(YMD_JS_START, YMD_JS_MAX);
 	assert (vm->pcre_js);
 }
+static struct variable *dequ_at(struct ymd_mach *vm, struct dequ *o,
+                                const struct variable *key) {
+	ymd_int_t i = int_of(ioslate(vm), key);
+	if (i < 0 || i >= o->count)
+		ymd_panic(ioslate(vm), "Deque out of range, index:%lld, count:%d",
+		          i, o->count);
+	return dequ_get(o, (int)i);
+}
+
 //------------------------------------------------------------------------
 // Generic mapping functions:
 // -----------------------------------------------------------------------
@@ -148,14 +159,20 @@ struct variable *vm_put(struct ymd_mach *vm,
 	switch (ymd_type(var)) {
 	case T_SKLS:
 		return skls_put(vm, skls_x(var), key);
+	case T_BTRE:
+		return btre_put(vm, btre_x(var), key);
 	case T_HMAP:
 		return hmap_put(vm, hmap_x(var), key);
 	case T_DYAY:
-		return dyay_get(dyay_x(var), int4of(l, key));
+		return dyay_get(dyay_own(vm, dyay_x(var)), int4of(l, key));
+	case T_DEQU:
+		return dequ_at(vm, dequ_x(var), key);
 	case T_MAND:
 		if (!mand_x(var)->proto)
 			ymd_panic(l, "Management memory has no metatable yet");
 		return mand_put(vm, mand_x(var), key);
+	case T_LRUC: // Only for `c.k += x', the pair must be in cache.
+		return lruc_get(lruc_x(var), key);
 	default:
 		ymd_panic(l, "Variable can not be put");
 		break;
@@ -171,6 +188,21 @@ static struct variable *vm_at(struct ymd_mach *vm, struct dyay *arr,
 	return dyay_get(arr, i);
 }
 
+static int pkay_at(struct ymd_mach *vm, struct pkay *o,
+                   const struct variable *key) {
+	ymd_int_t i = int_of(ioslate(vm), key);
+	if (i < 0 || i >= o->count)
+		ymd_panic(ioslate(vm), "Packed array out of range, index:%lld, "
+		          "count:%d", i, o->count);
+	return (int)i;
+}
+
+void vm_pkay_set(struct ymd_mach *vm, struct variable *var,
+                 const struct variable *key, const struct variable *v) {
+	struct pkay *o = pkay_x(var);
+	pkay_set(vm, o, pkay_at(vm, o, key), v);
+}
+
 struct variable *vm_get(struct ymd_mach *vm, struct variable *var,
                         const struct variable *key) {
 	struct ymd_context *l = ioslate(vm);
@@ -179,10 +211,25 @@ struct variable *vm_get(struct ymd_mach *vm, struct variable *var,
 	switch (ymd_type(var)) {
 	case T_SKLS:
 		return skls_get(vm, skls_x(var), key);
+	case T_BTRE:
+		return btre_get(vm, btre_x(var), key);
 	case T_HMAP:
 		return hmap_get(hmap_x(var), key);
 	case T_DYAY:
 		return vm_at(vm, dyay_x(var), int_of(l, key));
+	case T_PKAY: {
+		struct pkay *o = pkay_x(var);
+		return pkay_get(o, pkay_at(vm, o, key), &vm->kpk);
+		}
+	case T_DEQU:
+		return dequ_at(vm, dequ_x(var), key);
+	case T_HSET: // s[k] is true if `k' is in set `s', otherwise nil.
+		if (!hset_get(hset_x(var), key))
+			return knil;
+		setv_bool(&vm->kpk, 1);
+		return &vm->kpk;
+	case T_LRUC: // Getting makes it the most recently used one.
+		return lruc_get(lruc_x(var), key);
 	case T_MAND:
 		if (!mand_x(var)->proto)
 			ymd_panic(l, "Management memory has no metatable yet");
@@ -205,6 +252,12 @@ int vm_remove(struct ymd_mach *vm, struct variable *var,
 		return hmap_remove(vm, hmap_x(var), key);
 	case T_SKLS:
 		return skls_remove(vm, skls_x(var), key);
+	case T_BTRE:
+		return btre_remove(vm, btre_x(var), key);
+	case T_HSET:
+		return hset_remove(vm, hset_x(var), key);
+	case T_LRUC:
+		return lruc_remove(vm, lruc_x(var), key);
 	case T_MAND:
 		return mand_remove(vm, mand_x(var), key);
 	}
@@ -212,15 +265,18 @@ int vm_remove(struct ymd_mach *vm, struct variable *var,
 	return 0;
 }
 
-struct kstr *vm_strcat(struct ymd_mach *vm, const struct kstr *lhs,
-                       const struct kstr *rhs) {
-	char *tmp = vm_zalloc(vm, lhs->len + rhs->len);
-	struct kstr *x;
-	memcpy(tmp, lhs->land, lhs->len);
-	memcpy(tmp + lhs->len, rhs->land, rhs->len);
-	x = kstr_fetch(vm, tmp, lhs->len + rhs->len);
-	vm_free(vm, tmp);
-	return x;
+struct kstr *vm_strcat(struct ymd_mach *vm, struct variable *argv, int n) {
+	int i;
+	for (i = 0; i < n; ++i) {
+		struct zostream os;
+		if (ymd_type(argv + i) == T_KSTR)
+			continue;
+		zos_init(&os);
+		tostring(&os, argv + i);
+		setv_kstr(argv + i, kstr_fetch(vm, zos_buf(&os), os.last));
+		zos_final(&os);
+	}
+	return kstr_concat(vm, argv, n);
 }
 
 struct variable *vm_def(struct ymd_mach *vm, void *o, const char *field) {
@@ -234,6 +290,10 @@ struct variable *vm_def(struct ymd_mach *vm, void *o, const char *field) {
 		setv_kstr(&k, kstr_fetch(vm, field, -1));
 		v = skls_put(vm, o, &k);
 		break;
+	case T_BTRE:
+		setv_kstr(&k, kstr_fetch(vm, field, -1));
+		v = btre_put(vm, o, &k);
+		break;
 	default:
 		assert(!"No reached.");
 		return NULL;
@@ -252,6 +312,10 @@ struct variable *vm_mem(struct ymd_mach *vm, void *o, const char *field) {
 		setv_kstr(&k, kstr_fetch(vm, field, -1));
 		v = skls_get(vm, o, &k);
 		break;
+	case T_BTRE:
+		setv_kstr(&k, kstr_fetch(vm, field, -1));
+		v = btre_get(vm, o, &k);
+		break;
 	default:
 		assert(!"No reached.");
 		break;
@@ -314,6 +378,31 @@ struct variable *ymd_upval(struct ymd_context *l, int i) {
 //-----------------------------------------------------------------------------
 // Mach:
 // ----------------------------------------------------------------------------
+static YMD_INLINE ymd_uint_t splitmix64(ymd_uint_t *x) {
+	ymd_uint_t z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Expand one seed word to the whole generator state, so that close seeds
+// still give unrelated sequences; the state can never be all zero.
+void vm_srand(struct ymd_mach *vm, ymd_uint_t seed) {
+	int i;
+	for (i = 0; i < 4; ++i)
+		vm->prng.s[i] = splitmix64(&seed);
+}
+
+ymd_uint_t vm_rand_below(struct ymd_mach *vm, ymd_uint_t n) {
+	// Reject the low `2^64 mod n' values, the rest split evenly.
+	ymd_uint_t r, min = -n % n;
+	assert (n > 0);
+	do
+		r = vm_rand(vm);
+	while (r < min);
+	return r % n;
+}
+
 struct ymd_mach *ymd_init() {
 	struct ymd_mach *vm = calloc(1, sizeof(*vm));
 	if (!vm)
@@ -322,6 +411,8 @@ struct ymd_mach *ymd_init() {
 	vm->zalloc  = default_zalloc;
 	vm->free    = default_free;
 	vm->tick    = 0;
+	vm_srand(vm, (ymd_uint_t)time(NULL) ^ ((ymd_uint_t)clock() << 32) ^
+	         (ymd_uint_t)(uintptr_t)vm);
 	// Init gc:
 	gc_init(vm, GC_THESHOLD);
 	// Init global map:
@@ -12,10 +12,34 @@ struct ymd_context;
 struct ymd_mach;
 
 // Constant string pool
+// While resizing, `old' and `slot' both hold strings, `old' buckets in
+// [0, `migrate') have been moved to `slot' already.
 struct kpool {
 	struct gc_node **slot;
+	struct gc_node **old; // Old slots in resizing, or NULL
 	int used;
 	int shift;
+	int old_shift;
+	int migrate; // Next bucket in `old' to be moved
+	size_t seed; // Random hash seed, per-VM.
+};
+
+#define kpool_nslot(kt) \
+	((1 << (kt)->shift) + ((kt)->old ? (1 << (kt)->old_shift) : 0))
+
+// Get bucket by index in [0, kpool_nslot()), old slots go first.
+static YMD_INLINE struct gc_node **kpool_bucket(struct kpool *kt, int i) {
+	if (kt->old) {
+		if (i < (1 << kt->old_shift))
+			return kt->old + i;
+		i -= (1 << kt->old_shift);
+	}
+	return kt->slot + i;
+}
+
+// Per-VM pseudo random generator: xoshiro256**
+struct prng {
+	ymd_uint_t s[4];
 };
 
 struct ymd_mach {
@@ -31,6 +55,9 @@ struct ymd_mach {
 	struct ymd_context *curr; // Current context
 	void *pcre_js; // pcre jit stack
 	struct variable knil; // nil flag
+	struct variable kpk; // Element of packed array or membership of set
+	                     // got by vm_get()
+	struct prng prng; // Random generator, not shared with libc rand()
 };
 
 struct ymd_mach *ymd_init();
@@ -54,6 +81,34 @@ static YMD_INLINE void vm_free(struct ymd_mach *vm, void *p) {
 	vm->free(vm, p);
 }
 
+// Random numbers:
+void vm_srand(struct ymd_mach *vm, ymd_uint_t seed);
+
+// Uniform random integer in [0, n), n > 0, without modulo bias.
+ymd_uint_t vm_rand_below(struct ymd_mach *vm, ymd_uint_t n);
+
+static YMD_INLINE ymd_uint_t prng_rotl(ymd_uint_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+static YMD_INLINE ymd_uint_t vm_rand(struct ymd_mach *vm) {
+	ymd_uint_t *s = vm->prng.s;
+	const ymd_uint_t rv = prng_rotl(s[1] * 5, 7) * 9;
+	const ymd_uint_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = prng_rotl(s[3], 45);
+	return rv;
+}
+
+// Uniform random float in [0, 1)
+static YMD_INLINE ymd_float_t vm_randf(struct ymd_mach *vm) {
+	return (ymd_float_t)(vm_rand(vm) >> 11) * (1.0 / 9007199254740992.0);
+}
+
 #define UNUSED(useless) ((void)useless)
 
 #define MAX_KPOOL_LEN 40
@@ -154,6 +209,11 @@ struct variable *vm_get(struct ymd_mach *vm, struct variable *var,
 int vm_remove(struct ymd_mach *vm, struct variable *var,
               const struct variable *key);
 
+// Elements of packed array are not variables: vm_get() returns a copy, and
+// they are set by this one.
+void vm_pkay_set(struct ymd_mach *vm, struct variable *var,
+                 const struct variable *key, const struct variable *v);
+
 // Get/Put global variable
 struct variable *vm_putg(struct ymd_mach *vm, const char *field);
 
@@ -166,8 +226,9 @@ struct variable *vm_def(struct ymd_mach *vm, void *o, const char *field);
 struct variable *vm_mem(struct ymd_mach *vm, void *o, const char *field);
 
 // String tool
-struct kstr *vm_strcat(struct ymd_mach *vm, const struct kstr *lhs,
-                       const struct kstr *rhs);
+// Concatenate `n' values as string, non-string values in `argv' will be
+// replaced by their string form.
+struct kstr *vm_strcat(struct ymd_mach *vm, struct variable *argv, int n);
 
 struct kstr *vm_format(struct ymd_mach *vm, const char *fmt, ...);
 
@@ -257,11 +318,58 @@ static YMD_INLINE void ymd_hmap(L, int k) {
 	setv_hmap(ymd_push(l), o);
 }
 
+static YMD_INLINE void ymd_hmap_ordered(L, int k) {
+	struct hmap *o = hmap_new_ordered(l->vm, k);
+	setv_hmap(ymd_push(l), o);
+}
+
 static YMD_INLINE void ymd_skls(L, struct func *cmp) {
 	struct skls *o = skls_new(l->vm, cmp);
 	setv_skls(ymd_push(l), o);
 }
 
+static YMD_INLINE void ymd_skls_key(L, struct func *cmp, struct func *key) {
+	struct skls *o = skls_new_key(l->vm, cmp, key);
+	setv_skls(ymd_push(l), o);
+}
+
+static YMD_INLINE void ymd_btre(L, struct func *cmp) {
+	struct btre *o = btre_new(l->vm, cmp);
+	setv_btre(ymd_push(l), o);
+}
+
+static YMD_INLINE struct pkay *ymd_pkay(L, int kind, int count) {
+	struct pkay *o = pkay_new(l->vm, kind, count);
+	setv_pkay(ymd_push(l), o);
+	return o;
+}
+
+static YMD_INLINE struct dequ *ymd_dequ(L, int count) {
+	struct dequ *o = dequ_new(l->vm, count);
+	setv_dequ(ymd_push(l), o);
+	return o;
+}
+
+static YMD_INLINE struct heap *ymd_heap(L, struct func *cmp,
+                                        struct func *key) {
+	struct heap *o = heap_new(l->vm, cmp, key);
+	setv_heap(ymd_push(l), o);
+	return o;
+}
+
+static YMD_INLINE struct hset *ymd_hset(L, int count) {
+	struct hset *o = hset_new(l->vm, count);
+	setv_hset(ymd_push(l), o);
+	return o;
+}
+
+static YMD_INLINE struct lruc *ymd_lruc(L, ymd_int_t limit, int inbytes,
+                                        struct func *evict) {
+	struct lruc *o = lruc_new(l->vm, limit, inbytes, evict);
+	setv_lruc(ymd_push(l), o);
+	return o;
+}
+
 static YMD_INLINE void *ymd_mand(L, const char *tt, size_t size,
                              ymd_final_t final) {
 	struct mand *o = mand_new(l->vm, size, final);
@@ -320,7 +428,13 @@ static YMD_INLINE void ymd_getf(L) {
 }
 
 static YMD_INLINE void ymd_putf(L) {
-	struct variable *v = vm_put(l->vm, ymd_top(l, 2), ymd_top(l, 1));
+	struct variable *v;
+	if (ymd_type(ymd_top(l, 2)) == T_PKAY) {
+		vm_pkay_set(l->vm, ymd_top(l, 2), ymd_top(l, 1), ymd_top(l, 0));
+		ymd_pop(l, 2);
+		return;
+	}
+	v = vm_put(l->vm, ymd_top(l, 2), ymd_top(l, 1));
 	*v = *ymd_top(l, 0);
 	ymd_pop(l, 2);
 }
@@ -329,14 +443,14 @@ static YMD_INLINE void ymd_mem(L, const char *field) {
 	struct variable *v;
 	if (!is_ref(ymd_top(l, 0)))
 		ymd_panic(l, "Object must be hashmap or skiplist");
-	v = vm_mem(l->vm, ymd_top(l, 0)->u.ref, field);
+	v = vm_mem(l->vm, var_ref(ymd_top(l, 0)), field);
 	*ymd_push(l) = *v;
 }
 
 static YMD_INLINE void ymd_def(L, const char *field) {
 	if (!is_ref(ymd_top(l, 1)))
 		ymd_panic(l, "Object must be hashmap or skiplist");
-	*vm_def(l->vm, ymd_top(l, 1)->u.ref, field) = *ymd_top(l, 0);
+	*vm_def(l->vm, var_ref(ymd_top(l, 1)), field) = *ymd_top(l, 0);
 	ymd_pop(l, 1);
 }
 
@@ -369,7 +483,7 @@ static YMD_INLINE void ymd_setmetatable(L) {
 	struct mand *o = mand_of(l, ymd_top(l, 1));
 	if (ymd_type(ymd_top(l, 0)) != T_HMAP && ymd_type(ymd_top(l, 0)) != T_SKLS)
 		ymd_panic(l, "Not metatable type!");
-	mand_proto(o, ymd_top(l, 0)->u.ref);
+	mand_proto(o, var_ref(ymd_top(l, 0)));
 	ymd_pop(l, 1);
 }
 
@@ -1,110 +1,190 @@
 #include "state.h"
 #include "value.h"
 #include "memory.h"
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
 
 //------------------------------------------------------------------------------
 // String
 //------------------------------------------------------------------------------
 static struct kstr *kstr_new(struct ymd_mach *vm, int raw, const char *z,
-                             int count);
+                             int count, size_t hash);
 
-static void kpool_copy2(struct gc_node **slot, struct gc_node *x, int shift) {
-	int k = 1 << shift;
-	struct kstr *kz = (struct kstr *)x;
-	struct gc_node **list = slot + kstr_hash(kz) % k;
+#define KPOOL_MIN_SHIFT 8
+
+// Number of non-empty buckets moved by one migration step.
+#define KPOOL_MIGRATE_STEP 4
+
+static YMD_INLINE void kpool_link(struct gc_node **slot, struct gc_node *x,
+                                  int shift) {
+	struct gc_node **list = slot + hash_index(kstr_hash((struct kstr *)x),
+	                                          shift);
 	x->next = *list;
 	*list = x;
 }
 
-static void kpool_resize(struct ymd_mach *vm, int shift) {
+// Can not move strings between buckets while gc is sweeping them.
+static YMD_INLINE int kpool_frozen(struct ymd_mach *vm) {
+	return vm->gc.state == GC_SWEEPSTRING;
+}
+
+static void kpool_migrate(struct ymd_mach *vm, int step) {
 	struct kpool *kt = &vm->kpool;
-	struct gc_node **bak = kt->slot;
-	struct gc_node **i, **k = bak + (1 << kt->shift);
-	kt->slot = vm_zalloc(vm, (1 << shift) * sizeof(struct gc_node *));
-	for (i = bak; i != k; ++i) {
-		if (*i) {
-			struct gc_node *x = *i;
+	const int k = 1 << kt->old_shift;
+	int empty = step * 10; // Visit too many empty bucket is slow too.
+	while (kt->migrate < k && step > 0 && empty > 0) {
+		struct gc_node *x = kt->old[kt->migrate];
+		if (!x) {
+			--empty;
+		} else {
 			while (x) {
 				struct gc_node *next = x->next;
-				kpool_copy2(kt->slot, x, shift);
+				kpool_link(kt->slot, x, kt->shift);
 				x = next;
 			}
+			kt->old[kt->migrate] = NULL;
+			--step;
 		}
+		++kt->migrate;
+	}
+	if (kt->migrate >= k) {
+		vm_free(vm, kt->old);
+		kt->old = NULL;
+		kt->old_shift = 0;
+		kt->migrate = 0;
 	}
-	if (bak) vm_free(vm, bak);
+}
+
+// Begin to resize pool, strings move to new slots step by step.
+static void kpool_resize(struct ymd_mach *vm, int shift) {
+	struct kpool *kt = &vm->kpool;
+	assert (!kt->old);
+	assert (shift >= KPOOL_MIN_SHIFT);
+	kt->old = kt->slot;
+	kt->old_shift = kt->shift;
+	kt->migrate = 0;
+	kt->slot = vm_zalloc(vm, (1 << shift) * sizeof(*kt->slot));
 	kt->shift = shift;
 }
 
+void kpool_shrink(struct ymd_mach *vm) {
+	struct kpool *kt = &vm->kpool;
+	int shift = kt->shift;
+	if (kt->old || kpool_frozen(vm))
+		return;
+	// Shrink if load factor under 1/8, new load factor will be 1/2.
+	if (shift <= KPOOL_MIN_SHIFT || kt->used >= (1 << shift) / 8)
+		return;
+	while (shift > KPOOL_MIN_SHIFT && kt->used < (1 << (shift - 2)))
+		--shift;
+	kpool_resize(vm, shift);
+}
+
 static struct kstr *kpool_insert(struct ymd_mach *vm, const char *z,
-                                 int count) {
+                                 int count, size_t h) {
 	struct kpool *kt = &vm->kpool;
-	struct kstr *kz = kstr_new(vm, 1, z, count);
-	struct gc_node **list;
-	if (kt->used >= (1 << kt->shift))
+	struct kstr *kz = kstr_new(vm, 1, z, count, h);
+	if (!kt->old && !kpool_frozen(vm) && kt->used >= (1 << kt->shift))
 		kpool_resize(vm, kt->shift + 1);
-	list = kt->slot + kstr_hash(kz) % (1 << kt->shift);
-	kz->next = *list;
-	*list = gcx(kz);
+	kpool_link(kt->slot, gcx(kz), kt->shift);
 	kt->used++;
 	return kz;
 }
 
+static YMD_INLINE struct kstr *kpool_find(struct gc_node *i, const char *z,
+                                          int count, size_t h) {
+	for (; i != NULL; i = i->next) {
+		struct kstr *x = (struct kstr *)i;
+		if (x->hash == h && x->len == count &&
+			memcmp(x->land, z, count) == 0)
+			return x;
+	}
+	return NULL;
+}
+
 static struct kstr *kpool_index(struct ymd_mach *vm, const char *z,
                                 int count) {
 	struct kpool *kt = &vm->kpool;
-	struct gc_node *i, *list;
+	struct kstr *x;
+	size_t h = kz_hash(z, count, kt->seed);
 	assert (kt->slot);
-	list = kt->slot[(kz_hash(z, count) % (1 << kt->shift))];
-	for (i = list; i != NULL; i = i->next) {
-		struct kstr *x = (struct kstr *)i;
-		if (x->len == count && memcmp(x->land, z, count) == 0)
+	if (kt->old && !kpool_frozen(vm))
+		kpool_migrate(vm, KPOOL_MIGRATE_STEP);
+	if (kt->old) {
+		size_t i = hash_index(h, kt->old_shift);
+		if ((int)i >= kt->migrate &&
+			(x = kpool_find(kt->old[i], z, count, h)) != NULL)
 			return x;
 	}
-	return kpool_insert(vm, z, count);
+	x = kpool_find(kt->slot[hash_index(h, kt->shift)], z, count, h);
+	return x ? x : kpool_insert(vm, z, count, h);
+}
+
+// Seed for string hashing: differs per VM and per run, so that the
+// layout of hash tables can not be predicted from outside.
+static size_t kpool_seed(struct ymd_mach *vm) {
+	ymd_uint_t x = (ymd_uint_t)time(NULL);
+	x ^= (ymd_uint_t)clock() << 32;
+	x ^= (ymd_uint_t)(uintptr_t)vm;
+	x ^= (ymd_uint_t)(uintptr_t)&x << 16;
+	// splitmix64 finalizer
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return (size_t)(x ^ (x >> 31));
 }
 
 void kpool_init(struct ymd_mach *vm) {
 	struct kpool *kt = &vm->kpool;
 	kt->used = 0;
-	kt->shift = 8;
-	kt->slot = vm_zalloc(vm, (1 << kt->shift) * sizeof(struct gc_node *));
+	kt->shift = KPOOL_MIN_SHIFT;
+	kt->old = NULL;
+	kt->old_shift = 0;
+	kt->migrate = 0;
+	kt->seed = kpool_seed(vm);
+	kt->slot = vm_zalloc(vm, (1 << kt->shift) * sizeof(*kt->slot));
 }
 
 void kpool_final(struct ymd_mach *vm) {
 	struct kpool *kt = &vm->kpool;
-	struct gc_node **i, **k = kt->slot + (1 << kt->shift);
-	kt->shift = 0;
-	for (i = kt->slot; i != k; ++i) {
-		if (*i) {
-			struct gc_node *x = *i, *p = x;
-			while (x) {
-				p = x;
-				x = x->next;
-				gc_del(vm, p);
-				kt->used--;
-			}
+	int i, k = kpool_nslot(kt);
+	for (i = 0; i < k; ++i) {
+		struct gc_node *x = *kpool_bucket(kt, i), *p;
+		while (x) {
+			p = x;
+			x = x->next;
+			gc_del(vm, p);
+			kt->used--;
 		}
 	}
 	assert(kt->used == 0);
+	if (kt->old)
+		vm_free(vm, kt->old);
 	vm_free(vm, kt->slot);
+	kt->old = NULL;
+	kt->slot = NULL;
+	kt->shift = 0;
 }
 
 static struct kstr *kstr_new(struct ymd_mach *vm, int raw, const char *z,
-                             int count) {
+                             int count, size_t hash) {
 	struct kstr *x = NULL;
-	if (count < 0)
-		count = strlen(z);
+	assert (count >= 0);
 	if (raw) {
 		x = mm_zalloc(vm, 1, sizeof(*x) + count);
 		x->type = T_KSTR;
 		x->marked = vm->gc.white;
 		++vm->gc.n_alloced;
-	} else
+		x->hash = hash;
+	} else {
+		// Long string: hash it later, maybe it never be a key.
 		x = gc_new(vm, sizeof(*x) + count, T_KSTR);
+		x->hash = vm->kpool.seed;
+		x->reserved = KSTR_LAZY;
+	}
 	x->len = count;
-	if (!z)
-		memset(x->land, 0, count + 1);
-	else
+	x->land = x->u.buf;
+	if (z) // Allocated memory is already zero.
 		memcpy(x->land, z, count);
 	return x;
 }
@@ -116,7 +196,7 @@ struct kstr *kstr_fetch(struct ymd_mach *vm, const char *z, int count) {
 	if (count < MAX_KPOOL_LEN)
 		kz = kpool_index(vm, z, count);
 	else
-		kz = kstr_new(vm, 0, z, count);
+		kz = kstr_new(vm, 0, z, count, 0);
 	// NOTE:
 	// Reset white color, because short string in pool:
 	// We fetch a string, make it to new string.
@@ -125,6 +205,84 @@ struct kstr *kstr_fetch(struct ymd_mach *vm, const char *z, int count) {
 	return kz;
 }
 
+struct kstr *kstr_slice(struct ymd_mach *vm, struct kstr *kz, int start,
+                        int count) {
+	struct kstr *x;
+	assert (start >= 0 && count >= 0);
+	assert (start + count <= kz->len);
+	if (start == 0 && count == kz->len)
+		return kz;
+	// Only suffix ends with '\0' can be shared, short string must be
+	// in pool.
+	if (count < MAX_KPOOL_LEN || start + count != kz->len)
+		return kstr_fetch(vm, kz->land + start, count);
+	x = gc_new(vm, sizeof(*x), T_KSTR);
+	x->len = count;
+	x->hash = vm->kpool.seed;
+	x->reserved = KSTR_VIEW | KSTR_LAZY;
+	x->land = kz->land + start;
+	x->u.parent = (kz->reserved & KSTR_VIEW) ? kz->u.parent : kz;
+	return x;
+}
+
+// Buffer of `max' bytes, `len' is the used part. Bytes after it are
+// always zero, so the view at the used end is terminated.
+static struct kstr *kbuf_new(struct ymd_mach *vm, int max) {
+	struct kstr *x = gc_new(vm, sizeof(*x) + max, T_KSTR);
+	x->reserved = KSTR_BUF;
+	x->hash = (size_t)max;
+	x->land = x->u.buf;
+	return x;
+}
+
+static struct kstr *kbuf_view(struct ymd_mach *vm, struct kstr *buf,
+                              const char *land, int count) {
+	struct kstr *x = gc_new(vm, sizeof(*x), T_KSTR);
+	x->len = count;
+	x->hash = vm->kpool.seed;
+	x->reserved = KSTR_VIEW | KSTR_LAZY;
+	x->land = (char *)land;
+	x->u.parent = buf;
+	return x;
+}
+
+struct kstr *kstr_concat(struct ymd_mach *vm, const struct variable *part,
+                         int n) {
+	const struct kstr *kz = kstr_k(part);
+	struct kstr *x = NULL;
+	char buf[MAX_KPOOL_LEN], *p = buf;
+	const char *land = NULL;
+	int i, k = 0, count = 0;
+	for (i = 0; i < n; ++i)
+		count += kstr_k(part + i)->len;
+	if (count >= MAX_KPOOL_LEN) {
+		// The first part is at the used end of an append buffer.
+		int tip = (kz->reserved & KSTR_VIEW) &&
+		          (kz->u.parent->reserved & KSTR_BUF) && !kstr_open(kz);
+		if (tip && count - kz->len <= (int)kz->u.parent->hash -
+		                              kz->u.parent->len) {
+			x = kz->u.parent;
+			land = kz->land;
+			k = 1; // Only the rest parts are copied.
+		} else {
+			// Double a buffer has been appended, so a loop of appending
+			// copies each byte O(1) times.
+			x = kbuf_new(vm, tip && count < INT_MAX / 2 ? count * 2 : count);
+			land = x->land;
+		}
+		p = x->land + x->len;
+	}
+	for (i = k; i < n; ++i) {
+		kz = kstr_k(part + i);
+		memcpy(p, kz->land, kz->len);
+		p += kz->len;
+	}
+	if (!x) // Short string must be in pool.
+		return kstr_fetch(vm, buf, count);
+	x->len = (int)(p - x->land);
+	return kbuf_view(vm, x, land, count);
+}
+
 int kstr_equals(const struct kstr *kz, const struct kstr *rhs) {
 	if (kz == rhs)
 		return 1;
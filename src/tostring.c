@@ -20,19 +20,21 @@ static const char *dyay_tostring(struct zostream *os, const struct dyay *o) {
 }
 
 static const char *hmap_tostring(struct zostream *os, const struct hmap *o) {
-	struct kvi *initial = o->item, *i = NULL,
-			   *k = initial + (1 << o->shift);
-	int f = 0;
+	struct variable k;
+	int i, f = 0;
 	if (mm_busy(o))
-		return zos_append(os, "..{self}..", 10);
-	zos_append(os, "{", 1);
+		return hmap_ordered(o) ? zos_append(os, "..%{self}..", 11) :
+		       zos_append(os, "..{self}..", 10);
+	if (hmap_ordered(o))
+		zos_append(os, "%{", 2);
+	else
+		zos_append(os, "{", 1);
 	mm_work(gcx(o));
-	for (i = initial; i != k; ++i) {
-		if (!i->flag) continue;
+	for (i = hmap_next(o, 0); i < hmap_end(o); i = hmap_next(o, i + 1)) {
 		if (f++ > 0) zos_append(os, ", ", 2);
-		tostring(os, &i->k);
+		tostring(os, hmap_key(o, i, &k));
 		zos_append(os, " : ", 3);
-		tostring(os, &i->v);
+		tostring(os, hmap_val(o, i));
 	}
 	mm_idle(gcx(o));
 	return zos_append(os, "}", 1);
@@ -55,6 +57,103 @@ static const char *skls_tostring(struct zostream *os, const struct skls *o) {
 	return zos_append(os, "}", 1);
 }
 
+static const char *btre_tostring(struct zostream *os, const struct btre *o) {
+	const struct btlf *x;
+	int i, f = 0;
+	if (mm_busy(o))
+		return zos_append(os, "..@@{self}..", 12);
+	zos_append(os, "@@{", 3);
+	mm_work(gcx(o));
+	for (x = o->first; x != NULL; x = x->next) {
+		for (i = 0; i < x->nd.n; ++i) {
+			if (f++ > 0) zos_append(os, ", ", 2);
+			tostring(os, x->nd.k + i);
+			zos_append(os, " : ", 3);
+			tostring(os, x->v + i);
+		}
+	}
+	mm_idle(gcx(o));
+	return zos_append(os, "}", 1);
+}
+
+// int64[1, 2, 3]
+static const char *pkay_tostring(struct zostream *os, const struct pkay *o) {
+	struct variable x;
+	const char *kind = pkay_kind_name(pkay_kind(o));
+	int i;
+	zos_append(os, kind, (int)strlen(kind));
+	zos_append(os, "[", 1);
+	for (i = 0; i < o->count; ++i) {
+		if (i > 0) zos_append(os, ", ", 2);
+		tostring(os, pkay_get(o, i, &x));
+	}
+	return zos_append(os, "]", 1);
+}
+
+// deque[1, 2, 3]
+static const char *dequ_tostring(struct zostream *os, const struct dequ *o) {
+	int i;
+	if (mm_busy(o))
+		return zos_append(os, "..deque[self]..", 15);
+	zos_append(os, "deque[", 6);
+	mm_work(gcx(o));
+	for (i = 0; i < o->count; ++i) {
+		if (i > 0) zos_append(os, ", ", 2);
+		tostring(os, dequ_get(o, i));
+	}
+	mm_idle(gcx(o));
+	return zos_append(os, "]", 1);
+}
+
+// heap[1, 3, 2], elements in storage order, the first one is the top.
+static const char *heap_tostring(struct zostream *os, const struct heap *o) {
+	int i;
+	if (mm_busy(o))
+		return zos_append(os, "..heap[self]..", 14);
+	zos_append(os, "heap[", 5);
+	mm_work(gcx(o));
+	for (i = 0; i < o->count; ++i) {
+		if (i > 0) zos_append(os, ", ", 2);
+		tostring(os, o->elem + i);
+	}
+	mm_idle(gcx(o));
+	return zos_append(os, "]", 1);
+}
+
+// set{1, 2, 3}
+static const char *hset_tostring(struct zostream *os, const struct hset *o) {
+	int i, f = 0;
+	if (mm_busy(o))
+		return zos_append(os, "..set{self}..", 13);
+	zos_append(os, "set{", 4);
+	mm_work(gcx(o));
+	for (i = 0; i < hset_nslot(o); ++i) {
+		if (!hset_full(o, i))
+			continue;
+		if (f++ > 0) zos_append(os, ", ", 2);
+		tostring(os, o->key + i);
+	}
+	mm_idle(gcx(o));
+	return zos_append(os, "}", 1);
+}
+
+// lru{c : 3, b : 2, a : 1}, from the most recently used one to the least.
+static const char *lruc_tostring(struct zostream *os, const struct lruc *o) {
+	int i;
+	if (mm_busy(o))
+		return zos_append(os, "..lru{self}..", 13);
+	zos_append(os, "lru{", 4);
+	mm_work(gcx(o));
+	for (i = o->head; i >= 0; i = o->node[i].next) {
+		if (i != o->head) zos_append(os, ", ", 2);
+		tostring(os, &o->node[i].k);
+		zos_append(os, " : ", 3);
+		tostring(os, &o->node[i].v);
+	}
+	mm_idle(gcx(o));
+	return zos_append(os, "}", 1);
+}
+
 static const char *mand_tostring(struct zostream *os, const struct mand *o) {
 	zos_append(os, "(", 1);
 	if (o->tt)
@@ -75,23 +174,23 @@ const char *tostring(struct zostream *os, const struct variable *var) {
 		break;
 	case T_INT:
 		zos_reserved(os, 24);
-		snprintf(zos_last(os), zos_remain(os), "%lld", var->u.i);
+		snprintf(zos_last(os), zos_remain(os), "%lld", var_int(var));
 		zos_add(os);
 		break;
 	case T_FLOAT:
 		zos_reserved(os, 24);
-		snprintf(zos_last(os), zos_remain(os), "%f", var->u.f);
+		snprintf(zos_last(os), zos_remain(os), "%f", var_float(var));
 		zos_add(os);
 		break;
 	case T_BOOL:
-		if (var->u.i)
+		if (var_int(var))
 			zos_append(os, "true", 4);
 		else
 			zos_append(os, "false", 5);
 		break;
 	case T_EXT:
 		zos_reserved(os, 24);
-		snprintf(zos_last(os), zos_remain(os), "@%p", var->u.ext);
+		snprintf(zos_last(os), zos_remain(os), "@%p", var_ext(var));
 		zos_add(os);
 		break;
 	case T_KSTR:
@@ -111,6 +210,24 @@ const char *tostring(struct zostream *os, const struct variable *var) {
 	case T_SKLS:
 		skls_tostring(os, skls_k(var));
 		break;
+	case T_BTRE:
+		btre_tostring(os, btre_k(var));
+		break;
+	case T_PKAY:
+		pkay_tostring(os, pkay_k(var));
+		break;
+	case T_DEQU:
+		dequ_tostring(os, dequ_k(var));
+		break;
+	case T_HEAP:
+		heap_tostring(os, heap_k(var));
+		break;
+	case T_HSET:
+		hset_tostring(os, hset_k(var));
+		break;
+	case T_LRUC:
+		lruc_tostring(os, lruc_k(var));
+		break;
 	case T_MAND:
 		mand_tostring(os, mand_k(var));
 		break;
@@ -21,6 +21,12 @@ static const struct typeof_z typeof_name[T_MAX] = {
 	{ 7, "hashmap", },
 	{ 8, "skiplist", },
 	{ 7, "managed", },
+	{ 5, "btree", },
+	{ 6, "packed", },
+	{ 5, "deque", },
+	{ 4, "heap", },
+	{ 3, "set", },
+	{ 3, "lru", },
 };
 
 const char *typeof_kz(int tt) {
@@ -36,24 +42,24 @@ struct kstr *typeof_kstr(struct ymd_mach *vm, int tt) {
 //-------------------------------------------------------------------------
 // Constant variable value:
 //-------------------------------------------------------------------------
-static struct variable knil_fake_var = { T_NIL, {0} };
+static struct variable knil_fake_var; // Zero is nil.
 struct variable *knil = &knil_fake_var;
 
 //-------------------------------------------------------------------------
 // Type casting define:
 //-------------------------------------------------------------------------
 ymd_int_t int_of(struct ymd_context *l, const struct variable *var) {
-	if (var->tt != T_INT)
+	if (var_tt(var) != T_INT)
 		ymd_panic(l, "Variable is not `int'");
-	return var->u.i;
+	return var_int(var);
 }
 
 ymd_int_t int4of(struct ymd_context *l, const struct variable *var) {
 	switch (ymd_type(var)) {
 	case T_INT:
-		return var->u.i;
+		return var_int(var);
 	case T_FLOAT:
-		return (ymd_int_t)var->u.f;
+		return (ymd_int_t)var_float(var);
 	default:
 		ymd_panic(l, "Variable is not a number(int or float)");
 		break;
@@ -62,17 +68,17 @@ ymd_int_t int4of(struct ymd_context *l, const struct variable *var) {
 }
 
 ymd_float_t float_of(struct ymd_context *l, const struct variable *var) {
-	if (var->tt != T_FLOAT)
+	if (var_tt(var) != T_FLOAT)
 		ymd_panic(l, "Variable is not `float'");
-	return var->u.f;
+	return var_float(var);
 }
 
 ymd_float_t float4(const struct variable *var) {
 	switch (ymd_type(var)) {
 	case T_INT:
-		return (ymd_float_t)var->u.i;
+		return (ymd_float_t)var_int(var);
 	case T_FLOAT:
-		return var->u.f;
+		return var_float(var);
 	default:
 		assert (!"Operand is not a number.");
 		break;
@@ -83,9 +89,9 @@ ymd_float_t float4(const struct variable *var) {
 ymd_float_t float4of(struct ymd_context *l, const struct variable *var) {
 	switch (ymd_type(var)) {
 	case T_INT:
-		return (ymd_float_t)var->u.i;
+		return (ymd_float_t)var_int(var);
 	case T_FLOAT:
-		return var->u.f;
+		return var_float(var);
 	default:
 		ymd_panic(l, "Variable is not a number(int or float)");
 		break;
@@ -94,9 +100,19 @@ ymd_float_t float4of(struct ymd_context *l, const struct variable *var) {
 }
 
 ymd_int_t bool_of(struct ymd_context *l, const struct variable *var) {
-	if (var->tt != T_BOOL)
+	if (var_tt(var) != T_BOOL)
 		ymd_panic(l, "Variable is not `bool'");
-	return var->u.i;
+	return var_int(var);
+}
+
+// String for C functions must be terminated by '\0'.
+static struct kstr *kstr_cstr(struct ymd_context *l, struct variable *var) {
+	struct kstr *kz = kstr_x(var);
+	if (kstr_open(kz)) {
+		kz = kstr_fetch(l->vm, kz->land, kz->len);
+		setv_kstr(var, kz);
+	}
+	return kz;
 }
 
 #define DEFINE_REFOF(name, tt) \
@@ -104,8 +120,10 @@ struct name *name##_of(struct ymd_context *l, \
 		struct variable *var) { \
 	if (ymd_type(var) != tt) \
 		ymd_panic(l, "Variable is not `"#name"'"); \
-	assert(var->u.ref != NULL); \
-	return (struct name *)var->u.ref; \
+	assert(var_ref(var) != NULL); \
+	if (tt == T_KSTR) \
+		return (struct name *)kstr_cstr(l, var); \
+	return (struct name *)var_ref(var); \
 }
 DECL_TREF(DEFINE_REFOF)
 #undef DEFINE_REFOF
@@ -132,21 +150,33 @@ int equals(const struct variable *lhs, const struct variable *rhs) {
 		return 1;
 	case T_INT:
 	case T_BOOL:
-		return lhs->u.i == rhs->u.i;
+		return var_int(lhs) == var_int(rhs);
 	case T_FLOAT:
-		return lhs->u.f == rhs->u.f; // FIXME:int and float can equals
+		return var_float(lhs) == var_float(rhs); // FIXME:int and float can equals
 	case T_KSTR:
 		return kstr_equals(kstr_k(lhs), kstr_k(rhs));
 	case T_FUNC:
 		return func_equals(func_k(lhs), func_k(rhs));
 	case T_EXT:
-		return lhs->u.ext == rhs->u.ext;
+		return var_ext(lhs) == var_ext(rhs);
 	case T_DYAY:
 		return dyay_equals(dyay_k(lhs), dyay_k(rhs));
 	case T_HMAP:
 		return hmap_equals(hmap_k(lhs), hmap_k(rhs));
 	case T_SKLS:
 		return skls_equals(skls_k(lhs), skls_k(rhs));
+	case T_BTRE:
+		return btre_equals(btre_k(lhs), btre_k(rhs));
+	case T_PKAY:
+		return pkay_equals(pkay_k(lhs), pkay_k(rhs));
+	case T_DEQU:
+		return dequ_equals(dequ_k(lhs), dequ_k(rhs));
+	case T_HEAP: // Order of elements in a heap is not meaningful.
+		return heap_k(lhs) == heap_k(rhs);
+	case T_HSET:
+		return hset_equals(hset_k(lhs), hset_k(rhs));
+	case T_LRUC: // Recency is changed by getting, only itself is equal.
+		return lruc_k(lhs) == lruc_k(rhs);
 	//case T_MAND:
 	// TODO:
 	//	return mand_equals(mand_k(lhs), mand_k(rhs));
@@ -169,11 +199,11 @@ int compare(const struct variable *lhs, const struct variable *rhs) {
 		return 0; // Do not compare a nil value.
 	case T_INT:
 	case T_BOOL:
-		return safe_compare(lhs->u.i, rhs->u.i);
+		return safe_compare(var_int(lhs), var_int(rhs));
 	case T_FLOAT:
-		return safe_compare(lhs->u.f, rhs->u.f);
+		return safe_compare(var_float(lhs), var_float(rhs));
 	case T_EXT:
-		return safe_compare(lhs->u.ext, rhs->u.ext);
+		return safe_compare(var_ext(lhs), var_ext(rhs));
 	case T_KSTR:
 		return kstr_compare(kstr_k(lhs), kstr_k(rhs));
 	case T_FUNC:
@@ -184,6 +214,18 @@ int compare(const struct variable *lhs, const struct variable *rhs) {
 		return hmap_compare(hmap_k(lhs), hmap_k(rhs));
 	case T_SKLS:
 		return skls_compare(skls_k(lhs), skls_k(rhs));
+	case T_BTRE:
+		return btre_compare(btre_k(lhs), btre_k(rhs));
+	case T_PKAY:
+		return pkay_compare(pkay_k(lhs), pkay_k(rhs));
+	case T_DEQU:
+		return dequ_compare(dequ_k(lhs), dequ_k(rhs));
+	case T_HEAP:
+		return safe_compare(heap_k(lhs), heap_k(rhs));
+	case T_HSET:
+		return hset_compare(hset_k(lhs), hset_k(rhs));
+	case T_LRUC:
+		return safe_compare(lruc_k(lhs), lruc_k(rhs));
 	//case T_MAND:
 	//	return mand_compare(mand_k(lhs), mand_k(rhs));
 	default:
@@ -197,16 +239,35 @@ int num_compare(const struct variable *lhs, const struct variable *rhs) {
 	assert (is_num(lhs) && is_num(rhs) && "Comparing operands not number.");
 	if (floatize(lhs, rhs))
 		return safe_compare(float4(lhs), float4(rhs));
-	return safe_compare(lhs->u.i, rhs->u.i);
+	return safe_compare(var_int(lhs), var_int(rhs));
 }
 
 #undef safe_compare
 
-size_t kz_hash(const char *z, int i) {
-	size_t n = 1315423911U;
-	while(i--)
-		n ^= ((n << 5) + (*z++) + (n >> 2));
-	return n;
+// MurmurHash64A: consumes the string a 64-bit word at a time.
+size_t kz_hash(const char *z, int i, size_t seed) {
+	static const ymd_uint_t m = 0xc6a4a7935bd1e995ULL;
+	const unsigned char *p = (const unsigned char *)z;
+	ymd_uint_t k, h = (ymd_uint_t)seed ^ ((ymd_uint_t)i * m);
+	for (; i >= (int)sizeof(k); i -= sizeof(k), p += sizeof(k)) {
+		memcpy(&k, p, sizeof(k));
+		k *= m;
+		k ^= k >> 47;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+	if (i > 0) { // Tail bytes
+		k = 0;
+		while (i--)
+			k = (k << 8) | p[i];
+		h ^= k;
+		h *= m;
+	}
+	h ^= h >> 47;
+	h *= m;
+	h ^= h >> 47;
+	return (size_t)h;
 }
 
 int kz_compare(const unsigned char *z1, int n1,
@@ -24,8 +24,14 @@
 #define T_HMAP    8 // Hash map
 #define T_SKLS    9 // Skip list
 #define T_MAND   10 // Managed data(from C/C++)
+#define T_BTRE   11 // B+ tree
+#define T_PKAY   12 // Packed numeric array
+#define T_DEQU   13 // Double-ended queue
+#define T_HEAP   14 // Binary heap
+#define T_HSET   15 // Hash set
+#define T_LRUC   16 // LRU cache
 
-#define T_MAX    11
+#define T_MAX    17
 
 #define DECL_TREF(v) \
 	v(func, T_FUNC)  \
@@ -33,10 +39,24 @@
 	v(dyay, T_DYAY)  \
 	v(hmap, T_HMAP)  \
 	v(skls, T_SKLS)  \
-	v(mand, T_MAND)
+	v(mand, T_MAND)  \
+	v(btre, T_BTRE)  \
+	v(pkay, T_PKAY)  \
+	v(dequ, T_DEQU)  \
+	v(heap, T_HEAP)  \
+	v(hset, T_HSET)  \
+	v(lruc, T_LRUC)
 
 #define MAX_CHUNK_LEN 512
 
+#if defined(YMD_NANBOX)
+// NaN-boxed variable, 8 bytes: see value_inl.h
+// NOTE: Only for 64-bit platforms with 48-bit virtual address,
+// `int' is 48-bit signed integer in this mode.
+struct variable {
+	ymd_uint_t nb;
+};
+#else
 struct variable {
 	unsigned char tt;
 	union {
@@ -46,6 +66,7 @@ struct variable {
 		ymd_int_t i;
 	} u;
 };
+#endif
 
 // Byte Function
 struct chunk {
@@ -77,11 +98,21 @@ struct func {
 };
 
 // Constant String:
+// kstr->reserved flags:
+#define KSTR_VIEW 0x1 // `land' is borrowed from `u.parent'
+#define KSTR_LAZY 0x2 // Not hashed yet, `hash' is the seed.
+#define KSTR_BUF  0x4 // Append buffer of concatenating, never be a value:
+                      // `len' bytes are used, `hash' is the capacity.
+
 struct kstr {
 	GC_HEAD;
 	int len;
 	size_t hash;
-	char land[1];
+	char *land; // Points to `u.buf', or into the parent for a view.
+	union {
+		struct kstr *parent; // Owner of `land', only for view.
+		char buf[1];
+	} u;
 };
 
 // Dynamic Array:
@@ -89,24 +120,55 @@ struct dyay {
 	GC_HEAD;
 	int count;
 	int max;
+	unsigned version; // Modification counter, for iterators.
 	struct variable *elem;
+	struct dyay *parent; // Slice view: `elem' is borrowed from parent.
 };
 
 // Hash Map:
 // Key-value pair:
 struct kvi {
-	struct kvi *next;
-	size_t hash;       // Fast hash value
 	struct variable k;
 	struct variable v;
-	unsigned char flag;
 };
 
+// Control byte of a slot:
+#define KVI_EMPTY   0x00
+#define KVI_DELETED 0x01
+#define KVI_FULL    0x80 // | low 7 bits of key's hash
+
+// Open addressing table: slots are probed by control bytes. Small map has
+// no control bytes, its pairs are in item[0, count).
+// Dense integer keys [0, asize) are not hashed, their values are in
+// array part `arr', `nil' is an unused one.
+// Ordered map (HMAP_ORDERED) has no array part, its pairs are in
+// item[] by inserting order, and slots are indices of item[].
 struct hmap {
 	GC_HEAD;
-	int shift;
+	int shift; // Number of slots: 1 << shift
+	int count; // Number of k-v pairs in hash part
+	int growth; // Empty slots can be used before rehash.
+	int asize; // Size of array part
+	int acount; // Number of k-v pairs in array part
+	unsigned version; // Modification counter, for iterators.
+	unsigned char *ctrl; // Control bytes, after the item array.
 	struct kvi *item;
-	struct kvi *free;
+	struct variable *arr;
+};
+
+// Hash Set:
+// Same probing as hash map's table, but a slot has only a key and 32 bits
+// of its mixed hash. Keys are never hashed again in rehash or set algebra.
+// Empty set has no table.
+struct hset {
+	GC_HEAD;
+	int shift; // Number of slots: 1 << shift
+	int count;
+	int growth; // Empty slots can be used before rehash.
+	unsigned version; // Modification counter, for iterators.
+	struct variable *key; // NULL if no table
+	ymd_u32_t *hash; // After the key array
+	unsigned char *ctrl; // Control bytes, after the hash array.
 };
 
 // Skip List:
@@ -114,22 +176,162 @@ struct hmap {
 struct sknd {
 	struct variable k;
 	struct variable v;
+	struct sknd *bwd; // Backward node in level 0, NULL for the first one
 	unsigned short n; // number of forward nodes
 	struct sknd *fwd[1]; // Forward list
+	// `n' span widths follow the forward list, see sknd_span().
 };
 
+// span[i] is how many ranks fwd[i] jumps over; a NULL forward pointer
+// spans to the end of list.
+#define sknd_span(x) ((int *)((x)->fwd + (x)->n))
+
+// Nodes of a key function list cache key(k) after the span widths.
+#define sknd_okey_off(n) \
+	((sizeof(struct sknd) + ((n) - 1) * sizeof(struct sknd *) + \
+	  (n) * sizeof(int) + 7) & ~(size_t)7)
+#define sknd_okey(x) \
+	((struct variable *)((char *)(x) + sknd_okey_off((x)->n)))
+
 #define SKLS_ASC  ((struct func *)0)
 #define SKLS_DASC ((struct func *)1)
 
+#define SKLS_MAX_LEVEL 16
+
 struct skls {
 	GC_HEAD;
 	int count;
+	unsigned version; // Modification counter, for iterators.
 	unsigned short lv;
 	struct func *cmp; // user defined function
 	                  // (void*)0 : order by asc
 	                  // (void*)1 : order by dasc
 	                  // other    : order by user function
+	struct func *key; // key function: order by key(k) with asc or dasc
 	struct sknd *head;
+	struct sknd *tail; // Last node, or NULL if empty
+};
+
+// B+ tree:
+// Keys are contiguous in a wide node, pairs are only in leaves.
+#define BTRE_MAX 32 // Max number of keys in a node
+#define BTRE_MIN (BTRE_MAX / 2) // Min number of keys in a non-root node
+
+struct btnd {
+	unsigned short n; // Number of keys
+	unsigned short leaf;
+	struct variable k[BTRE_MAX];
+};
+
+// Leaf node, linked in order
+struct btlf {
+	struct btnd nd;
+	struct btlf *prev;
+	struct btlf *next;
+	struct variable v[BTRE_MAX];
+};
+
+// Internal node: `n' keys and `n + 1' children, keys of child[i] are less
+// than k[i], and keys of child[i + 1] are great or equal than k[i].
+struct btin {
+	struct btnd nd;
+	struct btnd *child[BTRE_MAX + 1];
+};
+
+struct btre {
+	GC_HEAD;
+	int count;
+	unsigned version; // Modification counter, for iterators.
+	unsigned short height; // 0 if empty
+	struct func *cmp; // Same as skip list: SKLS_ASC, SKLS_DASC or function
+	struct btnd *root; // NULL if empty
+	struct btlf *first;
+	struct btlf *last;
+};
+
+// Packed array:
+// Numbers of one kind without tags, the kind is in GC_HEAD's `reserved'.
+#define PKAY_I64  0
+#define PKAY_F64  1
+#define PKAY_I32  2
+#define PKAY_U8   3
+#define PKAY_MAX  4
+#define pkay_kind(o) ((o)->reserved)
+
+// Comparing operators of masks
+#define PKAY_LT   0
+#define PKAY_LE   1
+#define PKAY_GT   2
+#define PKAY_GE   3
+#define PKAY_EQ   4
+#define PKAY_NE   5
+
+struct pkay {
+	GC_HEAD;
+	int count;
+	int max;
+	unsigned version; // Modification counter, for iterators.
+	union {
+		void *raw;
+		ymd_int_t *i64;
+		ymd_float_t *f64;
+		ymd_i32_t *i32;
+		ymd_byte_t *u8;
+	} u;
+};
+
+// Double-ended queue:
+// A ring buffer, `max' is 0 or a power of 2.
+struct dequ {
+	GC_HEAD;
+	int count;
+	int max;
+	int head; // Position of the first element
+	unsigned version; // Modification counter, for iterators.
+	struct variable *elem;
+};
+
+// Binary heap:
+// elem[0] is the first one in order, elem[i] is not after its children
+// elem[2i + 1] and elem[2i + 2].
+struct heap {
+	GC_HEAD;
+	int count;
+	int max;
+	unsigned version; // Modification counter, for iterators.
+	struct func *cmp; // Same as skip list: SKLS_ASC, SKLS_DASC or function
+	struct func *key; // key function: order by key(x) with asc or dasc
+	struct variable *elem;
+	struct variable *okey; // okey[i] is key(elem[i]) if has key function
+};
+
+// LRU cache:
+// Nodes are in an array and linked by index, from the most recently used
+// one (head) to the least (tail). Free nodes are linked by `next'. The
+// index map gets position of node by key.
+struct lrnd {
+	struct variable k;
+	struct variable v;
+	int prev; // -1 if it is the head
+	int next; // -1 if it is the tail
+};
+
+struct lruc {
+	GC_HEAD;
+	int count;
+	int max; // Number of nodes
+	int head;
+	int tail;
+	int free;
+	unsigned version; // Modification counter, for iterators.
+	ymd_int_t limit; // Capacity in entries or bytes
+	ymd_int_t bytes; // Bytes of all entries, see lruc_bytes()
+	ymd_int_t hit;
+	ymd_int_t miss;
+	ymd_int_t evicted;
+	struct func *evict; // Called as evict(k, v) after evicting, or NULL
+	struct lrnd *node;
+	struct hmap index; // key -> position of node, keys are same as nodes'
 };
 
 // Managed data (must be from C/C++)
@@ -173,33 +375,88 @@ int kstr_equals(const struct kstr *kz, const struct kstr *rhs);
 int kstr_compare(const struct kstr *kz, const struct kstr *rhs);
 int hmap_equals(const struct hmap *o, const struct hmap *rhs);
 int hmap_compare(const struct hmap *o, const struct hmap *rhs);
+int hset_equals(const struct hset *o, const struct hset *rhs);
+int hset_compare(const struct hset *o, const struct hset *rhs);
 int skls_equals(const struct skls *o, const struct skls *rhs);
 int skls_compare(const struct skls *o, const struct skls *rhs);
+int btre_equals(const struct btre *o, const struct btre *rhs);
+int btre_compare(const struct btre *o, const struct btre *rhs);
 int func_equals(const struct func *o, const struct func *rhs);
 int func_compare(const struct func *o, const struct func *rhs);
 int dyay_equals(const struct dyay *o, const struct dyay *rhs);
 int dyay_compare(const struct dyay *o, const struct dyay *rhs);
+int pkay_equals(const struct pkay *o, const struct pkay *rhs);
+int pkay_compare(const struct pkay *o, const struct pkay *rhs);
+int dequ_equals(const struct dequ *o, const struct dequ *rhs);
+int dequ_compare(const struct dequ *o, const struct dequ *rhs);
 int mand_equals(const struct mand *o, const struct mand *rhs);
 int mand_compare(const struct mand *o, const struct mand *rhs);
 
 // Constant string: `kstr`
 struct kstr *kstr_fetch(struct ymd_mach *vm, const char *z, int count);
 
-size_t kz_hash(const char *z, int n);
+// Concatenate `n' strings. A long result is a view of an append buffer,
+// if the first part is the view at the end of its buffer, the rest parts
+// are appended in place: `s = s .. x' in a loop is amortized O(n).
+struct kstr *kstr_concat(struct ymd_mach *vm, const struct variable *part,
+                         int n);
+
+// A view in append buffer before the used end is not terminated by '\0',
+// `kstr_of()' replaces it by a terminated copy for C functions.
+static YMD_INLINE int kstr_open(const struct kstr *kz) {
+	return (kz->reserved & KSTR_VIEW) &&
+	       (kz->u.parent->reserved & KSTR_BUF) &&
+	       kz->land + kz->len != kz->u.parent->land + kz->u.parent->len;
+}
+
+// Sub string [start, start + count) of `kz'. A long suffix shares memory
+// with `kz', others are copied.
+struct kstr *kstr_slice(struct ymd_mach *vm, struct kstr *kz, int start,
+                        int count);
+
+size_t kz_hash(const char *z, int n, size_t seed);
 
 int kz_compare(const unsigned char *z1, int n1,
                const unsigned char *z2, int n2);
 
-static YMD_INLINE size_t kstr_hash(struct kstr *kz) {
-	kz->hash = kz->hash ? kz->hash : kz_hash(kz->land, kz->len);
+// Short string is hashed when it is created, long string is hashed at the
+// first time it be used.
+static YMD_INLINE size_t kstr_hash(const struct kstr *kz) {
+	if (kz->reserved & KSTR_LAZY) {
+		struct kstr *x = (struct kstr *)kz;
+		x->hash = kz_hash(x->land, x->len, x->hash);
+		x->reserved &= ~KSTR_LAZY;
+	}
 	return kz->hash;
 }
 
+// Map a full hash value into [0, 1 << shift), all bits of `h' take part in
+// the index (Fibonacci hashing).
+static YMD_INLINE size_t hash_index(size_t h, int shift) {
+	assert (shift > 0);
+	return (size_t)(((ymd_uint_t)h * 0x9E3779B97F4A7C15ULL) >> (64 - shift));
+}
+
 void kpool_init(struct ymd_mach *vm);
 void kpool_final(struct ymd_mach *vm);
+// Shrink pool if too many strings swept.
+void kpool_shrink(struct ymd_mach *vm);
 
 // Hash map: `hmap` functions:
+#define hmap_nslot(o)    (1 << (o)->shift)
+#define kvi_full(o, i)   ((o)->ctrl[i] & KVI_FULL)
+#define hmap_count(o)    ((o)->count + (o)->acount)
+// Flag in GC_HEAD's `reserved': keep inserting order.
+#define HMAP_ORDERED     0x1
+#define hmap_ordered(o)  ((o)->reserved & HMAP_ORDERED)
+// Ordered table's item index of slots, after the item array.
+#define hmap_index(o)    ((int *)((o)->item + hmap_nslot(o)))
+// Iterating position: [0, asize) is array part, hash part's slots are
+// after it. See hmap_next(), hmap_key() and hmap_val() in value_inl.h
+#define hmap_end(o)      ((o)->asize + hmap_nslot(o))
+
 struct hmap *hmap_new(struct ymd_mach *vm, int count);
+struct hmap *hmap_new_ordered(struct ymd_mach *vm, int count);
 struct hmap *hmap_init(struct ymd_mach *vm, struct hmap *o, int count);
 void hmap_final(struct ymd_mach *vm, struct hmap *o);
 struct variable *hmap_put(struct ymd_mach *vm, struct hmap *o,
@@ -208,11 +465,36 @@ struct variable *hmap_get(struct hmap *o, const struct variable *k);
 int hmap_remove(struct ymd_mach *vm, struct hmap *o,
                 const struct variable *k);
 
+// Hash set: `hset` functions:
+#define hset_nslot(o)    ((o)->key ? 1 << (o)->shift : 0)
+#define hset_full(o, i)  ((o)->ctrl[i] & KVI_FULL)
+
+struct hset *hset_new(struct ymd_mach *vm, int count);
+void hset_final(struct ymd_mach *vm, struct hset *o);
+// Returns 1 if `k' is added, 0 if it is in the set already.
+int hset_put(struct ymd_mach *vm, struct hset *o, const struct variable *k);
+int hset_get(const struct hset *o, const struct variable *k);
+int hset_remove(struct ymd_mach *vm, struct hset *o,
+                const struct variable *k);
+// Set algebra by stored hashes, `o' gets the result:
+// o = o | rhs
+void hset_merge(struct ymd_mach *vm, struct hset *o, const struct hset *rhs);
+// o = o | (a & b)
+void hset_intersect(struct ymd_mach *vm, struct hset *o,
+                    const struct hset *a, const struct hset *b);
+// o = o | (a - b)
+void hset_diff(struct ymd_mach *vm, struct hset *o, const struct hset *a,
+               const struct hset *b);
+
 // Skip list: `skls` functions:
 // order: SKLS_ASC  -> order by asc
 //        SKLS_DASC -> order by dasc
 //        func      -> user defined
 struct skls *skls_new(struct ymd_mach *vm, struct func *order);
+// key: order by key(k) with SKLS_ASC or SKLS_DASC, key(k) is called once
+//      per operation and cached in node.
+struct skls *skls_new_key(struct ymd_mach *vm, struct func *order,
+                          struct func *key);
 void skls_final(struct ymd_mach *vm, struct skls *o);
 struct variable *skls_put(struct ymd_mach *vm, struct skls *o,
 		const struct variable *k);
@@ -229,15 +511,174 @@ ymd_int_t skls_key_compare(struct ymd_mach *vm, const struct skls *o,
 struct sknd *skls_direct(struct ymd_mach *vm, const struct skls *o,
 		const struct variable *k);
 
+// Zero-based rank of key `k', or -1 if not found.
+int skls_rank(struct ymd_mach *vm, const struct skls *o,
+		const struct variable *k);
+
+// The node at zero-based rank `i', or NULL if out of range.
+struct sknd *skls_nth(const struct skls *o, int i);
+
+// Bulk loading: pairs sorted by the list's order are linked at the tail
+// without searching, O(1) for each one. After the first key out of order,
+// all puts fall back to skls_put().
+struct skls_loader {
+	struct skls *o;
+	int sorted;
+	struct sknd *last[SKLS_MAX_LEVEL]; // Last node in each level
+	int rank[SKLS_MAX_LEVEL]; // and its rank
+};
+void skls_load_begin(struct skls_loader *ld, struct skls *o);
+struct variable *skls_load(struct ymd_mach *vm, struct skls_loader *ld,
+		const struct variable *k);
+
+// B+ tree: `btre` functions:
+// order: same as skip list's
+struct btre *btre_new(struct ymd_mach *vm, struct func *order);
+void btre_final(struct ymd_mach *vm, struct btre *o);
+struct variable *btre_put(struct ymd_mach *vm, struct btre *o,
+		const struct variable *k);
+struct variable *btre_get(struct ymd_mach *vm, struct btre *o,
+		const struct variable *k);
+int btre_remove(struct ymd_mach *vm, struct btre *o,
+		const struct variable *k);
+
+// Compare the B+ tree's key only.
+ymd_int_t btre_key_compare(struct ymd_mach *vm, const struct btre *o,
+		const struct variable *lhs, const struct variable *rhs);
+
+// Position of first great or equal than key's pair: returns index in leaf
+// `*lf', `*lf' is NULL if no one.
+int btre_direct(struct ymd_mach *vm, const struct btre *o,
+		const struct variable *k, struct btlf **lf);
+
 // Dynamic array: `dyay` functions:
 struct dyay *dyay_new(struct ymd_mach *vm, int count);
 void dyay_final(struct ymd_mach *vm, struct dyay *o);
+// View of [start, start + count) in `o', no element is copied until one of
+// them changes.
+struct dyay *dyay_slice(struct ymd_mach *vm, struct dyay *o, int start,
+                        int count);
+// Copy borrowed elements if `o' is a view, then it can be changed.
+struct dyay *dyay_own(struct ymd_mach *vm, struct dyay *o);
 struct variable *dyay_get(struct dyay *o, ymd_int_t i);
 struct variable *dyay_add(struct ymd_mach *vm, struct dyay *o);
 struct variable *dyay_insert(struct ymd_mach *vm, struct dyay *o,
 	                         ymd_int_t i);
 int dyay_remove(struct ymd_mach *vm, struct dyay *o, ymd_int_t i);
 
+// Sort elements in place: `cmp' is a comparing function or NULL to order
+// by compare(), `stable' keeps the order of equal elements.
+void dyay_sort(struct ymd_mach *vm, struct dyay *o, struct func *cmp,
+		int stable);
+
+// Stable sort by key(elem), the key function is called once for each
+// element.
+void dyay_sort_by(struct ymd_mach *vm, struct dyay *o, struct func *key);
+
+// The `k' greatest elements in descending order to `top', returns number
+// of them.
+int dyay_topk(struct ymd_mach *vm, struct dyay *o, struct func *cmp,
+		struct variable *top, int k);
+
+// Reorder elements as nth_element(): the `i'th one is the one in sorted
+// order, none before it is greater, none after it is less.
+struct variable *dyay_select(struct ymd_mach *vm, struct dyay *o,
+		struct func *cmp, int i);
+
+// Binary search in sorted array: index of the first element not less than
+// `k', or if `upper', the first element greater than `k'.
+int dyay_bound(struct ymd_mach *vm, struct dyay *o, struct func *cmp,
+		const struct variable *k, int upper);
+
+// Packed array: `pkay` functions:
+// New array of `count' zero elements.
+struct pkay *pkay_new(struct ymd_mach *vm, int kind, int count);
+void pkay_final(struct ymd_mach *vm, struct pkay *o);
+// Element size in bytes and kind name: "int64", "float64", "int32", "uint8"
+int pkay_elem_size(int kind);
+const char *pkay_kind_name(int kind);
+// Kind by name, or -1 if no one.
+int pkay_kind_of(const char *z);
+// Get `i'th element as int or float.
+struct variable *pkay_get(const struct pkay *o, int i, struct variable *v);
+// Set `i'th element by a number, it is converted to array's kind as C does:
+// int32 and uint8 wrap around, a float is truncated for integer kinds.
+void pkay_set(struct ymd_mach *vm, struct pkay *o, int i,
+		const struct variable *v);
+void pkay_add(struct ymd_mach *vm, struct pkay *o, const struct variable *v);
+
+// Kernels: loops over raw elements in independent lanes, which compilers
+// vectorize without reordering floating-point operations. Operands of two
+// arrays must be in the same kind and count.
+// Sum of elements: int for integer kinds, float for float64.
+void pkay_sum(const struct pkay *o, struct variable *rv);
+// Min or max element, returns 0 if array is empty.
+int pkay_minmax(const struct pkay *o, int max, struct variable *rv);
+void pkay_dot(struct ymd_mach *vm, const struct pkay *o,
+		const struct pkay *rhs, struct variable *rv);
+// o[i] = o[i] * k
+void pkay_scale(struct ymd_mach *vm, struct pkay *o, const struct variable *k);
+// o[i] = o[i] + rhs[i], or o[i] + rhs if rhs is a number.
+void pkay_addto(struct ymd_mach *vm, struct pkay *o,
+		const struct variable *rhs);
+// o[i] = o[0] + ... + o[i]
+void pkay_prefix_sum(struct pkay *o);
+// mask[i] = o[i] `op' rhs[i], or o[i] `op' rhs if rhs is a number; `mask'
+// is a uint8 array in the same count.
+void pkay_mask(struct ymd_mach *vm, const struct pkay *o, int op,
+		const struct variable *rhs, struct pkay *mask);
+
+// Deque: `dequ` functions:
+struct dequ *dequ_new(struct ymd_mach *vm, int count);
+void dequ_final(struct ymd_mach *vm, struct dequ *o);
+// `i'th element from the front
+static YMD_INLINE struct variable *dequ_get(const struct dequ *o, int i) {
+	assert (i >= 0 && i < o->count);
+	return o->elem + ((o->head + i) & (o->max - 1));
+}
+// Slot of a new element at the front or back, which is nil.
+struct variable *dequ_push(struct ymd_mach *vm, struct dequ *o, int front);
+// Pop an element from the front or back to `rv', returns 0 if empty.
+int dequ_pop(struct dequ *o, int front, struct variable *rv);
+
+// Binary heap: `heap` functions:
+// cmp: SKLS_ASC -> min heap, SKLS_DASC -> max heap, or cmp(a, b) < 0 makes
+// `a' be popped before `b'.
+// key: order by key(x) with SKLS_ASC or SKLS_DASC, key(x) is called once
+// for each pushing.
+struct heap *heap_new(struct ymd_mach *vm, struct func *cmp,
+                      struct func *key);
+void heap_final(struct ymd_mach *vm, struct heap *o);
+// The first one in order, NULL if empty.
+static YMD_INLINE struct variable *heap_peek(const struct heap *o) {
+	return o->count > 0 ? o->elem : NULL;
+}
+// `x' should be kept alive (in stack) by caller, functions may be called.
+void heap_push(struct ymd_mach *vm, struct heap *o, const struct variable *x);
+// Remove the first one, heap_peek() it before popping.
+void heap_pop(struct ymd_mach *vm, struct heap *o);
+
+// LRU cache: `lruc` functions:
+// Flag in GC_HEAD's `reserved': capacity is in bytes.
+#define LRUC_BYTES       0x1
+#define lruc_inbytes(o)  ((o)->reserved & LRUC_BYTES)
+
+struct lruc *lruc_new(struct ymd_mach *vm, ymd_int_t limit, int inbytes,
+                      struct func *evict);
+void lruc_final(struct ymd_mach *vm, struct lruc *o);
+// Bytes counted for a pair: the node and length of strings in it.
+ymd_int_t lruc_bytes(const struct variable *k, const struct variable *v);
+// Get value and make it the most recently used one, knil if missing.
+struct variable *lruc_get(struct lruc *o, const struct variable *k);
+// Get value without touching recency and counters, knil if missing.
+struct variable *lruc_peek(const struct lruc *o, const struct variable *k);
+// Put a pair as the most recently used one, then evict the least ones
+// until it is in capacity. The eviction function may be called.
+void lruc_put(struct ymd_mach *vm, struct lruc *o, const struct variable *k,
+              const struct variable *v);
+int lruc_remove(struct ymd_mach *vm, struct lruc *o,
+                const struct variable *k);
+
 // Managed data: `mand` functions:
 struct mand *mand_new(struct ymd_mach *vm, int size, ymd_final_t final);
 void mand_final(struct ymd_mach *vm, struct mand *o);
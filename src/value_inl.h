@@ -2,24 +2,76 @@
 #define YMD_VALUE_INL_H
 
 #include "builtin.h"
+#include <stdint.h>
+#include <string.h>
+
+//
+// Raw accessors, no type checking:
+//
+#if defined(YMD_NANBOX)
+// Boxed encoding (`nb' xor NB_BOX):
+//   double  : any bits except the negative quiet NaN space, NaN is
+//             canonical positive quiet NaN
+//   others  : 0xFFF8 | tag in high 16 bits, 48-bit payload, tag is
+//             T_NIL/T_INT/T_BOOL/T_EXT/T_REF
+// After xor NB_BOX the boxed ones have high 13 bits zero, so the all
+// zero variable is `nil'.
+#define NB_BOX     0xFFF8000000000000ULL
+#define NB_PAYLOAD 0x0000FFFFFFFFFFFFULL
+#define NB_NAN     0x7FF8000000000000ULL
+
+#define NB_MAX_INT  ((1LL << 47) - 1)
+#define NB_MIN_INT  (-(1LL << 47))
+
+static YMD_INLINE unsigned var_tt(const struct variable *v) {
+	return (v->nb >> 51) ? T_FLOAT : (unsigned)(v->nb >> 48);
+}
+
+// Payload is sign extended, for `int' and canonical pointers.
+static YMD_INLINE ymd_int_t nb_payload(const struct variable *v) {
+	return ((ymd_int_t)(v->nb << 16)) >> 16;
+}
+
+static YMD_INLINE void nb_box(struct variable *v, unsigned tt,
+                              ymd_uint_t x) {
+	v->nb = ((ymd_uint_t)tt << 48) | (x & NB_PAYLOAD);
+}
+
+#define var_int(v)   nb_payload(v)
+#define var_ext(v)   ((void *)(intptr_t)nb_payload(v))
+#define var_ref(v)   ((struct gc_node *)(intptr_t)nb_payload(v))
+
+static YMD_INLINE ymd_float_t var_float(const struct variable *v) {
+	ymd_uint_t bits = v->nb ^ NB_BOX;
+	ymd_float_t f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+#else
+#define var_tt(v)    ((v)->tt)
+#define var_int(v)   ((v)->u.i)
+#define var_float(v) ((v)->u.f)
+#define var_ext(v)   ((v)->u.ext)
+#define var_ref(v)   ((v)->u.ref)
+#endif
 
 //
 // Type getter
 //
 #define ymd_type(var) \
-	((var)->tt == T_REF ? (var)->u.ref->type : (var)->tt)
+	(var_tt(var) == T_REF ? var_ref(var)->type : var_tt(var))
 
 //
 // Get referenced object for variable
 //
 #define DEFINE_REFCAST(name, ty) \
 static YMD_INLINE struct name *name##_x(struct variable *var) { \
-	assert(var->u.ref->type == ty); \
-	return (struct name *)var->u.ref; \
+	assert(var_ref(var)->type == ty); \
+	return (struct name *)var_ref(var); \
 } \
 static YMD_INLINE const struct name *name##_k(const struct variable *var) { \
-	assert(var->u.ref->type == ty); \
-	return (const struct name *)var->u.ref; \
+	assert(var_ref(var)->type == ty); \
+	return (const struct name *)var_ref(var); \
 } \
 static YMD_INLINE struct name *name##_f(void *o) { \
 	return (struct name *)o; \
@@ -34,13 +86,55 @@ DECL_TREF(DECL_REFOF)
 
 #define mand_cast(var, ty, type) ((type)mand_land(var, ty))
 
+#if defined(YMD_NANBOX)
+#define is_nil(v) ((v)->nb == 0)
+#define is_ref(v) (((v)->nb >> 48) == T_REF)
+#define is_num(v) (var_tt(v) == T_INT || var_tt(v) == T_FLOAT)
+#else
 #define is_nil(v) ((v)->tt == T_NIL)
 #define is_ref(v) ((v)->tt == T_REF)
 #define is_num(v) ((v)->tt == T_INT || (v)->tt == T_FLOAT)
+#endif
 
 //
 // Variable setter:
 //
+#if defined(YMD_NANBOX)
+static YMD_INLINE void setv_nil (struct variable *v) {
+	v->nb = 0;
+}
+#define SETV_DECL(name, arg1) \
+	static YMD_INLINE void setv_##name (struct variable *v, arg1 x)
+SETV_DECL(float, ymd_float_t) {
+	ymd_uint_t bits = NB_NAN;
+	if (x == x)
+		memcpy(&bits, &x, sizeof(bits));
+	v->nb = bits ^ NB_BOX;
+}
+SETV_DECL(int, ymd_int_t) {
+	// Out of 48-bit range integer is promoted to float, not truncated.
+	if (x < NB_MIN_INT || x > NB_MAX_INT) {
+		setv_float(v, (ymd_float_t)x);
+		return;
+	}
+	nb_box(v, T_INT, (ymd_uint_t)x);
+}
+SETV_DECL(bool, ymd_int_t) {
+	nb_box(v, T_BOOL, (ymd_uint_t)x);
+}
+SETV_DECL(ext, void *) {
+	nb_box(v, T_EXT, (ymd_uint_t)(uintptr_t)x);
+}
+SETV_DECL(ref, struct gc_node *) {
+	nb_box(v, T_REF, (ymd_uint_t)(uintptr_t)gcx(x));
+}
+#undef SETV_DECL
+#define DEFINE_SETTER(name, ty) \
+static YMD_INLINE void setv_##name(struct variable *v, struct name *o) { \
+	assert(o != NULL && #name" setter to NULL."); \
+	nb_box(v, T_REF, (ymd_uint_t)(uintptr_t)gcx(o)); \
+}
+#else
 static YMD_INLINE void setv_nil (struct variable *v) {
 	v->tt = T_NIL; v->u.i = 0;
 }
@@ -68,6 +162,7 @@ static YMD_INLINE void setv_##name(struct variable *v, struct name *o) { \
 	v->tt = T_REF; \
 	v->u.ref = gcx(o); \
 }
+#endif
 DECL_TREF(DEFINE_SETTER)
 #undef DEFINE_SETTER
 
@@ -101,5 +196,38 @@ static YMD_INLINE int func_argv(const struct func *fn) {
 	return fn->is_c ? 0 : fn->u.core->argv;
 }
 
+// Position of first used pair from `i', or hmap_end(o) if no one.
+static YMD_INLINE int hmap_next(const struct hmap *o, int i) {
+	const int k = hmap_nslot(o);
+	while (i < o->asize && is_nil(o->arr + i))
+		++i;
+	if (i < o->asize)
+		return i;
+	i -= o->asize;
+	if (!o->ctrl)
+		return o->asize + (i < o->count ? i : k);
+	if (hmap_ordered(o)) {
+		while (i < k && is_nil(&o->item[i].k))
+			++i;
+		return o->asize + i;
+	}
+	while (i < k && !kvi_full(o, i))
+		++i;
+	return o->asize + i;
+}
+
+// Key of pair at position `i', key of array part is made in `buf'.
+static YMD_INLINE const struct variable *
+hmap_key(const struct hmap *o, int i, struct variable *buf) {
+	if (i >= o->asize)
+		return &o->item[i - o->asize].k;
+	setv_int(buf, i);
+	return buf;
+}
+
+static YMD_INLINE struct variable *hmap_val(const struct hmap *o, int i) {
+	return i < o->asize ? o->arr + i : &o->item[i - o->asize].v;
+}
+
 #endif // YMD_VALUE_INL_H
 
@@ -17,20 +17,20 @@ static int test_sanity(struct ymd_mach *vm) {
 	(void)vm;
 	struct variable var;
 	setv_nil(&var);
-	ASSERT_EQ(int, T_NIL, var.tt);
-	ASSERT_EQ(large, 0, var.u.i);
+	ASSERT_EQ(int, T_NIL, var_tt(&var));
+	ASSERT_EQ(large, 0, var_int(&var));
 
 	setv_int(&var, 1000);
-	ASSERT_EQ(int, T_INT, var.tt);
-	ASSERT_EQ(large, 1000, var.u.i);
+	ASSERT_EQ(int, T_INT, var_tt(&var));
+	ASSERT_EQ(large, 1000, var_int(&var));
 
 	setv_bool(&var, 1);
-	ASSERT_EQ(int, T_BOOL, var.tt);
-	ASSERT_TRUE(var.u.i);
+	ASSERT_EQ(int, T_BOOL, var_tt(&var));
+	ASSERT_TRUE(var_int(&var));
 
 	setv_float(&var, 3.1415);
-	ASSERT_EQ(int, T_FLOAT, var.tt);
-	ASSERT_TRUE(3.1415 == var.u.f);
+	ASSERT_EQ(int, T_FLOAT, var_tt(&var));
+	ASSERT_TRUE(3.1415 == var_float(&var));
 
 #define ENTRY(clazz) \
 	printf ("sizeof("#clazz") = %zd\n", sizeof(struct clazz))
@@ -44,6 +44,50 @@ static int test_sanity(struct ymd_mach *vm) {
 	return 0;
 }
 
+static int test_variable_encoding(struct ymd_mach *vm) {
+	static const ymd_int_t ints[] = {
+		0, 1, -1, 1024, -1024, (1LL << 47) - 1, -(1LL << 47),
+	};
+	static const ymd_float_t floats[] = {
+		0.0, -0.0, 1.5, -1.5, 1e300, -1e-300, 1.0 / 0.0, -1.0 / 0.0,
+	};
+	struct variable var;
+	size_t i;
+	(void)vm;
+	for (i = 0; i < ARRAY_SIZEOF(ints); ++i) {
+		setv_int(&var, ints[i]);
+		ASSERT_EQ(int, T_INT, ymd_type(&var));
+		ASSERT_EQ(large, ints[i], var_int(&var));
+	}
+	// Out of 48-bit range: float in NaN-boxed build, never truncated.
+	setv_int(&var, 1LL << 62);
+#if defined(YMD_NANBOX)
+	ASSERT_EQ(int, T_FLOAT, ymd_type(&var));
+	ASSERT_TRUE(var_float(&var) == (ymd_float_t)(1LL << 62));
+#else
+	ASSERT_EQ(large, 1LL << 62, var_int(&var));
+#endif
+	for (i = 0; i < ARRAY_SIZEOF(floats); ++i) {
+		setv_float(&var, floats[i]);
+		ASSERT_EQ(int, T_FLOAT, ymd_type(&var));
+		ASSERT_TRUE(floats[i] == var_float(&var));
+	}
+	setv_float(&var, 0.0 / 0.0);
+	ASSERT_EQ(int, T_FLOAT, ymd_type(&var));
+	ASSERT_TRUE(var_float(&var) != var_float(&var));
+	setv_ext(&var, &var);
+	ASSERT_EQ(int, T_EXT, ymd_type(&var));
+	ASSERT_TRUE(&var == var_ext(&var));
+	setv_ext(&var, (void *)-1);
+	ASSERT_TRUE((void *)-1 == var_ext(&var));
+	setv_bool(&var, 0);
+	ASSERT_EQ(int, T_BOOL, ymd_type(&var));
+	ASSERT_FALSE(is_nil(&var));
+	memset(&var, 0, sizeof(var));
+	ASSERT_TRUE(is_nil(&var));
+	return 0;
+}
+
 static int test_kstr_creation(struct ymd_mach *vm) {
 	const struct kstr *kz = kstr_fetch(vm, "abcdef", 6);
 	ASSERT_EQ(int, kz->marked, vm->gc.white);
@@ -122,6 +166,20 @@ static int test_kstr_comparation_2(struct ymd_mach *vm) {
 	return 0;
 }
 
+static int test_kstr_hash(struct ymd_mach *vm) {
+	static const char *z = "The quick brown fox jumps over the lazy dog";
+	const struct kstr *kz = kstr_fetch(vm, z, 9);
+	ASSERT_EQ(ulong, kz->hash, kz_hash(z, 9, vm->kpool.seed));
+	ASSERT_EQ(ulong, kz_hash(z, 9, 1), kz_hash(z, 9, 1));
+	ASSERT_NE(ulong, kz_hash(z, 9, 1), kz_hash(z, 9, 2));
+	ASSERT_NE(ulong, kz_hash(z, 8, 1), kz_hash(z, 9, 1));
+	// Long string is not in pool, it is hashed when first used.
+	kz = kstr_fetch(vm, z, -1);
+	ASSERT_EQ(ulong, kstr_hash(kz), kz_hash(z, kz->len, vm->kpool.seed));
+	ASSERT_EQ(ulong, kz->hash, kz_hash(z, kz->len, vm->kpool.seed));
+	return 0;
+}
+
 static int test_kstr_kpool(struct ymd_mach *vm) {
 	struct kstr *kz = kstr_fetch(vm, "a", -1);
 	ASSERT_STREQ(kz->land, "a");
@@ -136,3 +194,102 @@ static int test_kstr_kpool(struct ymd_mach *vm) {
 	return 0;
 }
 
+static int test_kstr_kpool_resize(struct ymd_mach *vm) {
+	struct kpool *kt = &vm->kpool;
+	struct kstr **fetched;
+	char buf[32];
+	int i, resizing = 0, shift = kt->shift, used = kt->used;
+	const int n = 4096;
+
+	fetched = vm_zalloc(vm, n * sizeof(*fetched));
+	for (i = 0; i < n; ++i) {
+		snprintf(buf, sizeof(buf), "kpool.%d", i);
+		fetched[i] = kstr_fetch(vm, buf, -1);
+		if (kt->old)
+			++resizing;
+	}
+	ASSERT_EQ(int, kt->used, used + n);
+	ASSERT_GT(int, kt->shift, shift);
+	ASSERT_GT(int, resizing, 0);
+	for (i = 0; i < n; ++i) {
+		snprintf(buf, sizeof(buf), "kpool.%d", i);
+		ASSERT_TRUE(fetched[i] == kstr_fetch(vm, buf, -1));
+	}
+	vm_free(vm, fetched);
+	// Sweep all strings, pool should be shrinked.
+	shift = kt->shift;
+	gc_active(vm, -1);
+	do gc_step(vm); while (vm->gc.state != GC_PAUSE);
+	gc_active(vm, +1);
+	ASSERT_LT(int, kt->used, n);
+	ASSERT_TRUE(kt->old != NULL);
+	for (i = 0; i < n && kt->old; ++i)
+		ASSERT_STREQ(kstr_fetch(vm, "kpool.0", -1)->land, "kpool.0");
+	ASSERT_NULL(kt->old);
+	ASSERT_LT(int, kt->shift, shift);
+	return 0;
+}
+
+static int test_kstr_slice(struct ymd_mach *vm) {
+	static const char *z = "The quick brown fox jumps over the lazy dog";
+	struct kstr *kz = kstr_fetch(vm, z, -1), *x, *y;
+	ASSERT_TRUE(kstr_slice(vm, kz, 0, kz->len) == kz);
+	// Long suffix is a view.
+	x = kstr_slice(vm, kz, 1, kz->len - 1);
+	ASSERT_TRUE(x->land == kz->land + 1);
+	ASSERT_TRUE(x->u.parent == kz);
+	ASSERT_STREQ(x->land, z + 1);
+	y = kstr_slice(vm, x, 1, x->len - 1);
+	ASSERT_TRUE(y->u.parent == kz);
+	ASSERT_STREQ(y->land, z + 2);
+	ASSERT_TRUE(kstr_equals(y, kstr_fetch(vm, z + 2, -1)));
+	ASSERT_EQ(ulong, kstr_hash(y), kstr_hash(kstr_fetch(vm, z + 2, -1)));
+	// Short or not suffix is copied.
+	x = kstr_slice(vm, kz, 4, 5);
+	ASSERT_TRUE(x == kstr_fetch(vm, "quick", -1));
+	x = kstr_slice(vm, kz, 0, kz->len - 1);
+	ASSERT_FALSE(x->reserved & KSTR_VIEW);
+	ASSERT_EQ(int, x->land[x->len], 0);
+	return 0;
+}
+
+
+// `s = s .. x' appends to the buffer of `s' in place, older values keep
+// their contents.
+static int test_kstr_concat(struct ymd_mach *vm) {
+	static const char *z = "The quick brown fox jumps over the lazy dog";
+	struct variable part[2];
+	struct kstr *s, *t, *u, *buf;
+	setv_kstr(part, kstr_fetch(vm, z, -1));
+	setv_kstr(part + 1, kstr_fetch(vm, "!", 1));
+	s = kstr_concat(vm, part, 2);
+	ASSERT_EQ(int, s->len, 44);
+	ASSERT_TRUE(s->reserved & KSTR_VIEW);
+	buf = s->u.parent;
+	ASSERT_TRUE(buf->reserved & KSTR_BUF);
+	ASSERT_FALSE(kstr_open(s));
+	// Full buffer grows once, then it is appended in place.
+	setv_kstr(part, s);
+	t = kstr_concat(vm, part, 2);
+	ASSERT_TRUE(t->u.parent != buf);
+	buf = t->u.parent;
+	setv_kstr(part, t);
+	u = kstr_concat(vm, part, 2);
+	ASSERT_TRUE(u->u.parent == buf);
+	ASSERT_TRUE(u->land == t->land);
+	ASSERT_STREQ(u->land, "The quick brown fox jumps over the lazy dog!!!");
+	ASSERT_EQ(int, t->len, 45);
+	ASSERT_TRUE(kstr_open(t));
+	// Not at the end of buffer any more: copied.
+	setv_kstr(part, t);
+	s = kstr_concat(vm, part, 2);
+	ASSERT_TRUE(s->land != t->land);
+	ASSERT_TRUE(kstr_equals(s, u));
+	// C functions get a terminated copy.
+	setv_kstr(part, t);
+	s = kstr_of(ioslate(vm), part);
+	ASSERT_FALSE(kstr_open(s));
+	ASSERT_STREQ(s->land, "The quick brown fox jumps over the lazy dog!!");
+	ASSERT_TRUE(kstr_equals(s, t));
+	return 0;
+}
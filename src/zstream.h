@@ -103,9 +103,16 @@ static YMD_INLINE ymd_float_t zis_float(ZIS) {
 #define ZOS_INIT { {0}, NULL, 0, MAX_STATIC_LEN, NULL, }
 #define ZOS struct zostream *os
 
+// Init without clearing `kbuf', for the hot path of short outputs.
+static YMD_INLINE void zos_init(ZOS) {
+	os->buf = NULL, os->last = 0, os->max = MAX_STATIC_LEN;
+	os->err = NULL;
+}
+
 static YMD_INLINE void zos_final(ZOS) {
 	if (os->buf) free(os->buf);
-	memset(os->kbuf, 0, MAX_STATIC_LEN);
+	// Only the written part of `kbuf' is dirty.
+	memset(os->kbuf, 0, os->last < MAX_STATIC_LEN ? os->last : MAX_STATIC_LEN);
 	os->buf = NULL, os->last = 0, os->max = MAX_STATIC_LEN;
 }
 
@@ -120,7 +127,8 @@ static YMD_INLINE void *zos_last(ZOS) {
 static YMD_INLINE void zos_reserved(ZOS, int k) {
 	if (os->last + k <= MAX_STATIC_LEN) return;
 	if (os->last + k <= os->max) return;
-	os->max <<= 1;
+	while (os->last + k > os->max)
+		os->max <<= 1;
 	if (!os->buf) {
 		os->buf = calloc(os->max, 1);
 		if (os->last > 0) memcpy(os->buf, os->kbuf, os->last);